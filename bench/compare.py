@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""用同一个输入比较几个编译器 (例如同一提交前后的两次构建) 的耗时.
+
+用法: compare.py [--runs N] [--mode -koopa|-riscv] [--time-report] [--cpu | --alloc] input.c compiler [compiler...]
+      compiler 可以带选项, 例如 "build/compiler -parser=rd".
+
+每个编译器轮流运行 N 次 (默认 5), 报告最快一次的墙钟时间和最大常驻内存.
+--time-report 时再加上 -time-report=json, 报告各阶段最快一次的耗时和词法单元的吞吐量;
+--cpu 时各阶段改用 CPU 时间, 不受其他进程抢占的影响; --alloc 时改为各阶段分配的内存 (MB).
+不支持 -time-report 的早期版本只比较墙钟时间. 输出写到 /dev/null, 标准输出 (早期版本会输出 AST) 被丢弃.
+"""
+import argparse
+import json
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def run_once(command):
+    with tempfile.TemporaryFile() as stderr:
+        start = time.perf_counter()
+        pid = subprocess.Popen(command, stdout=subprocess.DEVNULL, stderr=stderr).pid
+        _, status, rusage = os.wait4(pid, 0)
+        wall_ms = (time.perf_counter() - start) * 1e3
+        stderr.seek(0)
+        text = stderr.read().decode()
+    if status != 0:
+        sys.exit("%s failed:\n%s" % (" ".join(command), text))
+    return wall_ms, rusage.ru_maxrss, text
+
+
+def command_of(compiler, args):
+    base = shlex.split(compiler)
+    command = [base[0], args.mode, args.input, "-o", "/dev/null"] + base[1:]
+    if args.time_report:
+        command.append("-time-report=json")
+    return command
+
+
+# 各编译器轮流运行, 机器负载的波动对它们的影响大致相同
+def measure(args):
+    results = {compiler: {"wall_ms": float("inf"), "rss_kb": 0, "phases": {}, "tokens": 0} for compiler in args.compilers}
+    for _ in range(args.runs):
+        for compiler in args.compilers:
+            best = results[compiler]
+            wall_ms, rss_kb, stderr = run_once(command_of(compiler, args))
+            best["wall_ms"] = min(best["wall_ms"], wall_ms)
+            best["rss_kb"] = max(best["rss_kb"], rss_kb)
+            if args.time_report:
+                report = json.loads(stderr[stderr.index("{"):])
+                best["tokens"] = report["counters"]["tokens"]
+                for phase in report["phases"]:
+                    old = best["phases"].get(phase["name"], float("inf"))
+                    best["phases"][phase["name"]] = min(old, phase[args.phase_time])
+    return [(compiler, results[compiler]) for compiler in args.compilers]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="compare compile time of several compilers")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--mode", default="-koopa")
+    parser.add_argument("--time-report", action="store_true")
+    parser.add_argument("--cpu", dest="phase_time", action="store_const", const="cpu_ms", default="wall_ms",
+                        help="report the CPU time of each phase instead of its wall time")
+    parser.add_argument("--alloc", dest="phase_time", action="store_const", const="alloc_bytes",
+                        help="report the memory allocated in each phase (MB) instead of its time")
+    parser.add_argument("input")
+    parser.add_argument("compilers", nargs="+")
+    args = parser.parse_args()
+
+    results = measure(args)
+    width = max(len(compiler) for compiler, _ in results)
+    phases = list(results[0][1]["phases"]) if args.time_report else []
+    header = "%-*s %10s %10s" % (width, "compiler", "wall ms", "max RSS kB")
+    for phase in phases:
+        header += " %14s" % phase
+    if args.time_report and args.phase_time != "alloc_bytes":
+        header += " %14s" % "Mtokens/s"
+    print(header)
+    scale = 1e-6 if args.phase_time == "alloc_bytes" else 1
+    for compiler, best in results:
+        line = "%-*s %10.1f %10d" % (width, compiler, best["wall_ms"], best["rss_kb"])
+        for phase in phases:
+            line += " %14.2f" % (best["phases"][phase] * scale)
+        if args.time_report and args.phase_time != "alloc_bytes":
+            parse_ms = best["phases"]["parse"]
+            line += " %14.2f" % (best["tokens"] / parse_ms / 1e3 if parse_ms else 0)
+        print(line)
+    base = results[0][1]["wall_ms"]
+    for compiler, best in results[1:]:
+        print("%s: %.2fx wall time of %s" % (compiler, best["wall_ms"] / base, results[0][0]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,32 @@
+#!/bin/sh
+# 比较几个提交的编译耗时: 在临时的 git worktree 中分别以 DEBUG=0 构建, 再用 compare.py 在同一个输入上轮流运行.
+# 用法: compare_revisions.sh input.c 提交... [-- compare.py 的选项...]
+# 环境变量 FLAGS 是传给每个编译器的额外选项, 例如 FLAGS=-dump-ast=sexpr.
+# 例: compare_revisions.sh big.c HEAD~1 HEAD -- --runs 9 --cpu --time-report
+
+INPUT=${1:?usage: compare_revisions.sh INPUT REV... [-- COMPARE_OPTIONS...]}
+shift
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'for tree in "$WORK"/*/; do git -C "$BENCH_DIR" worktree remove --force "$tree" 2> /dev/null; done; rm -rf "$WORK"' EXIT
+
+n=0
+compilers=""
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+  n=$((n + 1))
+  rev=$(git -C "$BENCH_DIR" rev-parse --short "$1^{commit}") || exit 1
+  tree="$WORK/$n-$rev"
+  git -C "$BENCH_DIR" worktree add --detach -q "$tree" "$rev" || exit 1
+  echo "== building $1 ($rev)" >&2
+  make -C "$tree" DEBUG=0 BUILD_DIR="$tree/build" > "$WORK/build-$n.log" 2>&1 || { cat "$WORK/build-$n.log" >&2; exit 1; }
+  compilers="$compilers $tree/build/compiler"
+  shift
+done
+[ "$1" = "--" ] && shift
+[ $n -gt 0 ] || { echo "no revisions given" >&2; exit 1; }
+
+set -- "$@" "$INPUT"
+for compiler in $compilers; do
+  set -- "$@" "$compiler${FLAGS:+ $FLAGS}"
+done
+python3 "$BENCH_DIR/compare.py" "$@"
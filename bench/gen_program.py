@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""生成一个大的 SysY 程序, 用于测量编译器各阶段的吞吐量.
+
+用法: gen_program.py 语句数 [--flat] [--no-short-circuit] [--seed N] > input.c
+
+程序只有一个 main 函数, 由常量和变量声明, 赋值, 表达式语句和嵌套的块组成,
+表达式用到全部运算符. --flat 时不生成嵌套的块, 表达式语句和没有初始值的变量声明, 常量只用字面量初始化,
+供只支持单个块, 只能折叠部分运算符的早期版本使用. --no-short-circuit 时不生成 && 和 ||,
+用于比较不同版本的前端时不让短路求值的基本块主导 IR 生成的时间. 相同的参数总是生成相同的程序.
+"""
+import argparse
+import random
+
+
+class Generator:
+    def __init__(self, rng, flat, short_circuit=True):
+        self.rng = rng
+        self.flat = flat
+        self.operators = ["+", "-", "*", "+", "-", "<", ">", "<=", ">=", "==", "!="]
+        if short_circuit:
+            self.operators += ["&&", "||"]
+        self.scopes = [[]]          # 每层作用域中可见的 (名字, 是否常量)
+        self.counter = 0
+        self.lines = []
+
+    # 表达式只引用最近声明的 64 个可见名字, 生成时间与程序大小成线性
+    def visible(self, const_only=False, limit=64):
+        names = []
+        for scope in reversed(self.scopes):
+            for name, is_const in reversed(scope):
+                if is_const or not const_only:
+                    names.append(name)
+                    if len(names) == limit:
+                        return names
+        return names
+
+    def fresh(self, prefix):
+        self.counter += 1
+        return "%s%d" % (prefix, self.counter)
+
+    def literal(self):
+        value = self.rng.randrange(0, 1000)
+        form = self.rng.randrange(4)
+        if form == 1:
+            return "0x%x" % value
+        if form == 2 and value:
+            return "0%o" % value
+        return str(value)
+
+    # names 是表达式可以引用的名字
+    def expr(self, depth, names):
+        if depth <= 0 or self.rng.random() < 0.2:
+            if names and self.rng.random() < 0.6:
+                return self.rng.choice(names)
+            return self.literal()
+        kind = self.rng.randrange(10)
+        if kind == 0:
+            return self.rng.choice("-+!") + self.expr(depth - 1, names)
+        if kind == 1:
+            return "(" + self.expr(depth - 1, names) + ")"
+        if kind == 2:
+            # 除数是非零的字面量
+            return "%s %s %d" % (self.expr(depth - 1, names), self.rng.choice("/%"), self.rng.randrange(1, 10))
+        op = self.rng.choice(self.operators)
+        return "%s %s %s" % (self.expr(depth - 1, names), op, self.expr(depth - 1, names))
+
+    def emit(self, indent, text):
+        self.lines.append("  " * indent + text)
+
+    def stmt(self, indent):
+        kind = self.rng.randrange(10)
+        names = self.visible()
+        variables = [name for name in names if name.startswith("v")]
+        if kind == 0:
+            name = self.fresh("c")
+            init = self.literal() if self.flat else self.expr(3, self.visible(const_only=True))
+            self.emit(indent, "const int %s = %s;" % (name, init))
+            self.scopes[-1].append((name, True))
+        elif kind <= 3 or not variables:
+            name = self.fresh("v")
+            init = "" if not self.flat and self.rng.random() < 0.1 else " = " + self.expr(4, names)
+            self.emit(indent, "int %s%s;" % (name, init))
+            self.scopes[-1].append((name, False))
+        elif kind <= 6 or self.flat:
+            self.emit(indent, "%s = %s;" % (self.rng.choice(variables), self.expr(4, names)))
+        elif kind == 7:
+            self.emit(indent, "%s;" % self.expr(3, names))
+        else:
+            return "block"
+        return None
+
+    def block(self, indent, count):
+        while count > 0:
+            if self.stmt(indent) == "block" and len(self.scopes) < 16:
+                size = min(count, self.rng.randrange(2, 20))
+                self.emit(indent, "{")
+                self.scopes.append([])
+                self.block(indent + 1, size)
+                self.scopes.pop()
+                self.emit(indent, "}")
+                count -= size
+            count -= 1
+
+    def program(self, count):
+        self.lines.append("int main() {")
+        self.scopes[0].append(("v0", False))
+        self.emit(1, "int v0 = 0;")
+        self.block(1, count)
+        self.emit(1, "return v0;")
+        self.lines.append("}")
+        return "\n".join(self.lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="generate a large SysY program")
+    parser.add_argument("statements", type=int)
+    parser.add_argument("--flat", action="store_true", help="only what early versions accept: one block, initialized variables, literal constants")
+    parser.add_argument("--no-short-circuit", dest="short_circuit", action="store_false", help="do not generate && and ||")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+    print(Generator(random.Random(args.seed), args.flat, args.short_circuit).program(args.statements), end="")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,147 @@
+// 符号表的微基准: SymbolTable (symtab.hpp) 与之前的 std::map<SymbolId, SymbolInfo>,
+// 以及按作用域分层的 std::unordered_map 比较声明, 查找和进出作用域的开销.
+// 名字是驻留表分配的稠密编号, 访问顺序用固定种子打乱. 每项取 5 次运行中最快的一次, 单位为 ns/次.
+// 用法: symtab_bench [名字个数...], 默认 16, 256, 4096, 65536.
+#include<algorithm>
+#include<chrono>
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<map>
+#include<numeric>
+#include<random>
+#include<unordered_map>
+#include<vector>
+#include "symtab.hpp"
+
+// 之前的实现: 一张全局的有序表, 没有作用域
+class MapTable {
+    private:
+        std::map<SymbolId, SymbolInfo> table;
+
+    public:
+        void PushScope() {}
+        void PopScope() {}
+        bool Declare(SymbolId name, const SymbolInfo &info) { return table.emplace(name, info).second; }
+        const SymbolInfo *Lookup(SymbolId name) {
+            auto it = table.find(name);
+            return it == table.end() ? nullptr : &it->second;
+        }
+        void Clear() { table.clear(); }
+};
+
+// 常见的带作用域的写法: 每层一张哈希表, 查找时由内向外逐层查
+class ScopedHashTable {
+    private:
+        std::vector<std::unordered_map<SymbolId, SymbolInfo>> scopes = std::vector<std::unordered_map<SymbolId, SymbolInfo>>(1);
+
+    public:
+        void PushScope() { scopes.emplace_back(); }
+        void PopScope() { scopes.pop_back(); }
+        bool Declare(SymbolId name, const SymbolInfo &info) { return scopes.back().emplace(name, info).second; }
+        const SymbolInfo *Lookup(SymbolId name) {
+            for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+                auto found = it->find(name);
+                if (found != it->end()) return &found->second;
+            }
+            return nullptr;
+        }
+        void Clear() { scopes.assign(1, {}); }
+};
+
+static volatile int sink;
+
+template<typename F>
+static double BestNanosPerOp(uint64_t ops, F f) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ns / ops);
+    }
+    return best;
+}
+
+// 一个作用域内声明 n 个名字
+template<typename Table>
+static double Declare(const std::vector<SymbolId> &names) {
+    Table table;
+    uint32_t rounds = std::max<uint32_t>(1, (1 << 20) / names.size());
+    return BestNanosPerOp(uint64_t(rounds) * names.size(), [&] {
+        for (uint32_t r = 0; r < rounds; ++r) {
+            table.Clear();
+            table.PushScope();
+            for (auto name : names) table.Declare(name, SymbolInfo(int(name)));
+        }
+    });
+}
+
+// n 个名字都已声明, 按打乱的顺序查找
+template<typename Table>
+static double Lookup(const std::vector<SymbolId> &names, const std::vector<SymbolId> &order) {
+    Table table;
+    table.PushScope();
+    for (auto name : names) table.Declare(name, SymbolInfo(int(name)));
+    uint32_t rounds = std::max<uint32_t>(1, (1 << 22) / order.size());
+    return BestNanosPerOp(uint64_t(rounds) * order.size(), [&] {
+        int sum = 0;
+        for (uint32_t r = 0; r < rounds; ++r) {
+            for (auto name : order) sum += table.Lookup(name)->const_value;
+        }
+        sink = sum;
+    });
+}
+
+// 8 层嵌套的块, 每层声明 4 个名字 (其中一半遮蔽外层), 在最内层查找全部可见的名字后逐层退出;
+// 每次操作是一次声明, 查找或作用域切换
+template<typename Table>
+static double NestedBlocks(const std::vector<SymbolId> &names) {
+    Table table;
+    table.PushScope();
+    for (auto name : names) table.Declare(name, SymbolInfo(int(name)));
+    const uint32_t depth = 8, per_scope = 4;
+    uint32_t visible = std::min<uint32_t>(names.size(), 64);
+    uint64_t ops_per_round = 2 * depth + depth * per_scope + visible;
+    uint32_t rounds = std::max<uint32_t>(1, (1 << 20) / ops_per_round);
+    SymbolId fresh = names.size();
+    return BestNanosPerOp(uint64_t(rounds) * ops_per_round, [&] {
+        int sum = 0;
+        for (uint32_t r = 0; r < rounds; ++r) {
+            for (uint32_t d = 0; d < depth; ++d) {
+                table.PushScope();
+                for (uint32_t i = 0; i < per_scope; ++i) {
+                    SymbolId name = i % 2 ? names[(d * per_scope + i) % names.size()] : fresh + d * per_scope + i;
+                    table.Declare(name, SymbolInfo(int(name)));
+                }
+            }
+            for (uint32_t i = 0; i < visible; ++i) sum += table.Lookup(names[i])->const_value;
+            for (uint32_t d = 0; d < depth; ++d) table.PopScope();
+        }
+        sink = sum;
+    });
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<uint32_t> sizes;
+    for (int i = 1; i < argc; ++i) sizes.push_back(uint32_t(std::strtoul(argv[i], nullptr, 0)));
+    if (sizes.empty()) sizes = {16, 256, 4096, 65536};
+
+    std::printf("%-8s %-14s %12s %12s %12s\n", "names", "operation", "SymbolTable", "std::map", "scoped hash");
+    for (auto n : sizes) {
+        std::vector<SymbolId> names(n);
+        std::iota(names.begin(), names.end(), 0);
+        std::vector<SymbolId> order = names;
+        std::shuffle(order.begin(), order.end(), std::mt19937(n));
+        std::shuffle(names.begin(), names.end(), std::mt19937(n + 1));
+
+        std::printf("%-8u %-14s %12.2f %12.2f %12.2f\n", n, "declare",
+                    Declare<SymbolTable>(names), Declare<MapTable>(names), Declare<ScopedHashTable>(names));
+        std::printf("%-8u %-14s %12.2f %12.2f %12.2f\n", n, "lookup",
+                    Lookup<SymbolTable>(names, order), Lookup<MapTable>(names, order), Lookup<ScopedHashTable>(names, order));
+        // std::map 没有作用域, 不能表达遮蔽, 不参与这一项
+        std::printf("%-8u %-14s %12.2f %12s %12.2f\n", n, "nested blocks",
+                    NestedBlocks<SymbolTable>(names), "-", NestedBlocks<ScopedHashTable>(names));
+    }
+    return 0;
+}
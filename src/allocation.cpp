@@ -0,0 +1,22 @@
+#include <cstdlib>
+#include <new>
+#include "stats.hpp"
+
+using namespace std;
+
+// 统计各阶段通过 new 申请的内存.
+// 放在单独的文件中: 与调用者在同一文件时, 优化会把配对的 new/delete 内联成 malloc/free,
+// g++ 因此报 -Wmismatched-new-delete
+void *operator new(size_t size) {
+  CountAllocation(size);
+  if (void *ptr = malloc(size ? size : 1)) return ptr;
+  throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  free(ptr);
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include<cassert>
+#include<cstddef>
+#include<cstdint>
+#include<cstdlib>
+#include<cstring>
+#include<new>
+#include<string_view>
+#include<type_traits>
+#include<utility>
+#include<vector>
+#include "stats.hpp"
+
+// 指针碰撞式的内存池: 一个编译单元的 AST 节点都从这里分配,
+// 节点不单独析构, 编译结束时整块释放.
+class Arena {
+    private:
+        static const size_t kChunkSize = 64 * 1024;
+
+        std::vector<char *> chunks;
+        char *ptr = nullptr;
+        char *end = nullptr;
+        size_t allocated = 0;
+
+        void *AllocateSlow(size_t size, size_t align) {
+            size_t chunk_size = size + align > kChunkSize ? size + align : kChunkSize;
+            char *chunk = static_cast<char *>(std::malloc(chunk_size));
+            if (!chunk) throw std::bad_alloc();
+            CountAllocation(chunk_size);
+            chunks.push_back(chunk);
+            ptr = chunk;
+            end = chunk + chunk_size;
+            return Allocate(size, align);
+        }
+
+    public:
+        Arena() = default;
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        ~Arena() {
+            for (auto chunk : chunks) std::free(chunk);
+        }
+
+        void *Allocate(size_t size, size_t align) {
+            uintptr_t p = (reinterpret_cast<uintptr_t>(ptr) + align - 1) & ~(uintptr_t)(align - 1);
+            if (!ptr || p + size > reinterpret_cast<uintptr_t>(end)) return AllocateSlow(size, align);
+            ptr = reinterpret_cast<char *>(p + size);
+            allocated += size;
+            return reinterpret_cast<void *>(p);
+        }
+
+        // 池中对象不会被析构, 因此只允许平凡析构的类型
+        template<typename T, typename... Args>
+        T *New(Args &&...args) {
+            static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+            return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        template<typename T>
+        T *NewArray(size_t n) {
+            static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+            T *array = static_cast<T *>(Allocate(sizeof(T) * (n ? n : 1), alignof(T)));
+            for (size_t i = 0; i < n; ++i) new (array + i) T();
+            return array;
+        }
+
+        std::string_view NewString(const char *str, size_t len) {
+            char *buffer = static_cast<char *>(Allocate(len + 1, 1));
+            std::memcpy(buffer, str, len);
+            buffer[len] = '\0';
+            return std::string_view(buffer, len);
+        }
+
+        // 释放全部内存, 之前分配的对象全部失效
+        void Reset() {
+            for (auto chunk : chunks) std::free(chunk);
+            chunks.clear();
+            ptr = end = nullptr;
+            allocated = 0;
+        }
+
+        // 已分配的字节数
+        size_t BytesAllocated() const { return allocated; }
+};
+
+// 从 arena 分配内存的 STL 分配器, 释放是空操作, 内存随 arena 一起释放.
+// 容器扩容后旧的缓冲留在池中, 只适合不会反复增长的小容器
+template<typename T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    Arena *arena;
+
+    explicit ArenaAllocator(Arena *arena) : arena(arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(arena->Allocate(sizeof(T) * n, alignof(T))); }
+    void deallocate(T *, size_t) {}
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+// 指向池中连续数组的视图
+template<typename T>
+struct ArenaSpan {
+    T *data = nullptr;
+    uint32_t size = 0;
+
+    T *begin() const { return data; }
+    T *end() const { return data + size; }
+    bool empty() const { return size == 0; }
+    T &operator[](size_t i) const { return data[i]; }
+};
@@ -1,34 +1,9 @@
 #pragma once
-#include<memory>
-#include<string>
-#include<iostream>
+#include<cstdint>
 #include<stdbool.h>
-#include<vector>
-#include<map>
-#include<assert.h>
-
-static int koopacnt;   // 临时变量计数器
-static int allocnt;      // 内存分配计数器
-
-struct SymbolInfo {
-    enum SymbolType {CONSTANT, VARIABLE};
-    SymbolType type;
-    union {
-        int const_value;
-        int alloc_id;
-    };
-    SymbolInfo(int value) : type(CONSTANT), const_value(value) {}
-    SymbolInfo(SymbolType t, int id) : type(t), alloc_id(id) {}
-};
-
-static std::map<std::string, SymbolInfo> symbolTable;
-
-struct ExprResult {
-    bool is_constant;
-    int value;  // 如果是常量则存储常量值，否则存储临时变量编号
-    
-    ExprResult(bool is_const = false, int val = 0) : is_constant(is_const), value(val) {}
-};
+#include "arena.hpp"
+#include "interner.hpp"
+#include "stats.hpp"
 
 typedef enum {
     MUL_OP,     //  *
@@ -65,706 +40,313 @@ typedef enum {
     SUB_OP      // -
 } addop_t;
 
+// 扁平表达式树的二元运算符, 按优先级从低到高排列; 比较和乘除模的顺序与 relop_t, mulop_t 相同
+typedef enum {
+    BINARY_LOR, BINARY_LAND,
+    BINARY_EQ, BINARY_NE,
+    BINARY_LT, BINARY_GT, BINARY_LE, BINARY_GE,
+    BINARY_ADD, BINARY_SUB,
+    BINARY_MUL, BINARY_DIV, BINARY_MOD
+} binaryop_t;
+
+// AST 节点的种类, 每个节点类对应一个; 访问者 (astvisitor.hpp) 按它分派
+typedef enum {
+    AST_COMP_UNIT,
+    AST_FUNC_DEF,
+    AST_FUNC_TYPE,
+    AST_BLOCK,
+    AST_BLOCK_ITEM,
+    AST_DECL,
+    AST_CONST_DECL,
+    AST_CONST_DEF,
+    AST_CONST_INIT_VAL,
+    AST_CONST_EXP,
+    AST_VAR_DECL,
+    AST_VAR_DEF,
+    AST_INIT_VAL,
+    AST_BTYPE,
+    AST_BINARY_EXPR,
+    AST_UNARY_EXPR,
+    AST_LITERAL,
+    AST_VAR_REF,
+    AST_LVAL,
+    AST_STMT,
+    AST_EXP,
+    AST_LOR_EXP,
+    AST_LAND_EXP,
+    AST_EQ_EXP,
+    AST_REL_EXP,
+    AST_ADD_EXP,
+    AST_MUL_EXP,
+    AST_UNARY_EXP,
+    AST_PRIMARY_EXP,
+    AST_KIND_NUM
+} ast_kind_t;
+
+// AST 节点都分配在 Arena 中, 不会被单独析构, 子节点列表是指向池内的视图, 标识符是驻留表中的编号.
+// 节点只保存数据, 没有虚函数; 输出, 化简和生成 IR 都是按 kind 分派的访问者.
+// 节点之间仍以指针相连, 没有改为按下标或按字段分列存放: 化简后的树按先序排在池中, 遍历已是顺序访问.
+// 这一选择依据的测量及复现方法见 bench/README.md
 class BaseAST {
     public:
-        virtual ~BaseAST() = default;
-        virtual void Dump() const = 0;
-        virtual ExprResult KoopaIR() const = 0;
+        const ast_kind_t kind;
+
+    protected:
+        explicit BaseAST(ast_kind_t kind) : kind(kind) { ++ast_node_cnt; }
+        ~BaseAST() = default;
 };
 
-// CompUnit ::= FuncDef;
-class CompUnitAST : public BaseAST{
+// 节点类的直接基类, 构造时记下种类. 节点类自己不定义构造函数,
+// 因此 arena.New<T>() 的值初始化仍会把字段清零
+template<ast_kind_t K>
+class AstNode : public BaseAST {
     public:
-        std::unique_ptr<BaseAST> func_def;
+        static constexpr ast_kind_t Kind = K;
+
+    protected:
+        AstNode() : BaseAST(K) {}
+};
+
+// 语法分析时暂存的节点链表, 归约出完整列表后压平成 ArenaSpan
+struct AstListNode {
+    BaseAST *item;
+    AstListNode *next;
+};
+
+struct AstList {
+    AstListNode *head;
+    AstListNode *tail;
+    uint32_t size;
+};
 
-        void Dump() const override {
-            std::cout << "CompUnitAST { ";
-            func_def->Dump();
-            std::cout << " }";
-        }
+static inline AstList *NewAstList(Arena &arena, BaseAST *item) {
+    auto node = arena.New<AstListNode>(AstListNode{item, nullptr});
+    return arena.New<AstList>(AstList{node, node, 1});
+}
+
+static inline void AstListAppend(Arena &arena, AstList *list, BaseAST *item) {
+    auto node = arena.New<AstListNode>(AstListNode{item, nullptr});
+    list->tail->next = node;
+    list->tail = node;
+    list->size++;
+}
+
+static inline ArenaSpan<BaseAST *> AstListToSpan(Arena &arena, const AstList *list) {
+    ArenaSpan<BaseAST *> span;
+    span.data = arena.NewArray<BaseAST *>(list->size);
+    span.size = list->size;
+    uint32_t i = 0;
+    for (auto node = list->head; node; node = node->next) span.data[i++] = node->item;
+    return span;
+}
 
-        ExprResult KoopaIR() const override {
-            func_def->KoopaIR();
-            return ExprResult();
-        }
+// CompUnit ::= FuncDef;
+class CompUnitAST : public AstNode<AST_COMP_UNIT> {
+    public:
+        BaseAST *func_def;
 };
 
 // FuncDef ::= FuncType IDENT "(" ")" Block;
-class FuncDefAST : public BaseAST{
+class FuncDefAST : public AstNode<AST_FUNC_DEF> {
     public:
-        std::unique_ptr<BaseAST> func_type;
-        std::string ident;
-        std::unique_ptr<BaseAST> block; 
-
-        void Dump() const override{
-            std::cout << "FuncDefAST { ";
-            func_type->Dump();
-            std::cout << ", " << ident << ", ";
-            block->Dump();
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override {
-            std::cout << "fun @" << ident << "(): ";
-            func_type->KoopaIR();
-            std::cout << "{ " << std::endl;
-            block->KoopaIR();
-            std::cout << " }" << std::endl;   
-            return ExprResult();
-        }
+        BaseAST *func_type;
+        SymbolId ident;
+        BaseAST *block;
 };
 
 // FuncType ::= "int";
-class FuncTypeAST : public BaseAST{
-    public:
-        void Dump() const override{
-            std::cout << "FuncTypeAST { int }";
-        }
-        
-        ExprResult KoopaIR() const override{
-            std::cout << "i32" << std::endl;
-            return ExprResult();
-        };
+class FuncTypeAST : public AstNode<AST_FUNC_TYPE> {
 };
 
 // Block ::= "{" {BlockItem} "}";
-class BlockAST : public BaseAST{
+class BlockAST : public AstNode<AST_BLOCK> {
     public:
-        std::vector<std::unique_ptr<BaseAST>> blockitem_list;
-
-        void Dump() const override{
-            std::cout << "BlockAST { ";
-            for (const auto& blockitem : blockitem_list){
-                blockitem->Dump();
-            }
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override{
-            std::cout << "%entry:" << std::endl;
-            for (const auto& blockitem : blockitem_list){
-                blockitem->KoopaIR();
-            }
-            return ExprResult();
-        }
+        ArenaSpan<BaseAST *> blockitem_list;
 };
 
 // BlockItem ::= Decl | Stmt;
-class BlockItemAST : public BaseAST{
+class BlockItemAST : public AstNode<AST_BLOCK_ITEM> {
     public:
         int type;
-        std::unique_ptr<BaseAST> decl_stmt;
-
-        void Dump() const override {
-            std::cout << "BlockItemAST { ";
-            decl_stmt->Dump();
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override {
-            return decl_stmt->KoopaIR();
-        }
+        BaseAST *decl_stmt;
 };
 
 // Decl ::= ConstDecl | VarDecl;
-class DeclAST : public BaseAST{
+class DeclAST : public AstNode<AST_DECL> {
     public:
-        std::unique_ptr<BaseAST> const_vardecl;
-
-        void Dump() const override{
-            std::cout << "DeclAST { ";
-            const_vardecl->Dump();
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override{
-            return const_vardecl->KoopaIR();
-        }
+        BaseAST *const_vardecl;
 };
 
 // ConstDecl ::= "const" BType ConstDef {"," ConstDef} ";";
-class ConstDeclAST : public BaseAST {
+class ConstDeclAST : public AstNode<AST_CONST_DECL> {
     public:
-        std::unique_ptr<BaseAST> btype;
-        std::vector<std::unique_ptr<BaseAST>> constdef_list;
-
-        void Dump() const override {
-            std::cout << "ConstDecl { ";
-            btype->Dump();
-            for (const auto& constdef : constdef_list) {
-                constdef->Dump();
-            }
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override {
-            btype->KoopaIR();
-            for (const auto& constdef : constdef_list) {
-                constdef->KoopaIR();
-            }
-            return ExprResult();
-        }
+        BaseAST *btype;
+        ArenaSpan<BaseAST *> constdef_list;
 };
 
 // ConstDef ::= IDENT "=" ConstInitVal;
-class ConstDefAST : public BaseAST {
+class ConstDefAST : public AstNode<AST_CONST_DEF> {
     public:
-        std::string ident;
-        std::unique_ptr<BaseAST> constintval;
-
-        void Dump() const override {
-            std::cout << "ConstDefAST { ";
-            std::cout << "IDENT = " << ident << ", value = ";
-            constintval->Dump();
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override {
-            if (symbolTable.find(ident) != symbolTable.end()) assert(false);
-            ExprResult intval = constintval->KoopaIR();
-            if (intval.is_constant){
-                symbolTable.emplace(ident, intval.value);
-            }
-            else assert(false);
-            return ExprResult();
-        }
+        SymbolId ident;
+        BaseAST *constintval;
 };
 
 // ConstInitVal ::= ConstExp;
-class ConstInitValAST : public BaseAST {
+class ConstInitValAST : public AstNode<AST_CONST_INIT_VAL> {
     public:
-        std::unique_ptr<BaseAST> constexp;
-
-        void Dump() const override {
-            std::cout << "ConstInitValAST { ";
-            constexp->Dump();
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override {
-            return constexp->KoopaIR();
-        }
+        BaseAST *constexp;
 };
 
 // ConstExp ::= Exp
-class ConstExpAST : public BaseAST {
+class ConstExpAST : public AstNode<AST_CONST_EXP> {
     public:
-        std::unique_ptr<BaseAST> exp;
-
-        void Dump() const override{
-            std::cout << "ConstExpAST { ";
-            exp->Dump();
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override {
-            return exp->KoopaIR();
-        }
+        BaseAST *exp;
 };
 
 // VarDecl ::= BType VarDef {"," VarDef} ";";
-class VarDeclAST : public BaseAST {
+class VarDeclAST : public AstNode<AST_VAR_DECL> {
     public:
-        std::unique_ptr<BaseAST> btype;
-        std::vector<std::unique_ptr<BaseAST>> vardef_list;
-
-        void Dump() const override {
-            std::cout << "VarDeclAST { ";
-            btype->Dump();
-            for (const auto& vardef : vardef_list) {
-                vardef->Dump();
-            }
-        }
-
-        ExprResult KoopaIR() const override {
-            btype->KoopaIR();
-            for (const auto& vardef : vardef_list) {
-                vardef->KoopaIR();
-            }
-            return ExprResult();
-        }
+        BaseAST *btype;
+        ArenaSpan<BaseAST *> vardef_list;
 };
 
 // VarDef ::= IDENT | IDENT "=" InitVal;
-class VarDefAST : public BaseAST {
+class VarDefAST : public AstNode<AST_VAR_DEF> {
     public:
-        std::string ident;
+        SymbolId ident;
         int type;
-        std::unique_ptr<BaseAST> initval;
-
-        void Dump() const override {
-            std::cout << "VarDefAST { ";
-            if (type == 1) std::cout << ident;
-            else if (type == 2) {
-                std::cout << "IDENT = " << ident << ", value = ";
-                initval->Dump();
-            }
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override {
-            if (symbolTable.find(ident) != symbolTable.end()) assert(false);
-            symbolTable.emplace(ident, SymbolInfo(SymbolInfo::VARIABLE, allocnt++));
-            std::cout << "  @" << ident << " = alloc i32" << std::endl;
-
-            if (type == 2) {
-                ExprResult intval = initval->KoopaIR();
-                if (intval.is_constant) {
-                    std::cout << "  store " << intval.value << ", @" << ident << std::endl;
-                }
-                else assert(false);
-            }
-            return ExprResult();
-        }
+        BaseAST *initval;
 };
 // InitVal ::= Exp;
-class InitValAST : public BaseAST {
-    public:    
-        std::unique_ptr<BaseAST> exp;
+class InitValAST : public AstNode<AST_INIT_VAL> {
+    public:
+        BaseAST *exp;
+};
 
-        void Dump() const override {
-            std::cout << "InitValAST { ";
-            exp->Dump();
-            std::cout << std::endl;
-        }
+// BType ::= "int";
+class BTypeAST : public AstNode<AST_BTYPE> {
+};
 
-        ExprResult KoopaIR() const override {
-            return exp->KoopaIR();
-        }
+// 扁平的表达式节点: 运算符记录在节点上, 括号和单子节点的包装层都不生成节点.
+// 手写语法分析器 (parser.hpp) 直接生成它们, AST 化简时 sysy.y 的包装链也改写成它们.
+// 生成的 IR 与对应的包装链完全相同.
+
+// BinaryExpr ::= Exp op Exp
+class BinaryExprAST : public AstNode<AST_BINARY_EXPR> {
+    public:
+        binaryop_t op;
+        BaseAST *lhs;
+        BaseAST *rhs;
 };
 
-// BType ::= "int";
-class BTypeAST : public BaseAST{
+// UnaryExpr ::= op Exp
+class UnaryExprAST : public AstNode<AST_UNARY_EXPR> {
     public:
-        void Dump() const override{
-            std::cout << "BTypeAST { int }";
-        }
+        unaryop_t op;
+        BaseAST *operand;
+};
 
-        ExprResult KoopaIR() const override {
-            return ExprResult();
-        }
+// Literal ::= INT_CONST
+class LiteralAST : public AstNode<AST_LITERAL> {
+    public:
+        std::int32_t value;
+};
+
+// VarRef ::= IDENT, 表达式中对变量或常量的引用
+class VarRefAST : public AstNode<AST_VAR_REF> {
+    public:
+        SymbolId ident;
 };
 
 // LVal ::= IDEDNT;
-class LValAST : public BaseAST{
+class LValAST : public AstNode<AST_LVAL> {
     public:
-        std::string ident;
-
-        void Dump() const override {
-            std::cout << "LValAST { " << ident << " }";
-        }
-
-        ExprResult KoopaIR() const override {
-            auto id_info = symbolTable.find(ident);
-            if (id_info != symbolTable.end()) {
-                if (id_info->second.type == SymbolInfo::CONSTANT) {
-                    return ExprResult(true, id_info->second.const_value);
-                } else {
-                    std::cout << "  %" << koopacnt << " = load @" << ident << std::endl;
-                    return ExprResult(false, koopacnt++);
-                }
-            }
-            else assert(false);
-            return ExprResult();        
-        }
-};
-
-// Stmt ::= LVal "=" Exp ";" | "return" Exp ";";
-class StmtAST : public BaseAST{
+        SymbolId ident;
+};
+
+// Stmt ::= LVal "=" Exp ";" | "return" Exp ";" | Block | [Exp] ";";
+class StmtAST : public AstNode<AST_STMT> {
     public:
-        std::unique_ptr<BaseAST> exp;
-        std::unique_ptr<BaseAST> lval;
+        BaseAST *exp;
+        BaseAST *lval;
+        BaseAST *block;
         int type;
-
-        void Dump() const override{
-            std::cout << "StmtAST { ";
-            exp->Dump();
-            if (type == 1){
-                lval->Dump();
-            }
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override{
-            if (type == 1) {
-                LValAST* lval_ptr = static_cast<LValAST*>(lval.get());
-                auto it = symbolTable.find(lval_ptr->ident);
-                if (it == symbolTable.end()) assert(false);
-                if (it->second.type == SymbolInfo::CONSTANT) assert(false);
-
-                ExprResult result = exp->KoopaIR();
-                std::cout << "  store ";
-                if (result.is_constant) std::cout << result.value;
-                else std::cout << "%" << result.value;
-                std::cout << ", @" << lval_ptr->ident << std::endl;
-                return ExprResult();
-            } else {
-                ExprResult result = exp->KoopaIR();
-                std::cout << "  ret ";
-                if (result.is_constant) {
-                    std::cout << result.value;
-                } else {
-                    std::cout << " %" <<result.value;
-                }
-                std::cout << std::endl;
-                return ExprResult();
-            }
-        }
 };
 
 // Exp ::= LOrExp;
-class ExpAST : public BaseAST{
+class ExpAST : public AstNode<AST_EXP> {
     public:
-        std::unique_ptr<BaseAST> lorexp;
-
-        void Dump() const override{
-            std::cout << "ExpAST { ";
-            lorexp->Dump();
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override{
-            return lorexp->KoopaIR();
-        }
+        BaseAST *lorexp;
 };
 
 // LOrExp ::= LAndExp | LOrExp "||" LAndExp;
-class LOrExpAST : public BaseAST{
+class LOrExpAST : public AstNode<AST_LOR_EXP> {
     public:
         int type;
-        std::unique_ptr<BaseAST> lorexp;
-        std::unique_ptr<BaseAST> landexp;
+        BaseAST *lorexp;
+        BaseAST *landexp;
         logicop_t logicop;
-        
-        void Dump() const override{
-            std::cout << "LOrExpAST { ";
-            if (type == 1) landexp->Dump();
-            else if (type == 2) {
-                lorexp->Dump();
-                std::cout << "logicop";
-                landexp->Dump();
-            }
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override{
-            if (type == 1) return landexp->KoopaIR();
-            else if (type == 2) {
-                ExprResult left = lorexp->KoopaIR();
-                ExprResult right = landexp->KoopaIR();
-                std::cout << "  %" << koopacnt << " = ";
-                
-                if (left.is_constant) std::cout << left.value << " || ";
-                else std::cout << "%" << left.value << " || ";
-                if (right.is_constant) std::cout << right.value << std::endl;
-                else std::cout << "%" << right.value << std::endl;
-
-                return ExprResult(false, koopacnt++);
-            }
-            return ExprResult();
-        }
 };
 
 // LAndExp ::= EqExp | LAndExp "&&" EqExp;
-class LAndExpAST : public BaseAST{
+class LAndExpAST : public AstNode<AST_LAND_EXP> {
     public:
         int type;
-        std::unique_ptr<BaseAST> eqexp;
-        std::unique_ptr<BaseAST> landexp;
+        BaseAST *eqexp;
+        BaseAST *landexp;
         logicop_t logicop;
-
-        void Dump() const override{
-            std::cout << "LAndExpAST { ";
-            if (type == 1) eqexp->Dump();
-            else if (type == 2) {
-                landexp->Dump();
-                std::cout << "logicop";
-                eqexp->Dump();
-            }
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override{
-            if (type == 1) return eqexp->KoopaIR();
-            else if (type == 2) {
-                ExprResult left = landexp->KoopaIR();
-                ExprResult right = eqexp->KoopaIR();
-                std::cout << "  %" << koopacnt << " = ";
-                
-                if (left.is_constant) std::cout << left.value << " && ";
-                else std::cout << "%" << left.value << " && ";
-                if (right.is_constant) std::cout << right.value << std::endl;
-                else std::cout << "%" << right.value << std::endl;
-
-                return ExprResult(false, koopacnt++);
-            }
-            return ExprResult();
-        }
 };
 
 // EqExp ::= RelExp | EqExp ("==" | "!=") RelExp;
-class EqExpAST : public BaseAST{
+class EqExpAST : public AstNode<AST_EQ_EXP> {
     public:
         int type;
-        std::unique_ptr<BaseAST> relexp;
-        std::unique_ptr<BaseAST> eqexp;
+        BaseAST *relexp;
+        BaseAST *eqexp;
         eqop_t eqop;
-
-        void Dump() const override{
-            std::cout << "EqExpAST { ";
-            if (type == 1) relexp->Dump();
-            else if (type == 2) {
-                eqexp->Dump();
-                std::cout << "relop";
-                relexp->Dump();
-            }
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override{
-            if (type == 1) return relexp->KoopaIR();
-            else if (type == 2){
-                ExprResult left = eqexp->KoopaIR();
-                ExprResult right = relexp->KoopaIR();
-                std::cout << "  %" << koopacnt << " = ";
-                switch (eqop) {
-                    case REL_EQ: std::cout << "eq "; break;
-                    case REL_NE: std::cout << "ne "; break;
-                }
-                if (left.is_constant) std::cout << left.value << ", ";
-                else std::cout << "%" << left.value << ", ";
-                if (right.is_constant) std::cout << right.value << std::endl;
-                else std::cout << "%" << right.value << std::endl;
-
-                return ExprResult(false, koopacnt++);
-            }
-            return ExprResult();
-        }
 };
 
 // RelExp ::= AddExp | RelExp ("<" | ">" | "<=" | ">=") AddExp;
-class RelExpAST : public BaseAST{
+class RelExpAST : public AstNode<AST_REL_EXP> {
     public:
         int type;
-        std::unique_ptr<BaseAST> addexp;
-        std::unique_ptr<BaseAST> relexp;
+        BaseAST *addexp;
+        BaseAST *relexp;
         relop_t relop;
-
-        void Dump() const override{
-            std::cout << "RelExpAST { ";
-            if (type == 1) addexp->Dump();
-            else if (type == 2){
-                relexp->Dump();
-                std::cout << " relop ";
-                addexp->Dump();
-            }
-            std::cout << " }";
-        }
-        
-        ExprResult KoopaIR() const override{
-            if (type == 1) return addexp->KoopaIR();
-            else if (type == 2) {
-                ExprResult left = relexp->KoopaIR();
-                ExprResult right = addexp->KoopaIR();
-                std::cout << "  %" << koopacnt << " = ";
-                switch(relop){
-                    case REL_LT: std::cout << "lt "; break;
-                    case REL_GT: std::cout << "gt "; break;
-                    case REL_LE: std::cout << "le "; break;
-                    case REL_GE: std::cout << "ge "; break;
-                }
-                if (left.is_constant) std::cout << left.value << ", ";
-                else std::cout << "%" << left.value << ", ";
-                if (right.is_constant) std::cout << right.value << std::endl;
-                else std::cout << "%" << right.value << std::endl;
-                return ExprResult(false, koopacnt++);
-            }
-            return ExprResult();
-        }
 };
 
 
 // AddExp ::= MulExp | AddExp ("+" | "-") MulExp;
-class AddExpAST : public BaseAST{
+class AddExpAST : public AstNode<AST_ADD_EXP> {
     public:
         int type;
-        std::unique_ptr<BaseAST> mulexp;
-        std::unique_ptr<BaseAST> addexp;
+        BaseAST *mulexp;
+        BaseAST *addexp;
         addop_t addop;
-
-        void Dump() const override{
-            std::cout << "AddExpAST { ";
-            if (type == 1) mulexp->Dump();
-            else if (type == 2){
-                addexp->Dump();
-                std::cout << "addop ";
-                mulexp->Dump();
-            }
-            std::cout << " }";
-            
-        }
-
-        ExprResult KoopaIR() const override{
-            if (type == 1) return mulexp->KoopaIR();
-            else if (type == 2) {
-                ExprResult left = addexp->KoopaIR();
-                ExprResult right = mulexp->KoopaIR();
-
-                if (left.is_constant && right.is_constant){
-                    switch (addop) {
-                        case ADD_OP: 
-                            return ExprResult(true, left.value+right.value);
-                            break;
-                        case SUB_OP: 
-                            return ExprResult(true, left.value-right.value);
-                            break;
-                    }
-                }
-
-                std::cout << "  %" << koopacnt << " = ";
-                switch(addop) {
-                    case ADD_OP: std::cout << "add "; break;
-                    case SUB_OP: std::cout << "sub "; break;
-                    
-                }
-                if (left.is_constant) std::cout << left.value;
-                else std::cout << "%" << left.value;
-                std::cout << ", ";
-                if (right.is_constant) std::cout << right.value;
-                else std::cout << "%" << right.value;
-                std::cout << std::endl;
-                return ExprResult(false, koopacnt++);
-            }
-            return ExprResult();
-        }
 };
 
 // MulExp ::= UnaryExp | MulExp ("*" | "/" | "%") UnaryExp;
-class MulExpAST : public BaseAST {
+class MulExpAST : public AstNode<AST_MUL_EXP> {
     public:
         int type;
-        std::unique_ptr<BaseAST> unaryexp;
-        std::unique_ptr<BaseAST> mulexp;
+        BaseAST *unaryexp;
+        BaseAST *mulexp;
         mulop_t mulop;
-
-        void Dump() const override{
-            std::cout << "MulExp { ";
-            if (type == 1) unaryexp->Dump();
-            else if (type == 2) {
-                mulexp->Dump();
-                std::cout << " " << mulop << " ";
-                unaryexp->Dump();
-            }
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override {
-            if (type == 1) return unaryexp->KoopaIR();
-            
-            ExprResult left = mulexp->KoopaIR();
-            ExprResult right = unaryexp->KoopaIR();
-
-            if (left.is_constant && right.is_constant){
-                switch (mulop) {
-                    case MUL_OP: 
-                        return ExprResult(true, left.value*right.value);
-                        break;
-                    case DIV_OP: 
-                        return ExprResult(true, left.value/right.value);
-                        break;
-                    case MOD_OP: 
-                        return ExprResult(true, left.value%right.value);
-                        break;
-                }
-            }
-
-
-            std::cout << "  %" << koopacnt << " = ";
-
-            switch(mulop){
-                case MUL_OP: std::cout << "mul "; break;
-                case DIV_OP: std::cout << "div "; break;
-                case MOD_OP: std::cout << "mod "; break;
-            }
-
-            if (left.is_constant) std::cout << left.value;
-            else std::cout << "%" << left.value;
-            std::cout << ", ";
-
-            if (right.is_constant) std::cout << right.value;
-            else std::cout << "%" << right.value;
-            std::cout << std::endl;
-
-            return ExprResult(false, koopacnt++);
-        }
 };
 
 // UnaryExp ::= PrimaryExp | UnaryOp UnaryExp;
-class UnaryExpAST : public BaseAST{
+class UnaryExpAST : public AstNode<AST_UNARY_EXP> {
     public:
-        std::unique_ptr<BaseAST> primaryexp_unaryexp;
+        BaseAST *primaryexp_unaryexp;
         unaryop_t unaryop;
         int type;
-        
-        void Dump() const override{
-            std::cout << "UnaryExpAST { ";
-            if (type == 1) primaryexp_unaryexp->Dump();
-            else if (type == 2) {
-                std::cout << unaryop << " ";
-                primaryexp_unaryexp->Dump();
-            }
-            
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override{
-            if (type == 1) return primaryexp_unaryexp->KoopaIR();
-            else if (type == 2){
-                ExprResult operand = primaryexp_unaryexp->KoopaIR();
-                if (unaryop == UNARY_PLUS) return operand;
-                std::cout <<  "  %" << koopacnt << " = ";
-                
-                switch(unaryop) {
-                    case UNARY_PLUS: break;
-                    case UNARY_MINUS:
-                        std::cout << "sub 0, ";
-                        break;
-                    case UNARY_NOT:
-                        std::cout << "eq 0, ";
-                }
-
-                if (operand.is_constant) {
-                    std::cout << operand.value;
-                } else {
-                    std::cout << "%" << operand.value;
-                }
-                std::cout << std::endl;
-                return ExprResult(false, koopacnt++);
-            }
-            return ExprResult();
-        }
 };
 
 // PrimaryExp ::= "(" Exp ")" | LVal | Number;
 // Number ::= INT_CONST;
-class PrimaryExpAST : public BaseAST{
+class PrimaryExpAST : public AstNode<AST_PRIMARY_EXP> {
     public:
         int type;
         std::int32_t number;
-        std::unique_ptr<BaseAST> exp_lval;
-
-        void Dump() const override{
-            std::cout << "PrimaryExpAST { ";
-            if (type == 1) exp_lval->Dump();
-            else if (type == 2) std::cout << "Number: " << number;
-            std::cout << " }";
-        }
-
-        ExprResult KoopaIR() const override{
-            if (type == 1) return exp_lval->KoopaIR();
-            else if (type == 2){
-                return ExprResult(true, number);
-            }
-            return ExprResult();
-        }
+        BaseAST *exp_lval;
 };
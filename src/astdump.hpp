@@ -0,0 +1,251 @@
+#pragma once
+#include "ast.hpp"
+#include "astvisitor.hpp"
+#include "astwriter.hpp"
+#include "interner.hpp"
+
+static const char *mulop_names[] = {"*", "/", "%"};
+static const char *unaryop_names[] = {"+", "-", "!"};
+static const char *relop_names[] = {"<", ">", "<=", ">="};
+static const char *binaryop_names[] = {"||", "&&", "==", "!=", "<", ">", "<=", ">=", "+", "-", "*", "/", "%"};
+
+// 通过 AstWriter 输出 AST, 每个节点描述自己的字段, 子节点递归输出
+class AstDumper : public AstVisitor<AstDumper> {
+    private:
+        AstWriter &w;
+
+        void List(const char *key, const ArenaSpan<BaseAST *> &items) {
+            w.Key(key);
+            w.BeginList();
+            for (const auto &item : items) Visit(item);
+            w.EndList();
+        }
+
+        // 包装链中的二元运算节点: type 1 只有一个子节点, type 2 带运算符
+        void Chain(const char *name, int type, const char *op, const BaseAST *lhs, const BaseAST *rhs) {
+            w.BeginNode(name);
+            if (type == 1) {
+                w.Key("exp");
+                Visit(rhs);
+            } else if (type == 2) {
+                w.Field("op", op);
+                w.Key("lhs");
+                Visit(lhs);
+                w.Key("rhs");
+                Visit(rhs);
+            }
+            w.EndNode();
+        }
+
+    public:
+        explicit AstDumper(AstWriter &w) : w(w) {}
+
+        void VisitCompUnit(const CompUnitAST &node) {
+            w.BeginNode("CompUnit");
+            w.Key("func_def");
+            Visit(node.func_def);
+            w.EndNode();
+        }
+
+        void VisitFuncDef(const FuncDefAST &node) {
+            w.BeginNode("FuncDef");
+            w.Key("func_type");
+            Visit(node.func_type);
+            w.Field("ident", interner.Name(node.ident));
+            w.Key("block");
+            Visit(node.block);
+            w.EndNode();
+        }
+
+        void VisitFuncType(const FuncTypeAST &node) {
+            w.BeginNode("FuncType");
+            w.Field("type", "int");
+            w.EndNode();
+        }
+
+        void VisitBlock(const BlockAST &node) {
+            w.BeginNode("Block");
+            List("items", node.blockitem_list);
+            w.EndNode();
+        }
+
+        void VisitBlockItem(const BlockItemAST &node) {
+            w.BeginNode("BlockItem");
+            w.Key("item");
+            Visit(node.decl_stmt);
+            w.EndNode();
+        }
+
+        void VisitDecl(const DeclAST &node) {
+            w.BeginNode("Decl");
+            w.Key("decl");
+            Visit(node.const_vardecl);
+            w.EndNode();
+        }
+
+        void VisitConstDecl(const ConstDeclAST &node) {
+            w.BeginNode("ConstDecl");
+            w.Key("btype");
+            Visit(node.btype);
+            List("defs", node.constdef_list);
+            w.EndNode();
+        }
+
+        void VisitConstDef(const ConstDefAST &node) {
+            w.BeginNode("ConstDef");
+            w.Field("ident", interner.Name(node.ident));
+            w.Key("init");
+            Visit(node.constintval);
+            w.EndNode();
+        }
+
+        void VisitConstInitVal(const ConstInitValAST &node) {
+            w.BeginNode("ConstInitVal");
+            w.Key("exp");
+            Visit(node.constexp);
+            w.EndNode();
+        }
+
+        void VisitConstExp(const ConstExpAST &node) {
+            w.BeginNode("ConstExp");
+            w.Key("exp");
+            Visit(node.exp);
+            w.EndNode();
+        }
+
+        void VisitVarDecl(const VarDeclAST &node) {
+            w.BeginNode("VarDecl");
+            w.Key("btype");
+            Visit(node.btype);
+            List("defs", node.vardef_list);
+            w.EndNode();
+        }
+
+        void VisitVarDef(const VarDefAST &node) {
+            w.BeginNode("VarDef");
+            w.Field("ident", interner.Name(node.ident));
+            if (node.type == 2) {
+                w.Key("init");
+                Visit(node.initval);
+            }
+            w.EndNode();
+        }
+
+        void VisitInitVal(const InitValAST &node) {
+            w.BeginNode("InitVal");
+            w.Key("exp");
+            Visit(node.exp);
+            w.EndNode();
+        }
+
+        void VisitBType(const BTypeAST &node) {
+            w.BeginNode("BType");
+            w.Field("type", "int");
+            w.EndNode();
+        }
+
+        void VisitBinaryExpr(const BinaryExprAST &node) {
+            w.BeginNode("BinaryExpr");
+            w.Field("op", binaryop_names[node.op]);
+            w.Key("lhs");
+            Visit(node.lhs);
+            w.Key("rhs");
+            Visit(node.rhs);
+            w.EndNode();
+        }
+
+        void VisitUnaryExpr(const UnaryExprAST &node) {
+            w.BeginNode("UnaryExpr");
+            w.Field("op", unaryop_names[node.op]);
+            w.Key("exp");
+            Visit(node.operand);
+            w.EndNode();
+        }
+
+        void VisitLiteral(const LiteralAST &node) {
+            w.BeginNode("Literal");
+            w.Field("value", node.value);
+            w.EndNode();
+        }
+
+        void VisitVarRef(const VarRefAST &node) {
+            w.BeginNode("VarRef");
+            w.Field("ident", interner.Name(node.ident));
+            w.EndNode();
+        }
+
+        void VisitLVal(const LValAST &node) {
+            w.BeginNode("LVal");
+            w.Field("ident", interner.Name(node.ident));
+            w.EndNode();
+        }
+
+        void VisitStmt(const StmtAST &node) {
+            w.BeginNode("Stmt");
+            static const char *kinds[] = {"", "assign", "return", "block", "exp"};
+            w.Field("type", kinds[node.type]);
+            if (node.type == 1) {
+                w.Key("lval");
+                Visit(node.lval);
+            }
+            if (node.type == 3) {
+                w.Key("block");
+                Visit(node.block);
+            }
+            if (node.exp) {
+                w.Key("exp");
+                Visit(node.exp);
+            }
+            w.EndNode();
+        }
+
+        void VisitExp(const ExpAST &node) {
+            w.BeginNode("Exp");
+            w.Key("exp");
+            Visit(node.lorexp);
+            w.EndNode();
+        }
+
+        void VisitLOrExp(const LOrExpAST &node) {
+            Chain("LOrExp", node.type, "||", node.lorexp, node.landexp);
+        }
+
+        void VisitLAndExp(const LAndExpAST &node) {
+            Chain("LAndExp", node.type, "&&", node.landexp, node.eqexp);
+        }
+
+        void VisitEqExp(const EqExpAST &node) {
+            Chain("EqExp", node.type, node.eqop == REL_EQ ? "==" : "!=", node.eqexp, node.relexp);
+        }
+
+        void VisitRelExp(const RelExpAST &node) {
+            Chain("RelExp", node.type, relop_names[node.relop], node.relexp, node.addexp);
+        }
+
+        void VisitAddExp(const AddExpAST &node) {
+            Chain("AddExp", node.type, node.addop == ADD_OP ? "+" : "-", node.addexp, node.mulexp);
+        }
+
+        void VisitMulExp(const MulExpAST &node) {
+            Chain("MulExp", node.type, mulop_names[node.mulop], node.mulexp, node.unaryexp);
+        }
+
+        void VisitUnaryExp(const UnaryExpAST &node) {
+            w.BeginNode("UnaryExp");
+            if (node.type == 2) w.Field("op", unaryop_names[node.unaryop]);
+            w.Key("exp");
+            Visit(node.primaryexp_unaryexp);
+            w.EndNode();
+        }
+
+        void VisitPrimaryExp(const PrimaryExpAST &node) {
+            w.BeginNode("PrimaryExp");
+            if (node.type == 1) {
+                w.Key("exp");
+                Visit(node.exp_lval);
+            } else if (node.type == 2) {
+                w.Field("number", node.number);
+            }
+            w.EndNode();
+        }
+};
@@ -0,0 +1,200 @@
+#pragma once
+#include "arena.hpp"
+#include "ast.hpp"
+#include "astvisitor.hpp"
+
+// 把 AST 复制到另一个 arena 中: 去掉只有一个子节点的包装层, 表达式改写为扁平节点, 生成的 IR 不变.
+// 节点按先序分配, 化简后的树在内存中的顺序就是遍历的顺序
+class AstSimplifier : public AstVisitor<AstSimplifier, BaseAST *> {
+    private:
+        Arena &arena;
+
+        ArenaSpan<BaseAST *> List(const ArenaSpan<BaseAST *> &span) {
+            ArenaSpan<BaseAST *> simplified;
+            simplified.data = arena.NewArray<BaseAST *>(span.size);
+            simplified.size = span.size;
+            for (uint32_t i = 0; i < span.size; ++i) simplified.data[i] = Visit(span.data[i]);
+            return simplified;
+        }
+
+        // 包装链中的二元运算节点化简后的形式
+        BaseAST *Binary(binaryop_t op, const BaseAST *lhs, const BaseAST *rhs) {
+            auto binary = arena.New<BinaryExprAST>();
+            binary->op = op;
+            binary->lhs = Visit(lhs);
+            binary->rhs = Visit(rhs);
+            return binary;
+        }
+
+    public:
+        explicit AstSimplifier(Arena &arena) : arena(arena) {}
+
+        BaseAST *VisitCompUnit(const CompUnitAST &node) {
+            auto comp_unit = arena.New<CompUnitAST>();
+            comp_unit->func_def = Visit(node.func_def);
+            return comp_unit;
+        }
+
+        BaseAST *VisitFuncDef(const FuncDefAST &node) {
+            auto func_def = arena.New<FuncDefAST>();
+            func_def->func_type = Visit(node.func_type);
+            func_def->ident = node.ident;
+            func_def->block = Visit(node.block);
+            return func_def;
+        }
+
+        BaseAST *VisitFuncType(const FuncTypeAST &node) {
+            return arena.New<FuncTypeAST>();
+        }
+
+        BaseAST *VisitBlock(const BlockAST &node) {
+            auto block = arena.New<BlockAST>();
+            block->blockitem_list = List(node.blockitem_list);
+            return block;
+        }
+
+        BaseAST *VisitBlockItem(const BlockItemAST &node) {
+            return Visit(node.decl_stmt);
+        }
+
+        BaseAST *VisitDecl(const DeclAST &node) {
+            return Visit(node.const_vardecl);
+        }
+
+        BaseAST *VisitConstDecl(const ConstDeclAST &node) {
+            auto constdecl = arena.New<ConstDeclAST>();
+            constdecl->btype = Visit(node.btype);
+            constdecl->constdef_list = List(node.constdef_list);
+            return constdecl;
+        }
+
+        BaseAST *VisitConstDef(const ConstDefAST &node) {
+            auto constdef = arena.New<ConstDefAST>();
+            constdef->ident = node.ident;
+            constdef->constintval = Visit(node.constintval);
+            return constdef;
+        }
+
+        BaseAST *VisitConstInitVal(const ConstInitValAST &node) {
+            return Visit(node.constexp);
+        }
+
+        BaseAST *VisitConstExp(const ConstExpAST &node) {
+            return Visit(node.exp);
+        }
+
+        BaseAST *VisitVarDecl(const VarDeclAST &node) {
+            auto vardecl = arena.New<VarDeclAST>();
+            vardecl->btype = Visit(node.btype);
+            vardecl->vardef_list = List(node.vardef_list);
+            return vardecl;
+        }
+
+        BaseAST *VisitVarDef(const VarDefAST &node) {
+            auto vardef = arena.New<VarDefAST>();
+            vardef->ident = node.ident;
+            vardef->type = node.type;
+            if (node.type == 2) vardef->initval = Visit(node.initval);
+            return vardef;
+        }
+
+        BaseAST *VisitInitVal(const InitValAST &node) {
+            return Visit(node.exp);
+        }
+
+        BaseAST *VisitBType(const BTypeAST &node) {
+            return arena.New<BTypeAST>();
+        }
+
+        BaseAST *VisitBinaryExpr(const BinaryExprAST &node) {
+            return Binary(node.op, node.lhs, node.rhs);
+        }
+
+        BaseAST *VisitUnaryExpr(const UnaryExprAST &node) {
+            auto unary = arena.New<UnaryExprAST>();
+            unary->op = node.op;
+            unary->operand = Visit(node.operand);
+            return unary;
+        }
+
+        BaseAST *VisitLiteral(const LiteralAST &node) {
+            auto literal = arena.New<LiteralAST>();
+            literal->value = node.value;
+            return literal;
+        }
+
+        BaseAST *VisitVarRef(const VarRefAST &node) {
+            auto var_ref = arena.New<VarRefAST>();
+            var_ref->ident = node.ident;
+            return var_ref;
+        }
+
+        // 表达式中的 LVal 是对变量的引用; 赋值语句的左边由 VisitStmt 单独复制
+        BaseAST *VisitLVal(const LValAST &node) {
+            auto var_ref = arena.New<VarRefAST>();
+            var_ref->ident = node.ident;
+            return var_ref;
+        }
+
+        BaseAST *VisitStmt(const StmtAST &node) {
+            auto stmt = arena.New<StmtAST>();
+            stmt->type = node.type;
+            if (node.type == 1) {
+                auto lval = arena.New<LValAST>();
+                lval->ident = static_cast<const LValAST *>(node.lval)->ident;
+                stmt->lval = lval;
+            }
+            if (node.exp) stmt->exp = Visit(node.exp);
+            if (node.type == 3) stmt->block = Visit(node.block);
+            return stmt;
+        }
+
+        BaseAST *VisitExp(const ExpAST &node) {
+            return Visit(node.lorexp);
+        }
+
+        BaseAST *VisitLOrExp(const LOrExpAST &node) {
+            if (node.type == 1) return Visit(node.landexp);
+            return Binary(BINARY_LOR, node.lorexp, node.landexp);
+        }
+
+        BaseAST *VisitLAndExp(const LAndExpAST &node) {
+            if (node.type == 1) return Visit(node.eqexp);
+            return Binary(BINARY_LAND, node.landexp, node.eqexp);
+        }
+
+        BaseAST *VisitEqExp(const EqExpAST &node) {
+            if (node.type == 1) return Visit(node.relexp);
+            return Binary(node.eqop == REL_EQ ? BINARY_EQ : BINARY_NE, node.eqexp, node.relexp);
+        }
+
+        BaseAST *VisitRelExp(const RelExpAST &node) {
+            if (node.type == 1) return Visit(node.addexp);
+            return Binary(static_cast<binaryop_t>(BINARY_LT + node.relop), node.relexp, node.addexp);
+        }
+
+        BaseAST *VisitAddExp(const AddExpAST &node) {
+            if (node.type == 1) return Visit(node.mulexp);
+            return Binary(node.addop == ADD_OP ? BINARY_ADD : BINARY_SUB, node.addexp, node.mulexp);
+        }
+
+        BaseAST *VisitMulExp(const MulExpAST &node) {
+            if (node.type == 1) return Visit(node.unaryexp);
+            return Binary(static_cast<binaryop_t>(BINARY_MUL + node.mulop), node.mulexp, node.unaryexp);
+        }
+
+        BaseAST *VisitUnaryExp(const UnaryExpAST &node) {
+            if (node.type == 1) return Visit(node.primaryexp_unaryexp);
+            auto unary = arena.New<UnaryExprAST>();
+            unary->op = node.unaryop;
+            unary->operand = Visit(node.primaryexp_unaryexp);
+            return unary;
+        }
+
+        BaseAST *VisitPrimaryExp(const PrimaryExpAST &node) {
+            if (node.type == 1) return Visit(node.exp_lval);
+            auto literal = arena.New<LiteralAST>();
+            literal->value = node.number;
+            return literal;
+        }
+};
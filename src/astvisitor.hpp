@@ -0,0 +1,83 @@
+#pragma once
+#include<assert.h>
+#include "ast.hpp"
+
+// 按节点种类分派的 AST 访问者. 派生类以自身为模板参数, 只定义关心的 VisitXxx,
+// 没有定义的种类交给 VisitNode. Visit 对 kind 做一次 switch 后静态调用派生类的方法,
+// 不经过虚函数, 新的遍历也不需要在每个节点类中增加方法.
+template<typename Derived, typename R = void>
+class AstVisitor {
+    public:
+        R Visit(const BaseAST *node) {
+            switch (node->kind) {
+                case AST_COMP_UNIT: return Self().VisitCompUnit(static_cast<const CompUnitAST &>(*node));
+                case AST_FUNC_DEF: return Self().VisitFuncDef(static_cast<const FuncDefAST &>(*node));
+                case AST_FUNC_TYPE: return Self().VisitFuncType(static_cast<const FuncTypeAST &>(*node));
+                case AST_BLOCK: return Self().VisitBlock(static_cast<const BlockAST &>(*node));
+                case AST_BLOCK_ITEM: return Self().VisitBlockItem(static_cast<const BlockItemAST &>(*node));
+                case AST_DECL: return Self().VisitDecl(static_cast<const DeclAST &>(*node));
+                case AST_CONST_DECL: return Self().VisitConstDecl(static_cast<const ConstDeclAST &>(*node));
+                case AST_CONST_DEF: return Self().VisitConstDef(static_cast<const ConstDefAST &>(*node));
+                case AST_CONST_INIT_VAL: return Self().VisitConstInitVal(static_cast<const ConstInitValAST &>(*node));
+                case AST_CONST_EXP: return Self().VisitConstExp(static_cast<const ConstExpAST &>(*node));
+                case AST_VAR_DECL: return Self().VisitVarDecl(static_cast<const VarDeclAST &>(*node));
+                case AST_VAR_DEF: return Self().VisitVarDef(static_cast<const VarDefAST &>(*node));
+                case AST_INIT_VAL: return Self().VisitInitVal(static_cast<const InitValAST &>(*node));
+                case AST_BTYPE: return Self().VisitBType(static_cast<const BTypeAST &>(*node));
+                case AST_BINARY_EXPR: return Self().VisitBinaryExpr(static_cast<const BinaryExprAST &>(*node));
+                case AST_UNARY_EXPR: return Self().VisitUnaryExpr(static_cast<const UnaryExprAST &>(*node));
+                case AST_LITERAL: return Self().VisitLiteral(static_cast<const LiteralAST &>(*node));
+                case AST_VAR_REF: return Self().VisitVarRef(static_cast<const VarRefAST &>(*node));
+                case AST_LVAL: return Self().VisitLVal(static_cast<const LValAST &>(*node));
+                case AST_STMT: return Self().VisitStmt(static_cast<const StmtAST &>(*node));
+                case AST_EXP: return Self().VisitExp(static_cast<const ExpAST &>(*node));
+                case AST_LOR_EXP: return Self().VisitLOrExp(static_cast<const LOrExpAST &>(*node));
+                case AST_LAND_EXP: return Self().VisitLAndExp(static_cast<const LAndExpAST &>(*node));
+                case AST_EQ_EXP: return Self().VisitEqExp(static_cast<const EqExpAST &>(*node));
+                case AST_REL_EXP: return Self().VisitRelExp(static_cast<const RelExpAST &>(*node));
+                case AST_ADD_EXP: return Self().VisitAddExp(static_cast<const AddExpAST &>(*node));
+                case AST_MUL_EXP: return Self().VisitMulExp(static_cast<const MulExpAST &>(*node));
+                case AST_UNARY_EXP: return Self().VisitUnaryExp(static_cast<const UnaryExpAST &>(*node));
+                case AST_PRIMARY_EXP: return Self().VisitPrimaryExp(static_cast<const PrimaryExpAST &>(*node));
+                case AST_KIND_NUM: break;
+            }
+            assert(false);
+            return R();
+        }
+
+        // 派生类没有处理的种类
+        R VisitNode(const BaseAST &node) { return R(); }
+
+        R VisitCompUnit(const CompUnitAST &node) { return Self().VisitNode(node); }
+        R VisitFuncDef(const FuncDefAST &node) { return Self().VisitNode(node); }
+        R VisitFuncType(const FuncTypeAST &node) { return Self().VisitNode(node); }
+        R VisitBlock(const BlockAST &node) { return Self().VisitNode(node); }
+        R VisitBlockItem(const BlockItemAST &node) { return Self().VisitNode(node); }
+        R VisitDecl(const DeclAST &node) { return Self().VisitNode(node); }
+        R VisitConstDecl(const ConstDeclAST &node) { return Self().VisitNode(node); }
+        R VisitConstDef(const ConstDefAST &node) { return Self().VisitNode(node); }
+        R VisitConstInitVal(const ConstInitValAST &node) { return Self().VisitNode(node); }
+        R VisitConstExp(const ConstExpAST &node) { return Self().VisitNode(node); }
+        R VisitVarDecl(const VarDeclAST &node) { return Self().VisitNode(node); }
+        R VisitVarDef(const VarDefAST &node) { return Self().VisitNode(node); }
+        R VisitInitVal(const InitValAST &node) { return Self().VisitNode(node); }
+        R VisitBType(const BTypeAST &node) { return Self().VisitNode(node); }
+        R VisitBinaryExpr(const BinaryExprAST &node) { return Self().VisitNode(node); }
+        R VisitUnaryExpr(const UnaryExprAST &node) { return Self().VisitNode(node); }
+        R VisitLiteral(const LiteralAST &node) { return Self().VisitNode(node); }
+        R VisitVarRef(const VarRefAST &node) { return Self().VisitNode(node); }
+        R VisitLVal(const LValAST &node) { return Self().VisitNode(node); }
+        R VisitStmt(const StmtAST &node) { return Self().VisitNode(node); }
+        R VisitExp(const ExpAST &node) { return Self().VisitNode(node); }
+        R VisitLOrExp(const LOrExpAST &node) { return Self().VisitNode(node); }
+        R VisitLAndExp(const LAndExpAST &node) { return Self().VisitNode(node); }
+        R VisitEqExp(const EqExpAST &node) { return Self().VisitNode(node); }
+        R VisitRelExp(const RelExpAST &node) { return Self().VisitNode(node); }
+        R VisitAddExp(const AddExpAST &node) { return Self().VisitNode(node); }
+        R VisitMulExp(const MulExpAST &node) { return Self().VisitNode(node); }
+        R VisitUnaryExp(const UnaryExpAST &node) { return Self().VisitNode(node); }
+        R VisitPrimaryExp(const PrimaryExpAST &node) { return Self().VisitNode(node); }
+
+    private:
+        Derived &Self() { return static_cast<Derived &>(*this); }
+};
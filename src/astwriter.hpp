@@ -0,0 +1,107 @@
+#pragma once
+#include<cstdint>
+#include<string_view>
+#include<vector>
+#include "emitter.hpp"
+
+typedef enum {
+    AST_FORMAT_TEXT,    // 便于阅读的缩进文本
+    AST_FORMAT_JSON,    // 每个节点是一个对象, "kind" 为节点类型
+    AST_FORMAT_SEXPR    // (Kind :field value ...)
+} ast_format_t;
+
+// 结构化输出 AST: 节点通过 BeginNode/Field/Key/EndNode 描述自己,
+// 具体格式由 format 决定, 全部写入一个 Emitter
+class AstWriter {
+    private:
+        Emitter &out;
+        ast_format_t format;
+        std::vector<uint32_t> list_items;   // 嵌套列表中已输出的元素个数
+        bool after_key = false;             // 刚输出字段名, 下一个值直接跟在后面
+        int depth = 0;
+
+        void Indent() {
+            out << '\n';
+            for (int i = 0; i < depth; ++i) out << "  ";
+        }
+
+        // 值出现在列表中时补上分隔符
+        void BeginValue() {
+            if (after_key) {
+                after_key = false;
+                return;
+            }
+            if (!list_items.empty() && list_items.back()++ > 0) {
+                if (format == AST_FORMAT_JSON) out << ", ";
+                else if (format == AST_FORMAT_SEXPR) out << ' ';
+            }
+            if (format == AST_FORMAT_TEXT && !list_items.empty()) Indent();
+        }
+
+        void Name(const char *name) {
+            switch (format) {
+                case AST_FORMAT_TEXT:
+                    Indent();
+                    out << name << ": ";
+                    break;
+                case AST_FORMAT_JSON:
+                    out << ", \"" << name << "\": ";
+                    break;
+                case AST_FORMAT_SEXPR:
+                    out << " :" << name << ' ';
+                    break;
+            }
+        }
+
+    public:
+        AstWriter(Emitter &out, ast_format_t format) : out(out), format(format) {}
+
+        void BeginNode(const char *kind) {
+            BeginValue();
+            switch (format) {
+                case AST_FORMAT_TEXT: out << kind; break;
+                case AST_FORMAT_JSON: out << "{\"kind\": \"" << kind << '"'; break;
+                case AST_FORMAT_SEXPR: out << '(' << kind; break;
+            }
+            ++depth;
+        }
+
+        void EndNode() {
+            --depth;
+            if (format == AST_FORMAT_JSON) out << '}';
+            else if (format == AST_FORMAT_SEXPR) out << ')';
+        }
+
+        // 字段名, 其后紧跟一个子节点或列表
+        void Key(const char *name) {
+            Name(name);
+            after_key = true;
+        }
+
+        void Field(const char *name, int64_t value) {
+            Name(name);
+            out << value;
+        }
+
+        // 标识符和运算符, 在 JSON 中带引号
+        void Field(const char *name, std::string_view value) {
+            Name(name);
+            if (format == AST_FORMAT_JSON) out << '"' << value << '"';
+            else out << value;
+        }
+
+        void BeginList() {
+            BeginValue();
+            out << (format == AST_FORMAT_SEXPR ? '(' : '[');
+            list_items.push_back(0);
+            ++depth;
+        }
+
+        void EndList() {
+            --depth;
+            bool empty = list_items.back() == 0;
+            list_items.pop_back();
+            if (format == AST_FORMAT_TEXT && !empty) Indent();
+            out << (format == AST_FORMAT_SEXPR ? ')' : ']');
+        }
+};
@@ -0,0 +1,134 @@
+#pragma once
+#include<cassert>
+#include<cstdint>
+#include<vector>
+#include "ir.hpp"
+
+// 控制流图与支配关系, 供各个 IR 变换共用
+
+// 对指令的每个操作数调用 f, 并用 f 的返回值替换该操作数
+template<typename F>
+static void RewriteOperands(IrFunction &fn, ValueId inst, F f) {
+    for (auto &operand : fn.Operands(inst)) operand = f(operand);
+}
+
+// 跳转到 target 时传递的参数; 条件分支两边都跳到 target 时分别修改
+template<typename F>
+static void ForEachEdgeArgs(IrFunction &fn, ValueId terminator, BlockId target, F f) {
+    auto op = fn[terminator].op;
+    int edges = op == IR_BRANCH ? 2 : op == IR_JUMP ? 1 : 0;
+    for (int which = 0; which < edges; ++which) {
+        if (fn[terminator].targets[which] != target) continue;
+        auto args = fn.EdgeArgs(terminator, which);
+        f(args);
+        fn.SetEdgeArgs(terminator, which, args);
+    }
+}
+
+// 一个函数的控制流图, 各数组按 BlockId 索引; 不在布局中的基本块没有边.
+// 支配树用 Cooper-Harvey-Kennedy 的迭代算法计算, 只覆盖从入口可达的基本块.
+struct ControlFlowGraph {
+    static constexpr uint32_t kNone = kNoId;
+
+    std::vector<BlockId> blocks;                    // 布局中的基本块, 与 IrFunction::layout 相同
+    std::vector<std::vector<uint32_t>> succs;
+    std::vector<std::vector<uint32_t>> preds;
+    std::vector<uint32_t> rpo;                      // 可达基本块的逆后序
+    std::vector<uint32_t> idom;                     // 不可达的基本块为 kNone, 入口的 idom 是自己
+    std::vector<std::vector<uint32_t>> dom_children;
+
+    bool Reachable(uint32_t b) const { return idom[b] != kNone; }
+
+    // 支配边界, 只包含可达的基本块
+    std::vector<std::vector<uint32_t>> DominanceFrontiers() const {
+        std::vector<std::vector<uint32_t>> frontier(succs.size());
+        for (auto b : rpo) {
+            uint32_t reachable_preds = 0;
+            for (auto p : preds[b]) reachable_preds += Reachable(p);
+            if (reachable_preds < 2) continue;
+            for (auto p : preds[b]) {
+                if (!Reachable(p)) continue;
+                for (uint32_t runner = p; runner != idom[b]; runner = idom[runner]) {
+                    auto &df = frontier[runner];
+                    if (df.empty() || df.back() != b) df.push_back(b);
+                }
+            }
+        }
+        return frontier;
+    }
+};
+
+static ControlFlowGraph BuildCfg(const IrFunction &fn) {
+    ControlFlowGraph cfg;
+    size_t n = fn.blocks.size();
+    cfg.blocks = fn.layout;
+    cfg.succs.resize(n);
+    cfg.preds.resize(n);
+    for (auto b : cfg.blocks) {
+        BlockId succs[2];
+        uint32_t succ_cnt = fn.Successors(b, succs);
+        for (uint32_t i = 0; i < succ_cnt; ++i) {
+            auto s = succs[i];
+            // br 的两个目标相同时只记一条边
+            if (!cfg.succs[b].empty() && cfg.succs[b].back() == s) continue;
+            cfg.succs[b].push_back(s);
+            cfg.preds[s].push_back(b);
+        }
+    }
+
+    cfg.idom.assign(n, ControlFlowGraph::kNone);
+    cfg.dom_children.resize(n);
+    if (cfg.blocks.empty()) return cfg;
+    BlockId entry = fn.Entry();
+
+    // 非递归 DFS 求后序
+    std::vector<uint32_t> post, order(n, 0);
+    std::vector<bool> visited(n, false);
+    std::vector<std::pair<uint32_t, size_t>> stack{{entry, 0}};
+    visited[entry] = true;
+    while (!stack.empty()) {
+        auto &[b, next] = stack.back();
+        if (next < cfg.succs[b].size()) {
+            auto s = cfg.succs[b][next++];
+            if (!visited[s]) {
+                visited[s] = true;
+                stack.push_back({s, 0});
+            }
+        } else {
+            post.push_back(b);
+            stack.pop_back();
+        }
+    }
+    cfg.rpo.assign(post.rbegin(), post.rend());
+    for (size_t i = 0; i < cfg.rpo.size(); ++i) order[cfg.rpo[i]] = i;
+
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while (a != b) {
+            while (order[a] > order[b]) a = cfg.idom[a];
+            while (order[b] > order[a]) b = cfg.idom[b];
+        }
+        return a;
+    };
+    cfg.idom[entry] = entry;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < cfg.rpo.size(); ++i) {
+            auto b = cfg.rpo[i];
+            uint32_t new_idom = ControlFlowGraph::kNone;
+            for (auto p : cfg.preds[b]) {
+                if (cfg.idom[p] == ControlFlowGraph::kNone) continue;
+                new_idom = new_idom == ControlFlowGraph::kNone ? p : intersect(p, new_idom);
+            }
+            if (cfg.idom[b] != new_idom) {
+                cfg.idom[b] = new_idom;
+                changed = true;
+            }
+        }
+    }
+    for (size_t i = 1; i < cfg.rpo.size(); ++i) {
+        auto b = cfg.rpo[i];
+        cfg.dom_children[cfg.idom[b]].push_back(b);
+    }
+    return cfg;
+}
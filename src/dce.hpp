@@ -0,0 +1,138 @@
+#pragma once
+#include<algorithm>
+#include<cstdint>
+#include<utility>
+#include<vector>
+#include "cfg.hpp"
+#include "ir.hpp"
+
+// 激进的死代码删除. 先从布局中删去入口不可达的基本块, 再从终结指令出发标记活跃的值:
+// 活跃指令的操作数活跃; 基本块参数活跃时各条入边上对应的实参活跃;
+// alloc 只有被活跃的 load 读取时, 写入它的 store 才活跃. 未被标记的指令和参数删去.
+// load 和 binary 都视为没有副作用 (除以 0 在 SysY 中是未定义行为).
+
+class DcePass {
+    private:
+        IrFunction *fn = nullptr;
+        std::vector<bool> live;                                 // 按 ValueId 索引
+        std::vector<ValueId> worklist;
+        std::vector<std::vector<ValueId>> stores_to;            // alloc -> 写入它的 store
+        std::vector<std::vector<std::pair<ValueId, int>>> incoming;    // 基本块 -> (终结指令, 第几个目标)
+
+        void Mark(ValueId value) {
+            if (live[value] || (*fn)[value].IsConstant()) return;
+            live[value] = true;
+            worklist.push_back(value);
+        }
+
+        // 跳转指令的实参只在对应参数活跃时才需要, 不在这里标记
+        void MarkOperands(ValueId inst) {
+            const auto &value = (*fn)[inst];
+            auto operands = fn->Operands(inst);
+            switch (value.op) {
+                case IR_BRANCH:
+                    Mark(operands[0]);
+                    break;
+                case IR_JUMP:
+                    break;
+                case IR_LOAD:
+                    // 第一次读到某个 alloc 时, 写入它的 store 都变为活跃
+                    if (!live[operands[0]]) {
+                        for (auto store : stores_to[operands[0]]) Mark(store);
+                    }
+                    Mark(operands[0]);
+                    break;
+                default:
+                    for (auto operand : operands) Mark(operand);
+                    break;
+            }
+        }
+
+        void MarkParam(ValueId param) {
+            const auto &value = (*fn)[param];
+            for (const auto &edge : incoming[value.block]) Mark(fn->EdgeArgs(edge.first, edge.second)[value.imm]);
+        }
+
+        bool RemoveUnreachable(const ControlFlowGraph &cfg) {
+            auto &layout = fn->layout;
+            size_t size = layout.size();
+            layout.erase(std::remove_if(layout.begin(), layout.end(),
+                                        [&](BlockId b) { return !cfg.Reachable(b); }), layout.end());
+            return layout.size() != size;
+        }
+
+        void Propagate() {
+            live.assign(fn->values.size(), false);
+            stores_to.assign(fn->values.size(), {});
+            incoming.assign(fn->blocks.size(), {});
+            worklist.clear();
+            for (auto b : fn->layout) {
+                for (auto inst : fn->blocks[b].insts) {
+                    const auto &value = (*fn)[inst];
+                    if (value.op == IR_STORE) {
+                        auto dest = fn->Operands(inst)[1];
+                        // 只追踪 alloc; 其他指针 (将来的全局变量等) 上的 store 保守地保留
+                        if ((*fn)[dest].op == IR_ALLOC) stores_to[dest].push_back(inst);
+                        else Mark(inst);
+                    } else if (value.IsTerminator()) {
+                        Mark(inst);
+                        int edges = value.op == IR_BRANCH ? 2 : value.op == IR_JUMP ? 1 : 0;
+                        for (int which = 0; which < edges; ++which) incoming[value.targets[which]].emplace_back(inst, which);
+                    }
+                }
+            }
+            while (!worklist.empty()) {
+                auto value = worklist.back();
+                worklist.pop_back();
+                if ((*fn)[value].op == IR_PARAM) MarkParam(value);
+                else MarkOperands(value);
+            }
+        }
+
+        bool Sweep() {
+            bool changed = false;
+            for (auto b : fn->layout) {
+                auto &insts = fn->blocks[b].insts;
+                size_t size = insts.size();
+                insts.erase(std::remove_if(insts.begin(), insts.end(),
+                                           [&](ValueId inst) { return !live[inst]; }), insts.end());
+                changed |= insts.size() != size;
+            }
+
+            // 删去死参数和各条入边上对应的实参, 剩下的参数重新编号
+            for (auto b : fn->layout) {
+                auto &params = fn->blocks[b].params;
+                std::vector<bool> keep(params.size());
+                size_t len = 0;
+                for (size_t i = 0; i < params.size(); ++i) {
+                    keep[i] = live[params[i]];
+                    if (!keep[i]) continue;
+                    (*fn)[params[i]].imm = len;
+                    params[len++] = params[i];
+                }
+                if (len == params.size()) continue;
+                params.resize(len);
+                changed = true;
+                for (const auto &edge : incoming[b]) {
+                    auto args = fn->EdgeArgs(edge.first, edge.second);
+                    size_t kept = 0;
+                    for (size_t i = 0; i < args.size(); ++i) {
+                        if (keep[i]) args[kept++] = args[i];
+                    }
+                    args.resize(kept);
+                    fn->SetEdgeArgs(edge.first, edge.second, args);
+                }
+            }
+            return changed;
+        }
+
+    public:
+        // 返回是否修改了 IR, 修改后控制流图和使用者列表都失效
+        bool Run(IrFunction &func, const ControlFlowGraph &cfg) {
+            fn = &func;
+            bool changed = RemoveUnreachable(cfg);
+            Propagate();
+            changed |= Sweep();
+            return changed;
+        }
+};
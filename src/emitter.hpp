@@ -0,0 +1,121 @@
+#pragma once
+#include<cerrno>
+#include<cstdint>
+#include<cstdio>
+#include<cstring>
+#include<string>
+#include<string_view>
+#include<type_traits>
+#include<unistd.h>
+
+// 只追加的输出缓冲: Koopa 文本, 汇编和 AST 都先写入这里.
+// 整数自行格式化, 不经过 locale, 也不会逐行刷新.
+// 构造时给出文件描述符的 Emitter 是流式的: 缓冲攒到 kFlushSize 就写出, 不保留整个程序的文本.
+class Emitter {
+    private:
+        static constexpr size_t kFlushSize = 1 << 16;
+
+        std::string buf;
+        int fd = -1;
+        size_t limit = SIZE_MAX;        // 缓冲达到这个长度时写出, 非流式时不会达到
+        bool failed = false;
+
+        bool WriteAll(const char *data, size_t size) {
+            while (size && !failed) {
+                ssize_t written = ::write(fd, data, size);
+                if (written < 0) {
+                    failed = errno != EINTR;
+                    continue;
+                }
+                data += written;
+                size -= written;
+            }
+            return !failed;
+        }
+
+        void FlushIfFull() {
+            if (buf.size() >= limit) Flush();
+        }
+
+        void AppendUnsigned(uint64_t value) {
+            char tmp[20];
+            char *p = tmp + sizeof(tmp);
+            do {
+                *--p = '0' + value % 10;
+                value /= 10;
+            } while (value);
+            buf.append(p, tmp + sizeof(tmp) - p);
+        }
+
+    public:
+        Emitter() = default;
+        explicit Emitter(int fd) : fd(fd), limit(kFlushSize) { buf.reserve(kFlushSize); }
+
+        Emitter &operator<<(char c) {
+            buf.push_back(c);
+            FlushIfFull();
+            return *this;
+        }
+
+        Emitter &operator<<(const char *str) {
+            buf.append(str);
+            FlushIfFull();
+            return *this;
+        }
+
+        Emitter &operator<<(std::string_view str) {
+            buf.append(str.data(), str.size());
+            FlushIfFull();
+            return *this;
+        }
+
+        Emitter &operator<<(const std::string &str) {
+            buf.append(str);
+            FlushIfFull();
+            return *this;
+        }
+
+        template<typename T, typename = std::enable_if_t<std::is_integral<T>::value>>
+        Emitter &operator<<(T value) {
+            if constexpr (std::is_signed<T>::value) {
+                if (value < 0) {
+                    buf.push_back('-');
+                    AppendUnsigned(0 - static_cast<uint64_t>(value));
+                    FlushIfFull();
+                    return *this;
+                }
+            }
+            AppendUnsigned(static_cast<uint64_t>(value));
+            FlushIfFull();
+            return *this;
+        }
+
+        // 追加另一个缓冲中的全部内容; 流式输出时较长的内容直接写出, 不再复制
+        void Append(const Emitter &other) {
+            if (other.buf.size() >= limit) {
+                Flush();
+                WriteAll(other.buf.data(), other.buf.size());
+                return;
+            }
+            buf.append(other.buf);
+            FlushIfFull();
+        }
+
+        size_t Size() const { return buf.size(); }
+        const char *Data() const { return buf.data(); }
+        void Clear() { buf.clear(); }
+
+        // 流式输出时写出缓冲中剩余的内容, 返回到目前为止的写出是否都成功
+        bool Flush() {
+            if (fd < 0) return true;
+            WriteAll(buf.data(), buf.size());
+            buf.clear();
+            return !failed;
+        }
+
+        // 一次写出缓冲内容, 成功时返回 true
+        bool WriteTo(FILE *file) const {
+            if (buf.empty()) return true;
+            return std::fwrite(buf.data(), 1, buf.size(), file) == buf.size() && std::fflush(file) == 0;
+        }
+};
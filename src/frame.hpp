@@ -0,0 +1,64 @@
+#pragma once
+#include<cstdint>
+#include<functional>
+#include<queue>
+#include<utility>
+#include<vector>
+#include "ir.hpp"
+#include "regalloc.hpp"
+
+// 栈帧布局, 自低地址向高地址依次为:
+//   alloc 的栈槽, 每个 alloc 独占一个;
+//   溢出值的栈槽, 活跃区间不相交的溢出值共用一个;
+//   callee-saved 寄存器的保存区;
+//   ra 的保存位置, 只有函数中有调用时才有.
+// 总长度按 16 字节对齐.
+
+struct FrameLayout {
+    std::vector<int32_t> offset;        // 按 ValueId 索引, 没有栈槽为 -1
+    int32_t save_base = 0;              // 保存区在栈帧中的偏移
+    int32_t ra_offset = -1;
+    int32_t length = 0;
+    int slot_cnt = 0;                   // 栈槽个数, 不含保存区
+
+    // 超过 12 位立即数范围的帧需要临时寄存器计算地址和调整 sp
+    bool NeedsAddressReg() const { return length > 2047; }
+};
+
+// 溢出值按区间起点依次分配栈槽: 先回收已结束区间的栈槽, 有空闲的就取编号最小的
+static FrameLayout LayoutFrame(const IrFunction &fn, const RegAllocResult &regs, bool has_call) {
+    FrameLayout frame;
+    frame.offset.assign(fn.values.size(), -1);
+    for (auto b : fn.layout) {
+        for (auto inst : fn.blocks[b].insts) {
+            if (fn[inst].op == IR_ALLOC) frame.offset[inst] = 4 * frame.slot_cnt++;
+        }
+    }
+
+    std::priority_queue<int, std::vector<int>, std::greater<int>> free_slots;
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> active;   // (end, 栈槽)
+    for (const auto &interval : regs.spill_intervals) {
+        while (!active.empty() && active.top().first < interval.start) {
+            free_slots.push(active.top().second);
+            active.pop();
+        }
+        int slot;
+        if (!free_slots.empty()) {
+            slot = free_slots.top();
+            free_slots.pop();
+        } else {
+            slot = frame.slot_cnt++;
+        }
+        frame.offset[interval.value] = 4 * slot;
+        active.emplace(interval.end, slot);
+    }
+
+    frame.save_base = 4 * frame.slot_cnt;
+    frame.length = frame.save_base + 4 * regs.callee_saved.size();
+    if (has_call) {
+        frame.ra_offset = frame.length;
+        frame.length += 4;
+    }
+    frame.length = (frame.length + 15) & ~15;
+    return frame;
+}
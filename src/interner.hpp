@@ -0,0 +1,76 @@
+#pragma once
+#include<cstdint>
+#include<cstring>
+#include<string_view>
+#include<vector>
+#include "arena.hpp"
+
+// 驻留后的标识符, 相同的名字对应相同的编号
+typedef uint32_t SymbolId;
+
+// 字符串驻留表: 每个不同的名字在一次编译中只保存一份,
+// 标识符的比较和哈希都变成整数运算.
+class StringInterner {
+    private:
+        static constexpr uint32_t kEmpty = 0xffffffffu;
+
+        Arena arena;                        // 名字的存储
+        std::vector<std::string_view> names;
+        std::vector<uint32_t> hashes;
+        std::vector<SymbolId> slots;        // 开放寻址, 线性探测
+
+        static uint32_t Hash(const char *str, size_t len) {
+            uint32_t h = 2166136261u;       // FNV-1a
+            for (size_t i = 0; i < len; ++i) {
+                h ^= static_cast<unsigned char>(str[i]);
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        void Grow() {
+            slots.assign(slots.empty() ? 64 : slots.size() * 2, kEmpty);
+            uint32_t mask = slots.size() - 1;
+            for (SymbolId id = 0; id < names.size(); ++id) {
+                uint32_t i = hashes[id] & mask;
+                while (slots[i] != kEmpty) i = (i + 1) & mask;
+                slots[i] = id;
+            }
+        }
+
+    public:
+        SymbolId Intern(const char *str, size_t len) {
+            if ((names.size() + 1) * 2 > slots.size()) Grow();
+            uint32_t h = Hash(str, len);
+            uint32_t mask = slots.size() - 1;
+            uint32_t i = h & mask;
+            for (; slots[i] != kEmpty; i = (i + 1) & mask) {
+                SymbolId id = slots[i];
+                if (hashes[id] == h && names[id].size() == len && std::memcmp(names[id].data(), str, len) == 0) {
+                    return id;
+                }
+            }
+            SymbolId id = names.size();
+            names.push_back(arena.NewString(str, len));
+            hashes.push_back(h);
+            slots[i] = id;
+            return id;
+        }
+
+        SymbolId Intern(std::string_view str) { return Intern(str.data(), str.size()); }
+
+        // 名字以 '\0' 结尾, 可以直接当作 C 字符串使用
+        std::string_view Name(SymbolId id) const { return names[id]; }
+
+        uint32_t Size() const { return names.size(); }
+
+        void Clear() {
+            arena.Reset();
+            names.clear();
+            hashes.clear();
+            slots.clear();
+        }
+};
+
+// 词法分析, AST 和代码生成共用; 每个线程一份, 批量编译时每个文件开始前清空
+inline thread_local StringInterner interner;
@@ -0,0 +1,266 @@
+#pragma once
+#include<algorithm>
+#include<cassert>
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<unordered_map>
+#include<vector>
+#include "arena.hpp"
+#include "koopa.h"
+
+// 编译器自己的紧凑 IR. 每个函数把所有值放在一个数组中, 以 32 位下标 (ValueId) 互相引用;
+// 操作数集中放在函数的操作数池里, 每个值记录自己的区间. 基本块只保存参数和指令的
+// ValueId 序列, 这些序列从函数的 arena 中分配; 基本块之间以 BlockId 引用.
+// 语义与 Koopa 的子集一致: i32 整数, 局部 alloc, 基本块参数, 以及 load/store/binary/br/jump/ret.
+// 与 koopa_raw_program_t 及 Koopa 文本之间的转换见 irconvert.hpp.
+
+typedef uint32_t ValueId;
+typedef uint32_t BlockId;
+
+static constexpr uint32_t kNoId = 0xffffffffu;
+
+typedef enum : uint8_t {
+    IR_INTEGER,     // 整数常量, imm 为值
+    IR_UNDEF,
+    IR_PARAM,       // 基本块参数, imm 为序号
+    IR_ALLOC,       // alloc i32, 结果类型为 *i32
+    IR_LOAD,        // [src]
+    IR_STORE,       // [value, dest]
+    IR_BINARY,      // [lhs, rhs], 运算为 binary_op
+    IR_BRANCH,      // [cond, true 实参..., false 实参...], 目标为 targets[0], targets[1]
+    IR_JUMP,        // [实参...], 目标为 targets[0]
+    IR_RETURN       // [value] 或 []
+} ir_opcode_t;
+
+struct IrValue {
+    ir_opcode_t op;
+    uint8_t binary_op = 0;          // koopa_raw_binary_op_t
+    uint16_t true_arg_cnt = 0;      // br 中属于 true 一侧的实参个数
+    BlockId block = kNoId;          // 所在基本块, 常量为 kNoId
+    int32_t imm = 0;
+    uint32_t name = kNoId;          // IrFunction::names 的下标, 没有名字时为 kNoId
+    uint32_t operand_begin = 0;     // 在 IrFunction::operands 中的区间
+    uint32_t operand_cnt = 0;
+    BlockId targets[2] = {kNoId, kNoId};
+
+    koopa_raw_binary_op_t BinaryOp() const { return static_cast<koopa_raw_binary_op_t>(binary_op); }
+    bool IsConstant() const { return op == IR_INTEGER || op == IR_UNDEF; }
+    bool IsTerminator() const { return op == IR_BRANCH || op == IR_JUMP || op == IR_RETURN; }
+    // 有 i32 结果的值; alloc 的结果是指针, 单独处理
+    bool HasResult() const { return op == IR_PARAM || op == IR_LOAD || op == IR_BINARY; }
+};
+
+// 操作数池中的一段, 池增长后失效, 不要跨越添加操作数的调用保存
+struct IrOperands {
+    ValueId *data;
+    uint32_t size;
+
+    ValueId *begin() const { return data; }
+    ValueId *end() const { return data + size; }
+    ValueId &operator[](uint32_t i) const { return data[i]; }
+};
+
+// 基本块中的值序列, 内存来自所在函数的 arena
+typedef std::vector<ValueId, ArenaAllocator<ValueId>> IrValueList;
+
+struct IrBlock {
+    uint32_t name = kNoId;
+    IrValueList params;
+    IrValueList insts;
+
+    explicit IrBlock(Arena *arena) : params(ArenaAllocator<ValueId>(arena)), insts(ArenaAllocator<ValueId>(arena)) {}
+};
+
+class IrFunction {
+    private:
+        // 基本块的参数和指令序列从这里分配; 放在堆上, 函数移动后序列仍然有效
+        std::unique_ptr<Arena> arena = std::make_unique<Arena>();
+        std::unordered_map<int32_t, ValueId> integers;
+        ValueId undef = kNoId;
+
+        ValueId NewValue(ir_opcode_t op, BlockId block) {
+            values.emplace_back();
+            values.back().op = op;
+            values.back().block = block;
+            return values.size() - 1;
+        }
+
+    public:
+        std::string name;                   // 带 '@'
+        bool returns_value = true;          // 返回类型为 i32 还是 unit
+        std::vector<IrValue> values;
+        std::vector<ValueId> operands;
+        std::vector<IrBlock> blocks;        // 按 BlockId 索引, 删去的基本块仍占位
+        std::vector<BlockId> layout;        // 基本块的排列顺序, 第一个为入口
+        std::vector<std::string> names;
+
+        // 每个值的使用者 (CSR), 由 ComputeUses 生成, 修改 IR 后需要重新计算
+        std::vector<uint32_t> use_begin;
+        std::vector<ValueId> users;
+
+        IrValue &operator[](ValueId v) { return values[v]; }
+        const IrValue &operator[](ValueId v) const { return values[v]; }
+
+        BlockId Entry() const { return layout.empty() ? kNoId : layout[0]; }
+
+        uint32_t AddName(const std::string &text) {
+            names.push_back(text);
+            return names.size() - 1;
+        }
+
+        const char *NameOf(uint32_t name) const { return name == kNoId ? nullptr : names[name].c_str(); }
+
+        IrOperands Operands(ValueId v) {
+            return IrOperands{operands.data() + values[v].operand_begin, values[v].operand_cnt};
+        }
+
+        const IrOperands Operands(ValueId v) const {
+            return IrOperands{const_cast<ValueId *>(operands.data()) + values[v].operand_begin, values[v].operand_cnt};
+        }
+
+        // 替换整个操作数列表; 不比原来长时原地覆盖, 否则放到池的末尾
+        void SetOperands(ValueId v, const std::vector<ValueId> &ops) {
+            auto &value = values[v];
+            if (ops.size() > value.operand_cnt) {
+                value.operand_begin = operands.size();
+                operands.insert(operands.end(), ops.begin(), ops.end());
+            } else {
+                std::copy(ops.begin(), ops.end(), operands.begin() + value.operand_begin);
+            }
+            value.operand_cnt = ops.size();
+        }
+
+        ValueId Integer(int32_t imm) {
+            auto it = integers.find(imm);
+            if (it != integers.end()) return it->second;
+            ValueId v = NewValue(IR_INTEGER, kNoId);
+            values[v].imm = imm;
+            integers.emplace(imm, v);
+            return v;
+        }
+
+        ValueId Undef() {
+            if (undef == kNoId) undef = NewValue(IR_UNDEF, kNoId);
+            return undef;
+        }
+
+        BlockId NewBlock(uint32_t name) {
+            blocks.emplace_back(arena.get());
+            blocks.back().name = name;
+            return blocks.size() - 1;
+        }
+
+        ValueId AddParam(BlockId b) {
+            ValueId v = NewValue(IR_PARAM, b);
+            values[v].imm = blocks[b].params.size();
+            blocks[b].params.push_back(v);
+            return v;
+        }
+
+        // 新建指令, 不放入任何基本块
+        ValueId NewInst(ir_opcode_t op, BlockId b, const std::vector<ValueId> &ops) {
+            ValueId v = NewValue(op, b);
+            values[v].operand_begin = operands.size();
+            values[v].operand_cnt = ops.size();
+            operands.insert(operands.end(), ops.begin(), ops.end());
+            return v;
+        }
+
+        ValueId AppendInst(ir_opcode_t op, BlockId b, const std::vector<ValueId> &ops) {
+            ValueId v = NewInst(op, b, ops);
+            blocks[b].insts.push_back(v);
+            return v;
+        }
+
+        ValueId Terminator(BlockId b) const {
+            const auto &insts = blocks[b].insts;
+            if (insts.empty() || !values[insts.back()].IsTerminator()) return kNoId;
+            return insts.back();
+        }
+
+        // 基本块的后继, 按 true/false 的顺序, 不去重
+        uint32_t Successors(BlockId b, BlockId succs[2]) const {
+            ValueId term = Terminator(b);
+            if (term == kNoId) return 0;
+            const auto &inst = values[term];
+            if (inst.op == IR_BRANCH) {
+                succs[0] = inst.targets[0];
+                succs[1] = inst.targets[1];
+                return 2;
+            }
+            if (inst.op == IR_JUMP) {
+                succs[0] = inst.targets[0];
+                return 1;
+            }
+            return 0;
+        }
+
+        // 跳转到第 which 个目标时传递的实参 (br 的 0/1, jump 只有 0)
+        std::vector<ValueId> EdgeArgs(ValueId term, int which) const {
+            const auto &inst = values[term];
+            auto ops = Operands(term);
+            if (inst.op == IR_JUMP) return std::vector<ValueId>(ops.begin(), ops.end());
+            auto first = ops.begin() + 1 + (which ? inst.true_arg_cnt : 0);
+            auto last = which ? ops.end() : ops.begin() + 1 + inst.true_arg_cnt;
+            return std::vector<ValueId>(first, last);
+        }
+
+        void SetEdgeArgs(ValueId term, int which, const std::vector<ValueId> &args) {
+            auto &inst = values[term];
+            if (inst.op == IR_JUMP) {
+                SetOperands(term, args);
+                return;
+            }
+            auto true_args = EdgeArgs(term, 0), false_args = EdgeArgs(term, 1);
+            (which ? false_args : true_args) = args;
+            std::vector<ValueId> ops{Operands(term)[0]};
+            ops.insert(ops.end(), true_args.begin(), true_args.end());
+            ops.insert(ops.end(), false_args.begin(), false_args.end());
+            values[term].true_arg_cnt = true_args.size();
+            SetOperands(term, ops);
+        }
+
+        // 重新计算所有值的使用者, 只统计布局中基本块里的指令
+        void ComputeUses() {
+            use_begin.assign(values.size() + 1, 0);
+            for (auto b : layout) {
+                for (auto inst : blocks[b].insts) {
+                    for (auto operand : Operands(inst)) ++use_begin[operand + 1];
+                }
+            }
+            for (size_t i = 0; i < values.size(); ++i) use_begin[i + 1] += use_begin[i];
+            users.assign(use_begin.back(), kNoId);
+            std::vector<uint32_t> fill(use_begin.begin(), use_begin.end() - 1);
+            for (auto b : layout) {
+                for (auto inst : blocks[b].insts) {
+                    for (auto operand : Operands(inst)) users[fill[operand]++] = inst;
+                }
+            }
+        }
+
+        // 使用 v 的指令, 一条指令多次使用 v 时出现多次
+        IrOperands Users(ValueId v) const {
+            return IrOperands{const_cast<ValueId *>(users.data()) + use_begin[v], use_begin[v + 1] - use_begin[v]};
+        }
+
+        size_t InstCount() const {
+            size_t cnt = 0;
+            for (auto b : layout) cnt += blocks[b].insts.size();
+            return cnt;
+        }
+};
+
+struct IrModule {
+    std::vector<IrFunction> funcs;
+
+    void ComputeUses() {
+        for (auto &func : funcs) func.ComputeUses();
+    }
+
+    size_t InstCount() const {
+        size_t cnt = 0;
+        for (const auto &func : funcs) cnt += func.InstCount();
+        return cnt;
+    }
+};
@@ -0,0 +1,367 @@
+#pragma once
+#include<cassert>
+#include<deque>
+#include<string>
+#include<unordered_map>
+#include<unordered_set>
+#include<vector>
+#include "koopa.h"
+
+// builder 构造的数据本身都是可修改的, 从 IR 转换回来时先建指令再回填操作数
+static inline koopa_raw_value_data_t *MutableValue(koopa_raw_value_t value) {
+    return const_cast<koopa_raw_value_data_t *>(value);
+}
+
+// 直接在内存中构造 koopa_raw_program_t, 不再经过 Koopa 文本和 libkoopa 的解析.
+// 构造出的 raw program 中所有数据都归 KoopaBuilder 所有, builder 析构前有效.
+class KoopaBuilder {
+    private:
+        struct BlockState {
+            koopa_raw_basic_block_data_t *data;
+            std::vector<const void *> params;
+            std::vector<const void *> insts;
+        };
+
+        struct FuncState {
+            koopa_raw_function_data_t *data;
+            std::vector<BlockState *> blocks;
+        };
+
+        std::deque<koopa_raw_type_kind_t> types;
+        std::deque<koopa_raw_value_data_t> values;
+        std::deque<koopa_raw_basic_block_data_t> bbs;
+        std::deque<koopa_raw_function_data_t> funcs;
+        std::deque<BlockState> block_states;
+        std::deque<FuncState> func_states;
+        std::deque<std::vector<const void *>> buffers;
+        std::deque<std::string> names;
+        std::unordered_map<std::string, int> name_cnt;
+        std::unordered_set<std::string> used_names;
+        std::unordered_map<const koopa_raw_basic_block_data_t *, BlockState *> block_of;
+
+        koopa_raw_type_t int32_type = nullptr;
+        koopa_raw_type_t unit_type = nullptr;
+        koopa_raw_type_t int32_ptr_type = nullptr;
+
+        FuncState *cur_func = nullptr;
+        BlockState *cur_block = nullptr;
+
+        koopa_raw_value_data_t *NewValue(koopa_raw_type_t ty, const char *name, koopa_raw_value_tag_t tag) {
+            values.emplace_back();
+            auto value = &values.back();
+            value->ty = ty;
+            value->name = name;
+            value->used_by = EmptySlice(KOOPA_RSIK_VALUE);
+            value->kind.tag = tag;
+            return value;
+        }
+
+        // 追加一条指令; 若当前基本块已结束(如 return 之后的语句), 则开启一个新的不可达基本块
+        koopa_raw_value_t Append(koopa_raw_value_data_t *inst) {
+            assert(cur_block);
+            if (Terminated()) SetInsertPoint(NewBlock("%unreachable"));
+            cur_block->insts.push_back(inst);
+            return inst;
+        }
+
+        static bool IsTerminator(koopa_raw_value_t inst) {
+            auto tag = inst->kind.tag;
+            return tag == KOOPA_RVT_RETURN || tag == KOOPA_RVT_JUMP || tag == KOOPA_RVT_BRANCH;
+        }
+
+        static void AddUser(std::unordered_map<const void *, std::vector<const void *>> &users,
+                            const void *used, koopa_raw_value_t user) {
+            if (used) users[used].push_back(user);
+        }
+
+        static void AddUsers(std::unordered_map<const void *, std::vector<const void *>> &users,
+                             const koopa_raw_slice_t &slice, koopa_raw_value_t user) {
+            for (size_t i = 0; i < slice.len; ++i) AddUser(users, slice.buffer[i], user);
+        }
+
+    public:
+        KoopaBuilder() = default;
+        KoopaBuilder(const KoopaBuilder &) = delete;
+        KoopaBuilder &operator=(const KoopaBuilder &) = delete;
+
+        // 把 items 拷贝到 builder 持有的缓冲区中, 生成对应的 raw slice
+        koopa_raw_slice_t MakeSlice(const std::vector<const void *> &items, koopa_raw_slice_item_kind_t kind) {
+            buffers.emplace_back(items);
+            koopa_raw_slice_t slice;
+            slice.buffer = buffers.back().data();
+            slice.len = items.size();
+            slice.kind = kind;
+            return slice;
+        }
+
+        static koopa_raw_slice_t EmptySlice(koopa_raw_slice_item_kind_t kind) {
+            koopa_raw_slice_t slice;
+            slice.buffer = nullptr;
+            slice.len = 0;
+            slice.kind = kind;
+            return slice;
+        }
+
+        // 生成函数内唯一的名字, 如 @x, @x_1, %entry, %entry_1
+        const char *UniqueName(const std::string &name) {
+            std::string unique = name;
+            int &cnt = name_cnt[name];
+            while (used_names.count(unique)) unique = name + "_" + std::to_string(++cnt);
+            used_names.insert(unique);
+            names.push_back(unique);
+            return names.back().c_str();
+        }
+
+        koopa_raw_type_t Int32Type() {
+            if (!int32_type) {
+                types.emplace_back();
+                types.back().tag = KOOPA_RTT_INT32;
+                int32_type = &types.back();
+            }
+            return int32_type;
+        }
+
+        koopa_raw_type_t UnitType() {
+            if (!unit_type) {
+                types.emplace_back();
+                types.back().tag = KOOPA_RTT_UNIT;
+                unit_type = &types.back();
+            }
+            return unit_type;
+        }
+
+        koopa_raw_type_t Int32PointerType() {
+            if (!int32_ptr_type) {
+                types.emplace_back();
+                types.back().tag = KOOPA_RTT_POINTER;
+                types.back().data.pointer.base = Int32Type();
+                int32_ptr_type = &types.back();
+            }
+            return int32_ptr_type;
+        }
+
+        koopa_raw_type_t FunctionType(koopa_raw_type_t ret) {
+            types.emplace_back();
+            types.back().tag = KOOPA_RTT_FUNCTION;
+            types.back().data.function.params = EmptySlice(KOOPA_RSIK_TYPE);
+            types.back().data.function.ret = ret;
+            return &types.back();
+        }
+
+        // 开始一个新函数, name 需带 '@' 前缀
+        koopa_raw_function_data_t *BeginFunction(const std::string &name, koopa_raw_type_t ret) {
+            funcs.emplace_back();
+            auto func = &funcs.back();
+            names.push_back(name);
+            func->ty = FunctionType(ret);
+            func->name = names.back().c_str();
+            func->params = EmptySlice(KOOPA_RSIK_VALUE);
+            func->bbs = EmptySlice(KOOPA_RSIK_BASIC_BLOCK);
+
+            func_states.push_back(FuncState{func, {}});
+            cur_func = &func_states.back();
+            cur_block = nullptr;
+            name_cnt.clear();
+            used_names.clear();
+            return func;
+        }
+
+        // 结束当前函数; 末尾未结束的基本块补上 ret
+        void EndFunction() {
+            assert(cur_func);
+            if (cur_block && !Terminated()) {
+                auto ret_ty = cur_func->data->ty->data.function.ret;
+                Return(ret_ty->tag == KOOPA_RTT_UNIT ? nullptr : Integer(0));
+            }
+            cur_func = nullptr;
+            cur_block = nullptr;
+        }
+
+        // 在当前函数中新建基本块, name 需带 '%' 前缀
+        koopa_raw_basic_block_data_t *NewBlock(const std::string &name) {
+            auto bb = NewDetachedBlock(name);
+            PlaceBlock(bb);
+            return bb;
+        }
+
+        // 新建基本块但暂不放入当前函数, 之后用 PlaceBlock 排到末尾;
+        // 用于先作为跳转目标, 排在之后新建的基本块后面的情形
+        koopa_raw_basic_block_data_t *NewDetachedBlock(const std::string &name) {
+            assert(cur_func);
+            bbs.emplace_back();
+            auto bb = &bbs.back();
+            bb->name = UniqueName(name);
+            bb->params = EmptySlice(KOOPA_RSIK_VALUE);
+            bb->used_by = EmptySlice(KOOPA_RSIK_VALUE);
+            bb->insts = EmptySlice(KOOPA_RSIK_VALUE);
+
+            block_states.push_back(BlockState{bb, {}, {}});
+            block_of[bb] = &block_states.back();
+            return bb;
+        }
+
+        // 把 NewDetachedBlock 建立的基本块放到当前函数末尾
+        void PlaceBlock(koopa_raw_basic_block_data_t *bb) {
+            assert(cur_func);
+            cur_func->blocks.push_back(block_of.at(bb));
+        }
+
+        void SetInsertPoint(koopa_raw_basic_block_data_t *bb) {
+            auto it = block_of.find(bb);
+            assert(it != block_of.end());
+            cur_block = it->second;
+        }
+
+        // 当前基本块是否已以 ret/jump/br 结尾
+        bool Terminated() const {
+            return cur_block && !cur_block->insts.empty() &&
+                   IsTerminator(reinterpret_cast<koopa_raw_value_t>(cur_block->insts.back()));
+        }
+
+        koopa_raw_value_t Integer(int32_t value) {
+            auto integer = NewValue(Int32Type(), nullptr, KOOPA_RVT_INTEGER);
+            integer->kind.data.integer.value = value;
+            return integer;
+        }
+
+        koopa_raw_value_t Undef() {
+            return NewValue(Int32Type(), nullptr, KOOPA_RVT_UNDEF);
+        }
+
+        // 基本块的第 index 个参数, 由调用者放入基本块的 params 中
+        koopa_raw_value_t BlockArg(uint32_t index) {
+            auto arg = NewValue(Int32Type(), nullptr, KOOPA_RVT_BLOCK_ARG_REF);
+            arg->kind.data.block_arg_ref.index = index;
+            return arg;
+        }
+
+        // 给基本块追加一个参数, Finish 时写入基本块的 params
+        koopa_raw_value_t AddBlockParam(koopa_raw_basic_block_data_t *bb) {
+            auto state = block_of.at(bb);
+            auto param = BlockArg(state->params.size());
+            state->params.push_back(param);
+            return param;
+        }
+
+        koopa_raw_value_t Alloc(const std::string &name) {
+            return Append(NewValue(Int32PointerType(), UniqueName(name), KOOPA_RVT_ALLOC));
+        }
+
+        koopa_raw_value_t Load(koopa_raw_value_t src) {
+            auto load = NewValue(Int32Type(), nullptr, KOOPA_RVT_LOAD);
+            load->kind.data.load.src = src;
+            return Append(load);
+        }
+
+        koopa_raw_value_t Store(koopa_raw_value_t value, koopa_raw_value_t dest) {
+            auto store = NewValue(UnitType(), nullptr, KOOPA_RVT_STORE);
+            store->kind.data.store.value = value;
+            store->kind.data.store.dest = dest;
+            return Append(store);
+        }
+
+        koopa_raw_value_t Binary(koopa_raw_binary_op_t op, koopa_raw_value_t lhs, koopa_raw_value_t rhs) {
+            auto binary = NewValue(Int32Type(), nullptr, KOOPA_RVT_BINARY);
+            binary->kind.data.binary.op = op;
+            binary->kind.data.binary.lhs = lhs;
+            binary->kind.data.binary.rhs = rhs;
+            return Append(binary);
+        }
+
+        koopa_raw_value_t Branch(koopa_raw_value_t cond, koopa_raw_basic_block_t true_bb, koopa_raw_basic_block_t false_bb) {
+            auto branch = NewValue(UnitType(), nullptr, KOOPA_RVT_BRANCH);
+            branch->kind.data.branch.cond = cond;
+            branch->kind.data.branch.true_bb = true_bb;
+            branch->kind.data.branch.false_bb = false_bb;
+            branch->kind.data.branch.true_args = EmptySlice(KOOPA_RSIK_VALUE);
+            branch->kind.data.branch.false_args = EmptySlice(KOOPA_RSIK_VALUE);
+            return Append(branch);
+        }
+
+        koopa_raw_value_t Jump(koopa_raw_basic_block_t target) {
+            auto jump = NewValue(UnitType(), nullptr, KOOPA_RVT_JUMP);
+            jump->kind.data.jump.target = target;
+            jump->kind.data.jump.args = EmptySlice(KOOPA_RSIK_VALUE);
+            return Append(jump);
+        }
+
+        koopa_raw_value_t Return(koopa_raw_value_t value) {
+            auto ret = NewValue(UnitType(), nullptr, KOOPA_RVT_RETURN);
+            ret->kind.data.ret.value = value;
+            return Append(ret);
+        }
+
+        // 生成最终的 raw program, 同时回填各基本块/函数的 slice 与 used_by
+        koopa_raw_program_t Finish() {
+            std::vector<const void *> func_list;
+            for (auto &func : func_states) {
+                std::vector<const void *> bb_list;
+                for (auto block : func.blocks) {
+                    bb_list.push_back(block->data);
+                    block->data->params = MakeSlice(block->params, KOOPA_RSIK_VALUE);
+                    block->data->insts = MakeSlice(block->insts, KOOPA_RSIK_VALUE);
+                }
+                func.data->bbs = MakeSlice(bb_list, KOOPA_RSIK_BASIC_BLOCK);
+                func_list.push_back(func.data);
+            }
+
+            koopa_raw_program_t program;
+            program.values = EmptySlice(KOOPA_RSIK_VALUE);
+            program.funcs = MakeSlice(func_list, KOOPA_RSIK_FUNCTION);
+            ComputeUsedBy(program);
+            return program;
+        }
+
+        // 重新计算所有值和基本块的 used_by, IR 变换之后调用
+        void ComputeUsedBy(const koopa_raw_program_t &program) {
+            std::unordered_map<const void *, std::vector<const void *>> users;
+            for (size_t i = 0; i < program.funcs.len; ++i) {
+                auto func = reinterpret_cast<koopa_raw_function_t>(program.funcs.buffer[i]);
+                for (size_t j = 0; j < func->bbs.len; ++j) {
+                    auto bb = reinterpret_cast<koopa_raw_basic_block_t>(func->bbs.buffer[j]);
+                    for (size_t k = 0; k < bb->insts.len; ++k) {
+                        auto inst = reinterpret_cast<koopa_raw_value_t>(bb->insts.buffer[k]);
+                        const auto &kind = inst->kind;
+                        switch (kind.tag) {
+                            case KOOPA_RVT_LOAD:
+                                AddUser(users, kind.data.load.src, inst);
+                                break;
+                            case KOOPA_RVT_STORE:
+                                AddUser(users, kind.data.store.value, inst);
+                                AddUser(users, kind.data.store.dest, inst);
+                                break;
+                            case KOOPA_RVT_BINARY:
+                                AddUser(users, kind.data.binary.lhs, inst);
+                                AddUser(users, kind.data.binary.rhs, inst);
+                                break;
+                            case KOOPA_RVT_BRANCH:
+                                AddUser(users, kind.data.branch.cond, inst);
+                                AddUser(users, kind.data.branch.true_bb, inst);
+                                AddUser(users, kind.data.branch.false_bb, inst);
+                                AddUsers(users, kind.data.branch.true_args, inst);
+                                AddUsers(users, kind.data.branch.false_args, inst);
+                                break;
+                            case KOOPA_RVT_JUMP:
+                                AddUser(users, kind.data.jump.target, inst);
+                                AddUsers(users, kind.data.jump.args, inst);
+                                break;
+                            case KOOPA_RVT_RETURN:
+                                AddUser(users, kind.data.ret.value, inst);
+                                break;
+                            default:
+                                break;
+                        }
+                    }
+                }
+            }
+
+            for (auto &value : values) {
+                auto it = users.find(&value);
+                value.used_by = it == users.end() ? EmptySlice(KOOPA_RSIK_VALUE) : MakeSlice(it->second, KOOPA_RSIK_VALUE);
+            }
+            for (auto &bb : bbs) {
+                auto it = users.find(&bb);
+                bb.used_by = it == users.end() ? EmptySlice(KOOPA_RSIK_VALUE) : MakeSlice(it->second, KOOPA_RSIK_VALUE);
+            }
+        }
+};
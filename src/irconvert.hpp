@@ -0,0 +1,214 @@
+#pragma once
+#include<cassert>
+#include<string>
+#include<unordered_map>
+#include<vector>
+#include "ir.hpp"
+#include "irbuilder.hpp"
+#include "koopa.h"
+
+// IR 与 koopa_raw_program_t 之间的相互转换. raw program 可以来自 KoopaBuilder,
+// 也可以来自 libkoopa 对 Koopa 文本的解析. 只支持 ir.hpp 中列出的 Koopa 子集.
+// 转换保留函数, 基本块和 alloc 的名字; 临时值输出时按顺序重新编号.
+
+class RawToIr {
+    private:
+        IrFunction &fn;
+        std::unordered_map<koopa_raw_value_t, ValueId> value_of;
+        std::unordered_map<koopa_raw_basic_block_t, BlockId> block_of;
+
+        ValueId Map(koopa_raw_value_t value) {
+            if (value->kind.tag == KOOPA_RVT_INTEGER) return fn.Integer(value->kind.data.integer.value);
+            if (value->kind.tag == KOOPA_RVT_UNDEF) return fn.Undef();
+            return value_of.at(value);
+        }
+
+        void MapSlice(const koopa_raw_slice_t &slice, std::vector<ValueId> &out) {
+            for (size_t i = 0; i < slice.len; ++i) out.push_back(Map(reinterpret_cast<koopa_raw_value_t>(slice.buffer[i])));
+        }
+
+        static ir_opcode_t Opcode(koopa_raw_value_t inst) {
+            switch (inst->kind.tag) {
+                case KOOPA_RVT_ALLOC:
+                    assert(inst->ty->data.pointer.base->tag == KOOPA_RTT_INT32);
+                    return IR_ALLOC;
+                case KOOPA_RVT_LOAD: return IR_LOAD;
+                case KOOPA_RVT_STORE: return IR_STORE;
+                case KOOPA_RVT_BINARY: return IR_BINARY;
+                case KOOPA_RVT_BRANCH: return IR_BRANCH;
+                case KOOPA_RVT_JUMP: return IR_JUMP;
+                case KOOPA_RVT_RETURN: return IR_RETURN;
+                default:
+                    assert(false && "unsupported Koopa instruction");
+                    return IR_RETURN;
+            }
+        }
+
+        // 第二遍填写操作数: 操作数可能定义在布局靠后的基本块中
+        void FillOperands(koopa_raw_value_t inst, ValueId v) {
+            const auto &kind = inst->kind;
+            std::vector<ValueId> ops;
+            switch (kind.tag) {
+                case KOOPA_RVT_LOAD:
+                    ops = {Map(kind.data.load.src)};
+                    break;
+                case KOOPA_RVT_STORE:
+                    ops = {Map(kind.data.store.value), Map(kind.data.store.dest)};
+                    break;
+                case KOOPA_RVT_BINARY:
+                    fn[v].binary_op = kind.data.binary.op;
+                    ops = {Map(kind.data.binary.lhs), Map(kind.data.binary.rhs)};
+                    break;
+                case KOOPA_RVT_BRANCH:
+                    ops = {Map(kind.data.branch.cond)};
+                    MapSlice(kind.data.branch.true_args, ops);
+                    MapSlice(kind.data.branch.false_args, ops);
+                    fn[v].true_arg_cnt = kind.data.branch.true_args.len;
+                    fn[v].targets[0] = block_of.at(kind.data.branch.true_bb);
+                    fn[v].targets[1] = block_of.at(kind.data.branch.false_bb);
+                    break;
+                case KOOPA_RVT_JUMP:
+                    MapSlice(kind.data.jump.args, ops);
+                    fn[v].targets[0] = block_of.at(kind.data.jump.target);
+                    break;
+                case KOOPA_RVT_RETURN:
+                    if (kind.data.ret.value) ops = {Map(kind.data.ret.value)};
+                    break;
+                default:
+                    break;
+            }
+            fn.SetOperands(v, ops);
+        }
+
+    public:
+        explicit RawToIr(IrFunction &fn) : fn(fn) {}
+
+        void Convert(koopa_raw_function_t func) {
+            fn.name = func->name;
+            fn.returns_value = func->ty->data.function.ret->tag != KOOPA_RTT_UNIT;
+            assert(func->params.len == 0);
+            for (size_t i = 0; i < func->bbs.len; ++i) {
+                auto bb = reinterpret_cast<koopa_raw_basic_block_t>(func->bbs.buffer[i]);
+                BlockId b = fn.NewBlock(fn.AddName(bb->name ? bb->name : "%bb"));
+                block_of[bb] = b;
+                fn.layout.push_back(b);
+                for (size_t j = 0; j < bb->params.len; ++j) {
+                    value_of[reinterpret_cast<koopa_raw_value_t>(bb->params.buffer[j])] = fn.AddParam(b);
+                }
+                for (size_t j = 0; j < bb->insts.len; ++j) {
+                    auto inst = reinterpret_cast<koopa_raw_value_t>(bb->insts.buffer[j]);
+                    ValueId v = fn.AppendInst(Opcode(inst), b, {});
+                    if (inst->kind.tag == KOOPA_RVT_ALLOC && inst->name) fn[v].name = fn.AddName(inst->name);
+                    value_of[inst] = v;
+                }
+            }
+            for (size_t i = 0; i < func->bbs.len; ++i) {
+                auto bb = reinterpret_cast<koopa_raw_basic_block_t>(func->bbs.buffer[i]);
+                for (size_t j = 0; j < bb->insts.len; ++j) {
+                    auto inst = reinterpret_cast<koopa_raw_value_t>(bb->insts.buffer[j]);
+                    FillOperands(inst, value_of[inst]);
+                }
+            }
+            fn.ComputeUses();
+        }
+};
+
+// 只有声明没有函数体的函数 (如 libkoopa 解析出的库函数声明) 不转换
+static IrModule FromRaw(const koopa_raw_program_t &program) {
+    assert(program.values.len == 0);
+    IrModule module;
+    for (size_t i = 0; i < program.funcs.len; ++i) {
+        auto func = reinterpret_cast<koopa_raw_function_t>(program.funcs.buffer[i]);
+        if (func->bbs.len == 0) continue;
+        module.funcs.emplace_back();
+        RawToIr(module.funcs.back()).Convert(func);
+    }
+    return module;
+}
+
+// 用 builder 重新构造 raw program, 结果归 builder 所有.
+// 先建出所有基本块和指令, 再回填操作数, 因为操作数可能定义在布局靠后的基本块中.
+static inline koopa_raw_program_t ToRaw(KoopaBuilder &builder, const IrModule &module) {
+    for (const auto &fn : module.funcs) {
+        builder.BeginFunction(fn.name, fn.returns_value ? builder.Int32Type() : builder.UnitType());
+        std::vector<koopa_raw_basic_block_data_t *> bbs(fn.blocks.size(), nullptr);
+        std::vector<koopa_raw_value_t> raw(fn.values.size(), nullptr);
+        for (auto b : fn.layout) {
+            bbs[b] = builder.NewBlock(fn.NameOf(fn.blocks[b].name) ? fn.NameOf(fn.blocks[b].name) : "%bb");
+            for (auto param : fn.blocks[b].params) raw[param] = builder.AddBlockParam(bbs[b]);
+        }
+        for (auto b : fn.layout) {
+            builder.SetInsertPoint(bbs[b]);
+            for (auto v : fn.blocks[b].insts) {
+                const auto &inst = fn[v];
+                switch (inst.op) {
+                    case IR_ALLOC: raw[v] = builder.Alloc(fn.NameOf(inst.name) ? fn.NameOf(inst.name) : "@tmp"); break;
+                    case IR_LOAD: raw[v] = builder.Load(nullptr); break;
+                    case IR_STORE: raw[v] = builder.Store(nullptr, nullptr); break;
+                    case IR_BINARY: raw[v] = builder.Binary(inst.BinaryOp(), nullptr, nullptr); break;
+                    case IR_BRANCH: raw[v] = builder.Branch(nullptr, bbs[inst.targets[0]], bbs[inst.targets[1]]); break;
+                    case IR_JUMP: raw[v] = builder.Jump(bbs[inst.targets[0]]); break;
+                    case IR_RETURN: raw[v] = builder.Return(nullptr); break;
+                    default: assert(false);
+                }
+            }
+        }
+
+        auto map = [&](ValueId v) -> koopa_raw_value_t {
+            if (fn[v].op == IR_INTEGER) return builder.Integer(fn[v].imm);
+            if (fn[v].op == IR_UNDEF) return builder.Undef();
+            return raw[v];
+        };
+        auto map_args = [&](ValueId term, int which) {
+            std::vector<const void *> items;
+            for (auto arg : fn.EdgeArgs(term, which)) items.push_back(map(arg));
+            return builder.MakeSlice(items, KOOPA_RSIK_VALUE);
+        };
+        for (auto b : fn.layout) {
+            for (auto v : fn.blocks[b].insts) {
+                auto &kind = MutableValue(raw[v])->kind;
+                auto ops = fn.Operands(v);
+                switch (fn[v].op) {
+                    case IR_LOAD:
+                        kind.data.load.src = map(ops[0]);
+                        break;
+                    case IR_STORE:
+                        kind.data.store.value = map(ops[0]);
+                        kind.data.store.dest = map(ops[1]);
+                        break;
+                    case IR_BINARY:
+                        kind.data.binary.lhs = map(ops[0]);
+                        kind.data.binary.rhs = map(ops[1]);
+                        break;
+                    case IR_BRANCH:
+                        kind.data.branch.cond = map(ops[0]);
+                        kind.data.branch.true_args = map_args(v, 0);
+                        kind.data.branch.false_args = map_args(v, 1);
+                        break;
+                    case IR_JUMP:
+                        kind.data.jump.args = map_args(v, 0);
+                        break;
+                    case IR_RETURN:
+                        kind.data.ret.value = ops.size ? map(ops[0]) : nullptr;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+        builder.EndFunction();
+    }
+    return builder.Finish();
+}
+
+// 用 libkoopa 解析 Koopa 文本再转换为 IR, 解析失败时返回 false
+static bool ParseKoopa(const char *text, IrModule &module) {
+    koopa_program_t program;
+    if (koopa_parse_from_string(text, &program) != KOOPA_EC_SUCCESS) return false;
+    koopa_raw_program_builder_t builder = koopa_new_raw_program_builder();
+    koopa_raw_program_t raw = koopa_build_raw_program(builder, program);
+    koopa_delete_program(program);
+    module = FromRaw(raw);
+    koopa_delete_raw_program_builder(builder);
+    return true;
+}
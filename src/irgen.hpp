@@ -0,0 +1,285 @@
+#pragma once
+#include<string>
+#include<assert.h>
+#include "ast.hpp"
+#include "astvisitor.hpp"
+#include "consteval.hpp"
+#include "interner.hpp"
+#include "irbuilder.hpp"
+#include "symtab.hpp"
+
+static thread_local SymbolTable symbolTable;
+
+struct ExprResult {
+    bool is_constant;
+    int value;                  // 如果是常量则存储常量值
+    koopa_raw_value_t raw;      // 否则存储对应的 IR 值
+
+    ExprResult(bool is_const = false, int val = 0) : is_constant(is_const), value(val), raw(nullptr) {}
+    ExprResult(koopa_raw_value_t r) : is_constant(false), value(0), raw(r) {}
+
+    // 作为指令操作数使用, 常量在此时才生成 integer 值
+    koopa_raw_value_t ToValue(KoopaBuilder &ir) const {
+        return is_constant ? ir.Integer(value) : raw;
+    }
+};
+
+// 两个操作数都是常量时在编译期求值, 否则生成 binary 指令
+static ExprResult EmitBinary(KoopaBuilder &ir, koopa_raw_binary_op_t op, const ExprResult &lhs, const ExprResult &rhs) {
+    int32_t value;
+    if (lhs.is_constant && rhs.is_constant && EvalBinary(op, lhs.value, rhs.value, value)) return ExprResult(true, value);
+    return ExprResult(ir.Binary(op, lhs.ToValue(ir), rhs.ToValue(ir)));
+}
+
+static ExprResult EmitUnary(KoopaBuilder &ir, unaryop_t unaryop, const ExprResult &operand) {
+    if (unaryop == UNARY_PLUS) return operand;
+
+    koopa_raw_binary_op_t op = KOOPA_RBO_SUB;
+    switch(unaryop) {
+        case UNARY_PLUS: break;
+        case UNARY_MINUS:
+            op = KOOPA_RBO_SUB;     // -x 即 sub 0, x
+            break;
+        case UNARY_NOT:
+            op = KOOPA_RBO_EQ;      // !x 即 eq 0, x
+    }
+    return EmitBinary(ir, op, ExprResult(true, 0), operand);
+}
+
+// 从 AST 生成 Koopa IR, 表达式的结果是常量或 IR 值; 声明和语句返回空的结果.
+// FuncType 和 BType 只有 int, 不生成任何东西
+class IrGenerator : public AstVisitor<IrGenerator, ExprResult> {
+    private:
+        KoopaBuilder &ir;
+
+        // 读取变量或常量的值, 常量直接得到它的值
+        ExprResult LoadSymbol(SymbolId ident) {
+            auto id_info = symbolTable.Lookup(ident);
+            if (id_info) {
+                if (id_info->type == SymbolInfo::CONSTANT) {
+                    return ExprResult(true, id_info->const_value);
+                } else {
+                    return ExprResult(ir.Load(id_info->alloc));
+                }
+            }
+            else assert(false);
+            return ExprResult();
+        }
+
+        // a || b 与 a && b 的控制流: 结果先存入临时变量, 左边决定是否跳过右边.
+        //   is_or 时:  store 1, %result; br a, %lor_end, %lor_rhs
+        //   否则:      store 0, %result; br a, %land_rhs, %land_end
+        // 右边在 rhs 块中求值, 结果为 (b != 0). mem2reg 会把临时变量变为基本块参数.
+        ExprResult ShortCircuit(const ExprResult &left, const BaseAST *rhs_exp, bool is_or) {
+            auto result = ir.Alloc(is_or ? "%lor_result" : "%land_result");
+            ir.Store(ir.Integer(is_or ? 1 : 0), result);
+            auto rhs_bb = ir.NewBlock(is_or ? "%lor_rhs" : "%land_rhs");
+            // 右边嵌套的短路表达式会新建基本块, 结束块排在它们之后以便顺序执行
+            auto end_bb = ir.NewDetachedBlock(is_or ? "%lor_end" : "%land_end");
+            if (is_or) ir.Branch(left.raw, end_bb, rhs_bb);
+            else ir.Branch(left.raw, rhs_bb, end_bb);
+
+            ir.SetInsertPoint(rhs_bb);
+            ExprResult right = Visit(rhs_exp);
+            ir.Store(EmitBinary(ir, KOOPA_RBO_NOT_EQ, right, ExprResult(true, 0)).ToValue(ir), result);
+            ir.Jump(end_bb);
+
+            ir.PlaceBlock(end_bb);
+            ir.SetInsertPoint(end_bb);
+            return ExprResult(ir.Load(result));
+        }
+
+        // a || b 与 a && b: 左边是常量时直接得到结果或只需计算右边, 否则生成短路的控制流
+        ExprResult Logic(const BaseAST *lhs_exp, const BaseAST *rhs_exp, bool is_or) {
+            ExprResult left = Visit(lhs_exp);
+            if (left.is_constant) {
+                if (is_or && left.value) return ExprResult(true, 1);
+                if (!is_or && !left.value) return ExprResult(true, 0);
+                return EmitBinary(ir, KOOPA_RBO_NOT_EQ, Visit(rhs_exp), ExprResult(true, 0));
+            }
+            return ShortCircuit(left, rhs_exp, is_or);
+        }
+
+        // 先求左边再求右边; 除数为 0 时不折叠, 留到运行时
+        ExprResult Binary(koopa_raw_binary_op_t op, const BaseAST *lhs, const BaseAST *rhs) {
+            ExprResult left = Visit(lhs);
+            ExprResult right = Visit(rhs);
+            return EmitBinary(ir, op, left, right);
+        }
+
+    public:
+        explicit IrGenerator(KoopaBuilder &ir) : ir(ir) {}
+
+        ExprResult VisitCompUnit(const CompUnitAST &node) {
+            Visit(node.func_def);
+            return ExprResult();
+        }
+
+        ExprResult VisitFuncDef(const FuncDefAST &node) {
+            ir.BeginFunction("@" + std::string(interner.Name(node.ident)), ir.Int32Type());
+            ir.SetInsertPoint(ir.NewBlock("%entry"));
+            Visit(node.block);
+            ir.EndFunction();
+            return ExprResult();
+        }
+
+        ExprResult VisitBlock(const BlockAST &node) {
+            symbolTable.PushScope();
+            for (const auto& blockitem : node.blockitem_list){
+                Visit(blockitem);
+            }
+            symbolTable.PopScope();
+            return ExprResult();
+        }
+
+        ExprResult VisitBlockItem(const BlockItemAST &node) {
+            return Visit(node.decl_stmt);
+        }
+
+        ExprResult VisitDecl(const DeclAST &node) {
+            return Visit(node.const_vardecl);
+        }
+
+        ExprResult VisitConstDecl(const ConstDeclAST &node) {
+            for (const auto& constdef : node.constdef_list) {
+                Visit(constdef);
+            }
+            return ExprResult();
+        }
+
+        ExprResult VisitConstDef(const ConstDefAST &node) {
+            ExprResult intval = Visit(node.constintval);
+            if (!intval.is_constant) assert(false);
+            if (!symbolTable.Declare(node.ident, SymbolInfo(intval.value))) assert(false);
+            return ExprResult();
+        }
+
+        ExprResult VisitConstInitVal(const ConstInitValAST &node) {
+            return Visit(node.constexp);
+        }
+
+        ExprResult VisitConstExp(const ConstExpAST &node) {
+            return Visit(node.exp);
+        }
+
+        ExprResult VisitVarDecl(const VarDeclAST &node) {
+            for (const auto& vardef : node.vardef_list) {
+                Visit(vardef);
+            }
+            return ExprResult();
+        }
+
+        ExprResult VisitVarDef(const VarDefAST &node) {
+            auto alloc = ir.Alloc("@" + std::string(interner.Name(node.ident)));
+
+            // 初始化表达式中的同名变量仍指向外层, 求值后再声明
+            if (node.type == 2) {
+                ExprResult intval = Visit(node.initval);
+                ir.Store(intval.ToValue(ir), alloc);
+            }
+            if (!symbolTable.Declare(node.ident, SymbolInfo(SymbolInfo::VARIABLE, alloc))) assert(false);
+            return ExprResult();
+        }
+
+        ExprResult VisitInitVal(const InitValAST &node) {
+            return Visit(node.exp);
+        }
+
+        ExprResult VisitBinaryExpr(const BinaryExprAST &node) {
+            static const koopa_raw_binary_op_t koopa_ops[] = {
+                KOOPA_RBO_OR, KOOPA_RBO_AND,    // 短路运算不使用
+                KOOPA_RBO_EQ, KOOPA_RBO_NOT_EQ,
+                KOOPA_RBO_LT, KOOPA_RBO_GT, KOOPA_RBO_LE, KOOPA_RBO_GE,
+                KOOPA_RBO_ADD, KOOPA_RBO_SUB,
+                KOOPA_RBO_MUL, KOOPA_RBO_DIV, KOOPA_RBO_MOD
+            };
+            if (node.op == BINARY_LOR || node.op == BINARY_LAND) return Logic(node.lhs, node.rhs, node.op == BINARY_LOR);
+            return Binary(koopa_ops[node.op], node.lhs, node.rhs);
+        }
+
+        ExprResult VisitUnaryExpr(const UnaryExprAST &node) {
+            return EmitUnary(ir, node.op, Visit(node.operand));
+        }
+
+        ExprResult VisitLiteral(const LiteralAST &node) {
+            return ExprResult(true, node.value);
+        }
+
+        ExprResult VisitVarRef(const VarRefAST &node) {
+            return LoadSymbol(node.ident);
+        }
+
+        ExprResult VisitLVal(const LValAST &node) {
+            return LoadSymbol(node.ident);
+        }
+
+        ExprResult VisitStmt(const StmtAST &node) {
+            if (node.type == 1) {
+                auto lval_ptr = static_cast<const LValAST *>(node.lval);
+                auto id_info = symbolTable.Lookup(lval_ptr->ident);
+                if (!id_info) assert(false);
+                if (id_info->type == SymbolInfo::CONSTANT) assert(false);
+
+                ExprResult result = Visit(node.exp);
+                ir.Store(result.ToValue(ir), id_info->alloc);
+                return ExprResult();
+            } else if (node.type == 2) {
+                ExprResult result = Visit(node.exp);
+                ir.Return(result.ToValue(ir));
+                return ExprResult();
+            } else if (node.type == 3) {
+                return Visit(node.block);
+            } else {
+                if (node.exp) Visit(node.exp);
+                return ExprResult();
+            }
+        }
+
+        ExprResult VisitExp(const ExpAST &node) {
+            return Visit(node.lorexp);
+        }
+
+        // 短路求值: 左边非 0 时结果为 1, 不再计算右边
+        ExprResult VisitLOrExp(const LOrExpAST &node) {
+            if (node.type == 1) return Visit(node.landexp);
+            return Logic(node.lorexp, node.landexp, true);
+        }
+
+        // 短路求值: 左边为 0 时结果为 0, 不再计算右边
+        ExprResult VisitLAndExp(const LAndExpAST &node) {
+            if (node.type == 1) return Visit(node.eqexp);
+            return Logic(node.landexp, node.eqexp, false);
+        }
+
+        ExprResult VisitEqExp(const EqExpAST &node) {
+            if (node.type == 1) return Visit(node.relexp);
+            return Binary(node.eqop == REL_EQ ? KOOPA_RBO_EQ : KOOPA_RBO_NOT_EQ, node.eqexp, node.relexp);
+        }
+
+        ExprResult VisitRelExp(const RelExpAST &node) {
+            if (node.type == 1) return Visit(node.addexp);
+            static const koopa_raw_binary_op_t koopa_ops[] = {KOOPA_RBO_LT, KOOPA_RBO_GT, KOOPA_RBO_LE, KOOPA_RBO_GE};
+            return Binary(koopa_ops[node.relop], node.relexp, node.addexp);
+        }
+
+        ExprResult VisitAddExp(const AddExpAST &node) {
+            if (node.type == 1) return Visit(node.mulexp);
+            return Binary(node.addop == ADD_OP ? KOOPA_RBO_ADD : KOOPA_RBO_SUB, node.addexp, node.mulexp);
+        }
+
+        ExprResult VisitMulExp(const MulExpAST &node) {
+            if (node.type == 1) return Visit(node.unaryexp);
+            static const koopa_raw_binary_op_t koopa_ops[] = {KOOPA_RBO_MUL, KOOPA_RBO_DIV, KOOPA_RBO_MOD};
+            return Binary(koopa_ops[node.mulop], node.mulexp, node.unaryexp);
+        }
+
+        ExprResult VisitUnaryExp(const UnaryExpAST &node) {
+            if (node.type == 1) return Visit(node.primaryexp_unaryexp);
+            return EmitUnary(ir, node.unaryop, Visit(node.primaryexp_unaryexp));
+        }
+
+        ExprResult VisitPrimaryExp(const PrimaryExpAST &node) {
+            if (node.type == 1) return Visit(node.exp_lval);
+            return ExprResult(true, node.number);
+        }
+};
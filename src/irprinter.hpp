@@ -0,0 +1,153 @@
+#pragma once
+#include<algorithm>
+#include<cassert>
+#include<string>
+#include<unordered_set>
+#include<vector>
+#include "emitter.hpp"
+#include "ir.hpp"
+
+// 把 IR 以 Koopa 文本写入 out, 仅在 -koopa 模式下使用
+
+class KoopaPrinter {
+    private:
+        Emitter &out;
+        const IrFunction &fn;
+        std::vector<std::string> value_names;   // 按 ValueId 索引
+
+        void Operand(ValueId v) {
+            const auto &value = fn[v];
+            if (value.op == IR_INTEGER) out << value.imm;
+            else if (value.op == IR_UNDEF) out << "undef";
+            else out << value_names[v];
+        }
+
+        void Target(ValueId term, int which) {
+            out << fn.NameOf(fn.blocks[fn[term].targets[which]].name);
+            auto args = fn.EdgeArgs(term, which);
+            if (args.empty()) return;
+            out << "(";
+            for (size_t i = 0; i < args.size(); ++i) {
+                if (i) out << ", ";
+                Operand(args[i]);
+            }
+            out << ")";
+        }
+
+        void Inst(ValueId v) {
+            static const char *ops[] = {"ne", "eq", "gt", "lt", "ge", "le", "add", "sub", "mul",
+                                        "div", "mod", "and", "or", "xor", "shl", "shr", "sar"};
+            const auto &inst = fn[v];
+            auto operands = fn.Operands(v);
+            out << "  ";
+            if (inst.op == IR_ALLOC || inst.HasResult()) out << value_names[v] << " = ";
+            switch (inst.op) {
+                case IR_ALLOC:
+                    out << "alloc i32";
+                    break;
+                case IR_LOAD:
+                    out << "load ";
+                    Operand(operands[0]);
+                    break;
+                case IR_STORE:
+                    out << "store ";
+                    Operand(operands[0]);
+                    out << ", ";
+                    Operand(operands[1]);
+                    break;
+                case IR_BINARY:
+                    out << ops[inst.binary_op] << " ";
+                    Operand(operands[0]);
+                    out << ", ";
+                    Operand(operands[1]);
+                    break;
+                case IR_BRANCH:
+                    out << "br ";
+                    Operand(operands[0]);
+                    out << ", ";
+                    Target(v, 0);
+                    out << ", ";
+                    Target(v, 1);
+                    break;
+                case IR_JUMP:
+                    out << "jump ";
+                    Target(v, 0);
+                    break;
+                case IR_RETURN:
+                    out << "ret";
+                    if (operands.size) {
+                        out << " ";
+                        Operand(operands[0]);
+                    }
+                    break;
+                default:
+                    assert(false);
+            }
+            out << '\n';
+        }
+
+        // 形如 %0 的名字, 与临时值的编号同形
+        static bool IsNumbered(const std::string &name) {
+            return name.size() > 1 && name[0] == '%' &&
+                   std::all_of(name.begin() + 1, name.end(), [](char c) { return c >= '0' && c <= '9'; });
+        }
+
+    public:
+        KoopaPrinter(Emitter &out, const IrFunction &fn) : out(out), fn(fn) {}
+
+        // 未命名的值在函数内按出现顺序编号为 %0, %1, ...; 跳过基本块和 alloc 已经占用的编号,
+        // 例如 .koopa 输入中的 %0 = alloc i32
+        void Print() {
+            std::unordered_set<std::string> taken;
+            for (auto b : fn.layout) {
+                const auto &bb = fn.blocks[b];
+                if (bb.name != kNoId && IsNumbered(fn.names[bb.name])) taken.insert(fn.names[bb.name]);
+                for (auto v : bb.insts) {
+                    const auto &inst = fn[v];
+                    if (inst.op == IR_ALLOC && inst.name != kNoId && IsNumbered(fn.names[inst.name])) taken.insert(fn.names[inst.name]);
+                }
+            }
+            int tmp_cnt = 0;
+            auto temporary = [&] {
+                std::string name = "%" + std::to_string(tmp_cnt++);
+                while (!taken.empty() && taken.count(name)) name = "%" + std::to_string(tmp_cnt++);
+                return name;
+            };
+
+            value_names.assign(fn.values.size(), std::string());
+            for (auto b : fn.layout) {
+                for (auto param : fn.blocks[b].params) value_names[param] = temporary();
+                for (auto v : fn.blocks[b].insts) {
+                    const auto &inst = fn[v];
+                    if (inst.op != IR_ALLOC && !inst.HasResult()) continue;
+                    value_names[v] = inst.name != kNoId ? fn.names[inst.name] : temporary();
+                }
+            }
+
+            out << "fun " << fn.name << "()";
+            if (fn.returns_value) out << ": i32";
+            out << " {\n";
+            for (auto b : fn.layout) {
+                const auto &bb = fn.blocks[b];
+                out << fn.NameOf(bb.name);
+                if (!bb.params.empty()) {
+                    out << "(";
+                    for (size_t i = 0; i < bb.params.size(); ++i) {
+                        if (i) out << ", ";
+                        out << value_names[bb.params[i]] << ": i32";
+                    }
+                    out << ")";
+                }
+                out << ":\n";
+                for (auto v : bb.insts) Inst(v);
+            }
+            out << "}\n";
+        }
+};
+
+static void DumpKoopa(Emitter &out, const IrModule &module) {
+    for (size_t i = 0; i < module.funcs.size(); ++i) {
+        if (i) out << '\n';
+        KoopaPrinter(out, module.funcs[i]).Print();
+    }
+}
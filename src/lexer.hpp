@@ -0,0 +1,206 @@
+#pragma once
+#include<algorithm>
+#include<climits>
+#include<cstdint>
+#include<cstring>
+#include<string>
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
+#include "interner.hpp"
+#include "sysy.tab.hpp"
+
+// 手写的词法分析器, 直接扫描整块读入的源文件, 由 -lexer=fast 打开.
+// 产生的词法单元与 sysy.l 完全相同, 包括 flex 最长匹配在不合法输入上的结果:
+// 没有结束的注释不算注释, "0x" 后没有数字时只匹配 0, "09" 是两个十进制数.
+// 扫描时不记录行号, 报错时再从头数换行.
+
+typedef enum {
+    LEXER_FLEX,         // flex 生成的扫描器
+    LEXER_FAST,         // 手写扫描器
+} lexer_t;
+
+class FastLexer {
+    private:
+        const char *begin;
+        const char *end;
+        const char *cur;
+        const char *token;          // 最近一个词法单元的起点
+        std::string text;           // 报错时的词法单元文本
+
+        static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+        static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+        static bool IsIdentStart(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+        static bool IsIdentChar(char c) { return IsIdentStart(c) || IsDigit(c); }
+
+        // 十六进制以内的数字值, 不是数字时返回 16
+        static unsigned DigitValue(char c) {
+            if (IsDigit(c)) return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return 16;
+        }
+
+        // 每次比较 16 个字节, 找到第一个不是空白的字符
+        static const char *SkipSpaces(const char *p, const char *end) {
+#ifdef __SSE2__
+            const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+            const __m128i newline = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+            while (end - p >= 16) {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                                             _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, cr)));
+                unsigned other = ~unsigned(_mm_movemask_epi8(blank)) & 0xffff;
+                if (other) return p + __builtin_ctz(other);
+                p += 16;
+            }
+#endif
+            while (p < end && IsSpace(*p)) ++p;
+            return p;
+        }
+
+        // 块注释的结尾之后, 没有结尾时返回 nullptr
+        static const char *BlockCommentEnd(const char *p, const char *end) {
+            while (p < end) {
+                auto star = static_cast<const char *>(std::memchr(p, '*', end - p));
+                if (!star || end - star < 2) return nullptr;
+                if (star[1] == '/') return star + 2;
+                p = star + 1;
+            }
+            return nullptr;
+        }
+
+        // 跳过空白和注释
+        void SkipTrivia() {
+            for (;;) {
+                cur = SkipSpaces(cur, end);
+                if (end - cur < 2 || cur[0] != '/') return;
+                if (cur[1] == '/') {
+                    // flex 的 \/\/.*$ 要求后面有换行, 文件末尾的行注释不算注释
+                    auto newline = static_cast<const char *>(std::memchr(cur + 2, '\n', end - cur - 2));
+                    if (!newline) return;
+                    cur = newline;
+                } else if (cur[1] == '*') {
+                    auto after = BlockCommentEnd(cur + 2, end);
+                    if (!after) return;
+                    cur = after;
+                } else {
+                    return;
+                }
+            }
+        }
+
+        // 关键字的完美哈希, 对 SysY 的全部关键字 (int void const return if else while break continue)
+        // 都没有冲突; 文法加入关键字时只需在表中登记
+        static unsigned KeywordHash(const char *str, size_t len) {
+            return (static_cast<unsigned char>(str[0]) * 5u + static_cast<unsigned char>(str[len - 1]) + len) & 15;
+        }
+
+        // 是关键字时返回对应的词法单元, 否则返回 0
+        static int Keyword(const char *str, size_t len) {
+            struct Entry {
+                const char *text = nullptr;
+                size_t len = 0;
+                int token = 0;
+            };
+            struct Table {
+                Entry entries[16];
+                Table() {
+                    for (auto entry : {Entry{"int", 3, INT}, Entry{"return", 6, RETURN}, Entry{"const", 5, CONST}}) {
+                        entries[KeywordHash(entry.text, entry.len)] = entry;
+                    }
+                }
+            };
+            static const Table table;
+            const auto &entry = table.entries[KeywordHash(str, len)];
+            return entry.len == len && std::memcmp(entry.text, str, len) == 0 ? entry.token : 0;
+        }
+
+        // 与 strtol(yytext, nullptr, 0) 再转成 int 的结果相同, 超出 long 的范围时取 LONG_MAX
+        int Number() {
+            const char *p = cur;
+            unsigned base = 10;
+            if (*p == '0') {
+                if (end - p >= 3 && (p[1] == 'x' || p[1] == 'X') && DigitValue(p[2]) < 16) {
+                    base = 16;
+                    p += 2;
+                } else if (end - p >= 2 && p[1] >= '0' && p[1] <= '7') {
+                    base = 8;
+                    ++p;
+                } else {
+                    cur = p + 1;
+                    return 0;
+                }
+            }
+            uint64_t value = 0;
+            bool overflow = false;
+            for (; p < end; ++p) {
+                unsigned digit = DigitValue(*p);
+                if (digit >= base) break;
+                if (value > (uint64_t(LONG_MAX) - digit) / base) overflow = true;
+                else value = value * base + digit;
+            }
+            cur = p;
+            return int(overflow ? LONG_MAX : long(value));
+        }
+
+        static int TwoCharOperator(char first, char second) {
+            if (second == '=') {
+                switch (first) {
+                    case '<': return LE;
+                    case '>': return GE;
+                    case '=': return EQ;
+                    case '!': return NE;
+                }
+            }
+            if (first == '&' && second == '&') return LAND;
+            if (first == '|' && second == '|') return LOR;
+            return 0;
+        }
+
+    public:
+        FastLexer(const char *data, size_t size) : begin(data), end(data + size), cur(data), token(data) {}
+
+        // 返回下一个词法单元, 文件结束时返回 0
+        int Next(YYSTYPE *lval) {
+            SkipTrivia();
+            token = cur;
+            if (cur == end) return 0;
+            char c = *cur;
+            if (IsIdentStart(c)) {
+                const char *p = cur + 1;
+                while (p < end && IsIdentChar(*p)) ++p;
+                size_t len = p - cur;
+                cur = p;
+                if (int keyword = Keyword(token, len)) return keyword;
+                lval->sym_val = interner.Intern(token, len);
+                return IDENT;
+            }
+            if (IsDigit(c)) {
+                lval->int_val = Number();
+                return INT_CONST;
+            }
+            if (end - cur >= 2) {
+                if (int op = TwoCharOperator(c, cur[1])) {
+                    cur += 2;
+                    return op;
+                }
+            }
+            ++cur;
+            return c;
+        }
+
+        // 最近一个词法单元的文本和它结尾所在的行, 对应 flex 的 yytext 和 yylineno
+        const char *Text() {
+            text.assign(token, cur);
+            return text.c_str();
+        }
+
+        int Line() const { return 1 + std::count(begin, cur, '\n'); }
+};
+
+// 语法分析器的词法来源, flex 扫描器和手写扫描器只用其一
+struct Scanner {
+    yyscan_t flex = nullptr;
+    FastLexer *fast = nullptr;
+};
@@ -0,0 +1,213 @@
+#pragma once
+#include<cstdint>
+#include<utility>
+#include<vector>
+#include "emitter.hpp"
+#include "riscv.hpp"
+
+// 后端生成的机器指令. Visit 先生成指令序列, 经过窥孔优化后再统一输出为文本.
+
+typedef enum : uint8_t {
+    RV_LI, RV_MV, RV_SEQZ, RV_SNEZ,
+    RV_LW, RV_SW,
+    RV_ADD, RV_SUB, RV_MUL, RV_MULH, RV_DIV, RV_REM, RV_AND, RV_OR, RV_XOR,
+    RV_SLL, RV_SRL, RV_SRA, RV_SLT, RV_SGT,
+    RV_ADDI, RV_ANDI, RV_ORI, RV_XORI, RV_SLTI, RV_SLLI, RV_SRLI, RV_SRAI,
+    RV_BEQZ, RV_BNEZ, RV_BEQ, RV_BNE, RV_BLT, RV_BGE, RV_BGT, RV_BLE,
+    RV_J, RV_RET,
+    RV_LABEL,   // 标号, 不是指令
+    RV_NOP      // 窥孔优化删去的指令, 输出时跳过
+} rv_opcode_t;
+
+typedef enum : uint8_t {
+    RV_FMT_LI,      // op rd, imm
+    RV_FMT_RR,      // op rd, rs1
+    RV_FMT_LOAD,    // op rd, imm(rs1)
+    RV_FMT_STORE,   // op rs2, imm(rs1)
+    RV_FMT_R,       // op rd, rs1, rs2
+    RV_FMT_I,       // op rd, rs1, imm
+    RV_FMT_BZ,      // op rs1, label
+    RV_FMT_B,       // op rs1, rs2, label
+    RV_FMT_J,       // op label
+    RV_FMT_NONE     // ret, 标号与空指令
+} rv_format_t;
+
+static const struct {
+    const char *name;
+    rv_format_t format;
+} rv_opcode_info[] = {
+    {"li", RV_FMT_LI}, {"mv", RV_FMT_RR}, {"seqz", RV_FMT_RR}, {"snez", RV_FMT_RR},
+    {"lw", RV_FMT_LOAD}, {"sw", RV_FMT_STORE},
+    {"add", RV_FMT_R}, {"sub", RV_FMT_R}, {"mul", RV_FMT_R}, {"mulh", RV_FMT_R}, {"div", RV_FMT_R}, {"rem", RV_FMT_R},
+    {"and", RV_FMT_R}, {"or", RV_FMT_R}, {"xor", RV_FMT_R},
+    {"sll", RV_FMT_R}, {"srl", RV_FMT_R}, {"sra", RV_FMT_R}, {"slt", RV_FMT_R}, {"sgt", RV_FMT_R},
+    {"addi", RV_FMT_I}, {"andi", RV_FMT_I}, {"ori", RV_FMT_I}, {"xori", RV_FMT_I},
+    {"slti", RV_FMT_I}, {"slli", RV_FMT_I}, {"srli", RV_FMT_I}, {"srai", RV_FMT_I},
+    {"beqz", RV_FMT_BZ}, {"bnez", RV_FMT_BZ},
+    {"beq", RV_FMT_B}, {"bne", RV_FMT_B}, {"blt", RV_FMT_B}, {"bge", RV_FMT_B}, {"bgt", RV_FMT_B}, {"ble", RV_FMT_B},
+    {"j", RV_FMT_J}, {"ret", RV_FMT_NONE},
+    {"", RV_FMT_NONE}, {"", RV_FMT_NONE}
+};
+
+// 跳转类指令和标号的 imm 为标号编号
+struct MachineInst {
+    rv_opcode_t op;
+    reg_t rd = REG_NONE;
+    reg_t rs1 = REG_NONE;
+    reg_t rs2 = REG_NONE;
+    int32_t imm = 0;
+
+    rv_format_t Format() const { return rv_opcode_info[op].format; }
+
+    bool IsBranch() const { return Format() == RV_FMT_BZ || Format() == RV_FMT_B; }
+    bool IsTerminator() const { return IsBranch() || op == RV_J || op == RV_RET; }
+
+    static MachineInst Li(reg_t rd, int32_t imm) { return {RV_LI, rd, REG_NONE, REG_NONE, imm}; }
+    static MachineInst Unary(rv_opcode_t op, reg_t rd, reg_t rs) { return {op, rd, rs}; }
+    static MachineInst Load(reg_t rd, int32_t offset) { return {RV_LW, rd, REG_SP, REG_NONE, offset}; }
+    static MachineInst Store(reg_t rs, int32_t offset) { return {RV_SW, REG_NONE, REG_SP, rs, offset}; }
+    static MachineInst R(rv_opcode_t op, reg_t rd, reg_t rs1, reg_t rs2) { return {op, rd, rs1, rs2}; }
+    static MachineInst I(rv_opcode_t op, reg_t rd, reg_t rs1, int32_t imm) { return {op, rd, rs1, REG_NONE, imm}; }
+    static MachineInst Branch(rv_opcode_t op, reg_t rs1, reg_t rs2, uint32_t label) { return {op, REG_NONE, rs1, rs2, int32_t(label)}; }
+    static MachineInst Jump(uint32_t label) { return {RV_J, REG_NONE, REG_NONE, REG_NONE, int32_t(label)}; }
+    static MachineInst Ret() { return {RV_RET}; }
+    static MachineInst Label(uint32_t label) { return {RV_LABEL, REG_NONE, REG_NONE, REG_NONE, int32_t(label)}; }
+};
+
+static inline bool IsImm12(int64_t value) {
+    return value >= -2048 && value <= 2047;
+}
+
+static inline uint32_t RegBit(reg_t reg) {
+    return reg == REG_NONE || reg == REG_ZERO ? 0 : uint32_t(1) << reg;
+}
+
+// 指令读取的寄存器集合; ret 读取返回值, sp, ra 和 callee-saved 寄存器
+static inline uint32_t UseMask(const MachineInst &inst) {
+    switch (inst.Format()) {
+        case RV_FMT_RR:
+        case RV_FMT_LOAD:
+        case RV_FMT_I:
+        case RV_FMT_BZ:
+            return RegBit(inst.rs1);
+        case RV_FMT_STORE:
+        case RV_FMT_R:
+        case RV_FMT_B:
+            return RegBit(inst.rs1) | RegBit(inst.rs2);
+        default:
+            break;
+    }
+    if (inst.op != RV_RET) return 0;
+    uint32_t mask = RegBit(REG_A0) | RegBit(REG_SP) | RegBit(REG_RA);
+    for (int reg = 0; reg < 32; ++reg) {
+        if (IsCalleeSaved(reg_t(reg))) mask |= RegBit(reg_t(reg));
+    }
+    return mask;
+}
+
+static inline uint32_t DefMask(const MachineInst &inst) {
+    switch (inst.Format()) {
+        case RV_FMT_LI:
+        case RV_FMT_RR:
+        case RV_FMT_LOAD:
+        case RV_FMT_R:
+        case RV_FMT_I:
+            return RegBit(inst.rd);
+        default:
+            return 0;
+    }
+}
+
+// 一个函数的机器指令. 标号 0..block_cnt-1 对应基本块, 之后是条件分支的参数传递块
+struct MachineFunction {
+    const char *name = nullptr;         // 不带 '@'
+    uint32_t block_cnt = 0;
+    uint32_t label_cnt = 0;
+    std::vector<MachineInst> insts;
+
+    uint32_t NewLabel() { return label_cnt++; }
+
+    // 基本块的标号为 .L<函数名>_<编号>, 参数传递块为 .L<函数名>_e<编号>;
+    // 编号中没有下划线, 不同函数之间不会重名
+    void PrintLabel(Emitter &out, uint32_t label) const {
+        out << ".L" << name << '_';
+        if (label < block_cnt) out << label;
+        else out << 'e' << label - block_cnt;
+    }
+
+    // 输出汇编文本, 返回输出的指令条数
+    int Print(Emitter &out) const {
+        int cnt = 0;
+        for (const auto &inst : insts) {
+            if (inst.op == RV_NOP) continue;
+            if (inst.op == RV_LABEL) {
+                PrintLabel(out, inst.imm);
+                out << ":\n";
+                continue;
+            }
+            ++cnt;
+            out << "  " << rv_opcode_info[inst.op].name;
+            switch (inst.Format()) {
+                case RV_FMT_LI:
+                    out << ' ' << reg_names[inst.rd] << ", " << inst.imm;
+                    break;
+                case RV_FMT_RR:
+                    out << ' ' << reg_names[inst.rd] << ", " << reg_names[inst.rs1];
+                    break;
+                case RV_FMT_LOAD:
+                    out << ' ' << reg_names[inst.rd] << ", " << inst.imm << '(' << reg_names[inst.rs1] << ')';
+                    break;
+                case RV_FMT_STORE:
+                    out << ' ' << reg_names[inst.rs2] << ", " << inst.imm << '(' << reg_names[inst.rs1] << ')';
+                    break;
+                case RV_FMT_R:
+                    out << ' ' << reg_names[inst.rd] << ", " << reg_names[inst.rs1] << ", " << reg_names[inst.rs2];
+                    break;
+                case RV_FMT_I:
+                    out << ' ' << reg_names[inst.rd] << ", " << reg_names[inst.rs1] << ", " << inst.imm;
+                    break;
+                case RV_FMT_BZ:
+                    out << ' ' << reg_names[inst.rs1] << ", ";
+                    PrintLabel(out, inst.imm);
+                    break;
+                case RV_FMT_B:
+                    out << ' ' << reg_names[inst.rs1] << ", " << reg_names[inst.rs2] << ", ";
+                    PrintLabel(out, inst.imm);
+                    break;
+                case RV_FMT_J:
+                    out << ' ';
+                    PrintLabel(out, inst.imm);
+                    break;
+                case RV_FMT_NONE:
+                    break;
+            }
+            out << '\n';
+        }
+        return cnt;
+    }
+};
+
+// 把超出 12 位立即数范围的访存偏移和 addi 展开为 li + add, 地址或立即数先装入 scratch.
+// 在窥孔优化之后进行, 窥孔规则看到的访存都是 sp 加立即数的形式
+static void LegalizeImmediates(MachineFunction &mf, reg_t scratch) {
+    std::vector<MachineInst> insts;
+    insts.reserve(mf.insts.size());
+    for (const auto &inst : mf.insts) {
+        bool memory = inst.op == RV_LW || inst.op == RV_SW;
+        if ((!memory && inst.op != RV_ADDI) || IsImm12(inst.imm)) {
+            insts.push_back(inst);
+            continue;
+        }
+        insts.push_back(MachineInst::Li(scratch, inst.imm));
+        if (!memory) {
+            insts.push_back(MachineInst::R(RV_ADD, inst.rd, inst.rs1, scratch));
+            continue;
+        }
+        insts.push_back(MachineInst::R(RV_ADD, scratch, inst.rs1, scratch));
+        MachineInst access = inst;
+        access.rs1 = scratch;
+        access.imm = 0;
+        insts.push_back(access);
+    }
+    mf.insts = std::move(insts);
+}
@@ -1,81 +1,452 @@
-#include <cassert>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <sstream>
-#include <fstream>
-#include <memory>
 #include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "arena.hpp"
 #include "ast.hpp"
+#include "astdump.hpp"
+#include "astsimplify.hpp"
+#include "astwriter.hpp"
+#include "emitter.hpp"
+#include "interner.hpp"
+#include "irbuilder.hpp"
+#include "irconvert.hpp"
+#include "irgen.hpp"
+#include "irprinter.hpp"
 #include "koopa.h"
+#include "lexer.hpp"
+#include "mappedfile.hpp"
+#include "parser.hpp"
+#include "passmanager.hpp"
+#include "stats.hpp"
+#include "symtab.hpp"
+#include "threadpool.hpp"
 #include "visitraw.hpp"
 
 using namespace std;
 
-extern FILE *yyin;
-extern int yyparse(unique_ptr<BaseAST> &ast);
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
 
-int main(int argc, const char *argv[]) {
-  assert(argc == 5);
-  auto mode = argv[1];
-  auto input = argv[2];
-  auto output = argv[4];
+#ifndef YY_TYPEDEF_YY_BUFFER_STATE
+#define YY_TYPEDEF_YY_BUFFER_STATE
+typedef struct yy_buffer_state *YY_BUFFER_STATE;
+#endif
+
+extern int yylex_init(yyscan_t *scanner);
+extern int yylex_destroy(yyscan_t scanner);
+extern void yyset_in(FILE *in, yyscan_t scanner);
+extern YY_BUFFER_STATE yy_scan_buffer(char *base, size_t size, yyscan_t scanner);
+extern int yyparse(Scanner *scanner, BaseAST *&ast, Arena &arena);
+
+// 一个文件的编译结果
+struct CompileResult {
+  bool ok = false;
+  string error;
+  double millis = 0;
+  int emitted_insts = 0;
+  int spilled_values = 0;
+  int frame_bytes = 0;
+  PeepholeStats peephole;
+  CompileStats stats;
+};
+
+// AST 输出选项, 默认不输出
+struct DumpAstOptions {
+  bool enabled = false;
+  ast_format_t format = AST_FORMAT_TEXT;
+  string path;                // 为空时写到 stdout
+};
 
-  yyin = fopen(input, "r");
-  assert(yyin);
+// 要运行的优化, 由 -O, -passes= 以及单独的优化选项决定
+static PassPipeline pipeline;
 
-  unique_ptr<BaseAST> ast;
-  auto ret = yyparse(ast);
-  assert(!ret);
+// 词法分析器和语法分析器, 由 -lexer= 和 -parser= 决定
+static lexer_t lexer_kind = LEXER_FLEX;
+static parser_t parser_kind = PARSER_BISON;
 
-  cout << "=== AST Structure ===" << endl;
-  ast->Dump();
-  cout << endl;
+// 语法分析后是否化简 AST, -no-ast-simplify 关闭
+static bool simplify_ast = true;
 
-  ofstream outputfile(output);
-  assert(outputfile);
+static bool DumpAst(const BaseAST *ast, const DumpAstOptions &options) {
+  Emitter ast_dump;
+  AstWriter writer(ast_dump, options.format);
+  AstDumper(writer).Visit(ast);
+  ast_dump << '\n';
+  if (options.path.empty()) return ast_dump.WriteTo(stdout);
+  FILE *file = fopen(options.path.c_str(), "w");
+  if (!file) return false;
+  bool written = ast_dump.WriteTo(file);
+  fclose(file);
+  return written;
+}
 
-  stringstream ss;
-  streambuf *oldcoutbuf = cout.rdbuf(ss.rdbuf());
-  ast->KoopaIR();
-  cout.rdbuf(outputfile.rdbuf());
+// 按 -parser= 选择语法分析器, 返回值与 yyparse 相同
+static int ParseProgram(Scanner *scanner, BaseAST *&ast, Arena &arena) {
+  if (parser_kind == PARSER_RD) return Parser(scanner, arena).Parse(ast);
+  return yyparse(scanner, ast, arena);
+}
+
+// 解析 C 源文件并生成 IR, 失败时在 result 中记录原因
+static bool CompileSource(const char *input, IrModule &module, const DumpAstOptions &dump_ast, CompileResult &result) {
+  auto &stats = result.stats;
+  // 两个扫描器都直接扫描映射的文件. flex 的 yy_scan_buffer 会临时改写缓冲, 因此映射为可写 (写时复制),
+  // 并利用最后一页文件末尾之后的零作为结尾的两个 '\0'; 没有这样的空余时 flex 扫描器通过 FILE 读入
+  MappedFile source;
+  if (!source.Open(input, lexer_kind == LEXER_FLEX)) {
+    result.error = "cannot open input";
+    return false;
+  }
+  char *scan_buffer = nullptr;
+  size_t scan_len = 0;
+  FILE *inputfile = nullptr;
+  if (lexer_kind == LEXER_FLEX && !(scan_buffer = source.ScanBuffer(scan_len))) {
+    source.Close();
+    if (!(inputfile = fopen(input, "r"))) {
+      result.error = "cannot open input";
+      return false;
+    }
+  }
+
+  // AST 节点分配在 arena 中, 随 arena 一起释放
+  Arena arena;
+  BaseAST *ast = nullptr;
+  int ret;
+  {
+    PhaseTimer timer(stats, PHASE_PARSE);
+    Scanner scanner;
+    if (lexer_kind == LEXER_FAST) {
+      FastLexer lexer(source.Data(), source.Size());
+      scanner.fast = &lexer;
+      ret = ParseProgram(&scanner, ast, arena);
+      // 标识符都已驻留, AST 不引用源文本
+      source.Close();
+    } else {
+      yylex_init(&scanner.flex);
+      if (scan_buffer) yy_scan_buffer(scan_buffer, scan_len, scanner.flex);
+      else yyset_in(inputfile, scanner.flex);
+      ret = ParseProgram(&scanner, ast, arena);
+      yylex_destroy(scanner.flex);
+      if (inputfile) fclose(inputfile);
+      source.Close();
+    }
+  }
+  stats.tokens = token_cnt;
+  if (ret || !ast) {
+    stats.ast_nodes = ast_node_cnt;
+    result.error = "syntax error";
+    return false;
+  }
+
+  // 化简后的 AST 复制到新的 arena 中, 语法分析得到的树随即释放; 统计的是化简后的节点数
+  Arena simplified;
+  if (simplify_ast) {
+    PhaseTimer timer(stats, PHASE_AST_SIMPLIFY);
+    uint64_t parsed_nodes = ast_node_cnt;
+    ast = AstSimplifier(simplified).Visit(ast);
+    arena.Reset();
+    stats.ast_nodes = ast_node_cnt - parsed_nodes;
+  } else {
+    stats.ast_nodes = ast_node_cnt;
+  }
+
+  if (dump_ast.enabled) {
+    PhaseTimer timer(stats, PHASE_AST_DUMP);
+    if (!DumpAst(ast, dump_ast)) {
+      result.error = "cannot write AST dump";
+      return false;
+    }
+  }
+
+  // 前端在内存中构造 raw program, 再转换为编译器自己的 IR, 之后的优化和后端都在 IR 上进行
+  KoopaBuilder builder;
+  {
+    PhaseTimer timer(stats, PHASE_IRGEN);
+    IrGenerator(builder).Visit(ast);
+    module = FromRaw(builder.Finish());
+  }
+  return true;
+}
+
+// 编译一个文件. 所有逐文件的状态在开始前重置, 不同线程可以同时编译不同的文件
+static CompileResult CompileFile(const string &mode, const char *input, const char *output, const DumpAstOptions &dump_ast) {
+  auto start = chrono::steady_clock::now();
+  CompileResult result;
+  interner.Clear();
+  symbolTable.Clear();
+  emitted_inst_cnt = 0;
+  spilled_value_cnt = 0;
+  frame_bytes = 0;
+  peephole_stats = PeepholeStats();
+  token_cnt = 0;
+  ast_node_cnt = 0;
+  auto &stats = result.stats;
+  stats.files = 1;
+
+  // .koopa 输入由 libkoopa 解析后直接转换为 IR, 跳过前端
+  IrModule module;
+  string input_path = input;
+  if (input_path.size() > 6 && input_path.compare(input_path.size() - 6, 6, ".koopa") == 0) {
+    MappedFile file;
+    if (!file.Open(input)) {
+      result.error = "cannot open input";
+      return result;
+    }
+    PhaseTimer timer(stats, PHASE_PARSE);
+    if (!ParseKoopa(file.CString(), module)) {
+      result.error = "invalid Koopa IR";
+      return result;
+    }
+  } else if (!CompileSource(input, module, dump_ast, result)) {
+    return result;
+  }
+  {
+    PhaseTimer timer(stats, PHASE_OPT);
+    RunPasses(module, pipeline, stats);
+  }
+  stats.ir_insts = module.InstCount();
 
-  if (string(mode)=="-koopa"){
-    cout << ss.str();
+  // 输出流式写到文件, 不在内存中保留整个程序的文本
+  int outputfd;
+  {
+    PhaseTimer timer(stats, PHASE_WRITE);
+    outputfd = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
   }
-  else if (string(mode)=="-riscv")
+  if (outputfd < 0) {
+    result.error = "cannot open output";
+    return result;
+  }
+  Emitter out(outputfd);
   {
-    koopa_program_t program;
-    koopa_error_code_t ret = koopa_parse_from_string(ss.str().c_str(),&program);
-    assert(ret == KOOPA_EC_SUCCESS);
-    
-    koopa_raw_program_builder_t builder = koopa_new_raw_program_builder();
-    koopa_raw_program_t raw = koopa_build_raw_program(builder, program);
-    koopa_delete_program(program);
+    PhaseTimer timer(stats, PHASE_EMIT);
+    if (mode == "-koopa") {
+      DumpKoopa(out, module);
+    } else if (mode == "-riscv") {
+      Visit(out, module);
+    }
+  }
+  stats.asm_insts = emitted_inst_cnt;
+  if (peephole_stats.functions) {
+    auto &peephole = stats.Pass("peephole", false);
+    peephole.runs += peephole_stats.functions;
+    peephole.changed += peephole_stats.changed_functions;
+    peephole.wall_ms += peephole_stats.millis;
+  }
 
-    // for (size_t i = 0; i < raw.funcs.len; ++i) {
-    //   assert(raw.funcs.kind == KOOPA_RSIK_FUNCTION);
-    //   koopa_raw_function_t func = (koopa_raw_function_t) raw.funcs.buffer[i];
+  bool written;
+  {
+    PhaseTimer timer(stats, PHASE_WRITE);
+    written = out.Flush();
+    written &= close(outputfd) == 0;
+  }
+  if (!written) {
+    result.error = "write failed";
+    return result;
+  }
 
-    //   for (size_t j = 0; j < func->bbs.len; ++j){
-    //     assert(func->bbs.kind == KOOPA_RSIK_BASIC_BLOCK);
-    //     koopa_raw_basic_block_t bb= (koopa_raw_basic_block_t) func->bbs.buffer[j];
+  result.ok = true;
+  result.emitted_insts = emitted_inst_cnt;
+  result.spilled_values = spilled_value_cnt;
+  result.frame_bytes = frame_bytes;
+  result.peephole = peephole_stats;
+  result.millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  return result;
+}
 
-    //     for (size_t k = 0; k < bb->insts.len; ++k){
-    //       assert(bb->insts.kind == KOOPA_RSIK_VALUE);
-    //       koopa_raw_value_t value = (koopa_raw_value_t) bb->insts.buffer[k];
+static void PrintRegAllocStats(const CompileResult &result) {
+  cerr << "regalloc: " << (regalloc_mode == REGALLOC_LINEAR ? "linear" : "spill")
+       << ", spilled values: " << result.spilled_values
+       << ", frame bytes: " << result.frame_bytes
+       << ", instructions: " << result.emitted_insts << endl;
+}
 
-    //       switch (value->kind.tag){
+// 清单每行一个文件: "输入 [输出]", 省略输出时把输入的扩展名换成 .koopa 或 .riscv
+static bool ReadManifest(const char *path, const string &mode, vector<pair<string, string>> &files) {
+  ifstream manifest(path);
+  if (!manifest) return false;
+  string line;
+  while (getline(manifest, line)) {
+    istringstream fields(line);
+    string input, output;
+    if (!(fields >> input)) continue;
+    if (!(fields >> output)) {
+      output = input.substr(0, input.rfind('.')) + (mode == "-koopa" ? ".koopa" : ".riscv");
+    }
+    files.emplace_back(input, output);
+  }
+  return true;
+}
 
-    //       }
-    //     }
-    //   }
-    // }
+static void PrintUsage(const char *program) {
+  cerr << "usage: " << program << " -koopa|-riscv input -o output [options]" << endl
+       << "       " << program << " -koopa|-riscv -batch manifest [options]" << endl;
+}
 
-    Visit(raw);
+int main(int argc, const char *argv[]) {
+  // 用法:
+  //   compiler -koopa|-riscv input -o output [选项]
+  //   compiler -koopa|-riscv -batch manifest [选项]
+  // 输入文件以 .koopa 结尾时按 Koopa IR 文本读入, 跳过前端
+  if (argc < 4) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  string mode = argv[1];
+  bool batch = string(argv[2]) == "-batch";
+  if ((mode != "-koopa" && mode != "-riscv") || (!batch && (argc < 5 || string(argv[3]) != "-o"))) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  // 额外选项:
+  //   -regalloc=linear|spill  寄存器分配方案, 默认线性扫描
+  //   -regalloc-stats         在 stderr 输出溢出个数, 栈帧字节数和指令条数
+  //   -lexer=flex|fast        词法分析器, 默认为 flex 生成的扫描器; fast 为手写扫描器
+  //   -parser=bison|rd        语法分析器, 默认为 bison 生成的分析器; rd 为手写的递归下降分析器, 表达式的 AST 是扁平的
+  //   -no-ast-simplify        不化简 AST, 保留语法分析得到的包装节点; -dump-ast 输出的是化简后的 AST
+  //   -codegen-threads=N      后端并行生成函数的线程数, 默认为硬件并发数; 批量模式下默认为 1
+  //   -j=N                    批量模式下同时编译的文件数, 默认为硬件并发数
+  //   -time-report[=json]     在 stderr 输出各阶段的耗时, 内存和计数, 批量模式下为所有文件之和
+  //   -dump-ast[=text|json|sexpr]  输出 AST, 默认为缩进文本; 仅用于单文件模式
+  //   -dump-ast-file=PATH     AST 写到文件而不是 stdout
+  //   -O0|-O1|-O2             优化预设, 默认 -O0; -O1 为 mem2reg,sccp,dce,peephole, -O2 再加上 strength-reduce
+  //   -passes=LIST            逗号分隔的 pass 流水线, 按顺序运行, 代替 -O 预设; 可用的 pass 见下面五项
+  //   -mem2reg                把局部变量提升为 SSA 值
+  //   -sccp                   稀疏条件常量传播, 通常与 -mem2reg 一起使用
+  //   -dce                    删去无用的指令, 参数, 不会被读取的 store 和不可达的基本块
+  //   -peephole               对生成的机器指令做窥孔优化
+  //   -strength-reduce        乘除模常量时改用移位, 加减和乘高位
+  //                           以上五项在流水线中没有该 pass 时按 mem2reg, sccp, dce, strength-reduce, peephole 的顺序追加到末尾
+  //   -peephole-stats         在 stderr 输出各窥孔规则删去和改写的指令条数, 批量模式下为所有文件之和
+  bool regalloc_stats = false;
+  bool peephole_report = false;
+  bool time_report = false;
+  bool time_report_json = false;
+  unsigned jobs = 0;
+  bool codegen_threads_set = false;
+  DumpAstOptions dump_ast;
+  vector<string> extra_passes;
+  for (int i = batch ? 4 : 5; i < argc; ++i) {
+    string opt = argv[i];
+    if (opt == "-regalloc=linear") regalloc_mode = REGALLOC_LINEAR;
+    else if (opt == "-regalloc=spill") regalloc_mode = REGALLOC_SPILL;
+    else if (opt == "-regalloc-stats") regalloc_stats = true;
+    else if (opt == "-lexer=flex") lexer_kind = LEXER_FLEX;
+    else if (opt == "-lexer=fast") lexer_kind = LEXER_FAST;
+    else if (opt == "-parser=bison") parser_kind = PARSER_BISON;
+    else if (opt == "-parser=rd") parser_kind = PARSER_RD;
+    else if (opt == "-no-ast-simplify") simplify_ast = false;
+    else if (opt.rfind("-codegen-threads=", 0) == 0) {
+      codegen_threads = stoi(opt.substr(17));
+      codegen_threads_set = true;
+    }
+    else if (opt.rfind("-j=", 0) == 0) jobs = stoi(opt.substr(3));
+    else if (opt == "-time-report") time_report = true;
+    else if (opt == "-time-report=json") time_report = time_report_json = true;
+    else if (opt == "-dump-ast" || opt == "-dump-ast=text") dump_ast.enabled = true;
+    else if (opt == "-dump-ast=json") dump_ast.enabled = true, dump_ast.format = AST_FORMAT_JSON;
+    else if (opt == "-dump-ast=sexpr") dump_ast.enabled = true, dump_ast.format = AST_FORMAT_SEXPR;
+    else if (opt.rfind("-dump-ast-file=", 0) == 0) dump_ast.enabled = true, dump_ast.path = opt.substr(15);
+    else if (opt.rfind("-O", 0) == 0 || opt.rfind("-passes=", 0) == 0) {
+      const char *text = opt[1] == 'O' ? OptLevelPipeline(opt.substr(2)) : opt.c_str() + 8;
+      string error;
+      if (!text) {
+        cerr << opt << ": unknown optimization level" << endl;
+        return 1;
+      }
+      if (!pipeline.Parse(text, error)) {
+        cerr << opt << ": unknown pass '" << error << "'" << endl;
+        return 1;
+      }
+    }
+    else if (opt == "-mem2reg" || opt == "-sccp" || opt == "-dce" || opt == "-peephole" || opt == "-strength-reduce") {
+      extra_passes.push_back(opt.substr(1));
+    }
+    else if (opt == "-peephole-stats") peephole_report = true;
+    else {
+      cerr << "unknown option: " << opt << endl;
+      return 1;
+    }
+  }
+  for (const char *name : {"mem2reg", "sccp", "dce", "strength-reduce", "peephole"}) {
+    bool requested = false;
+    for (const auto &pass : extra_passes) requested |= pass == name;
+    if (requested && !pipeline.Contains(name)) pipeline.Add(name);
+  }
+  run_peephole = pipeline.peephole;
+  run_strength_reduction = pipeline.strength_reduce;
+
+  if (!batch) {
+    auto result = CompileFile(mode, argv[2], argv[4], dump_ast);
+    if (!result.ok) {
+      cerr << argv[2] << ": " << result.error << endl;
+      return 1;
+    }
+    if (regalloc_stats && mode == "-riscv") PrintRegAllocStats(result);
+    if (peephole_report && mode == "-riscv") {
+      Emitter report;
+      PrintPeepholeStats(report, result.peephole);
+      report.WriteTo(stderr);
+    }
+    if (time_report) {
+      Emitter report;
+      PrintTimeReport(report, result.stats, time_report_json);
+      report.WriteTo(stderr);
+    }
+    return 0;
+  }
 
-    koopa_delete_raw_program_builder(builder);
+  vector<pair<string, string>> files;
+  if (!ReadManifest(argv[3], mode, files)) {
+    cerr << argv[3] << ": cannot open manifest" << endl;
+    return 1;
+  }
+
+  // 文件之间并行, 单个文件内默认不再并行生成函数
+  if (!codegen_threads_set) codegen_threads = 1;
+  auto start = chrono::steady_clock::now();
+  vector<CompileResult> results(files.size());
+  ThreadPool pool(jobs ? jobs : DefaultThreadCount());
+  ParallelFor(pool, files.size(), [&](size_t i) {
+    results[i] = CompileFile(mode, files[i].first.c_str(), files[i].second.c_str(), DumpAstOptions());
+  });
+  double total_millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+  // 按清单顺序报告每个文件的结果
+  size_t failed = 0;
+  CompileStats total_stats;
+  PeepholeStats total_peephole;
+  for (size_t i = 0; i < files.size(); ++i) {
+    const auto &result = results[i];
+    total_stats.Add(result.stats);
+    total_peephole.Add(result.peephole);
+    if (result.ok) {
+      cout << "[ok] " << files[i].first << " " << result.millis << " ms" << endl;
+      if (regalloc_stats && mode == "-riscv") PrintRegAllocStats(result);
+    } else {
+      cout << "[FAIL] " << files[i].first << ": " << result.error << endl;
+      ++failed;
+    }
+  }
+  cout << "batch: " << files.size() << " files, " << failed << " failed, "
+       << total_millis << " ms" << endl;
+  if (peephole_report && mode == "-riscv") {
+    Emitter report;
+    PrintPeepholeStats(report, total_peephole);
+    report.WriteTo(stderr);
+  }
+  if (time_report) {
+    Emitter report;
+    PrintTimeReport(report, total_stats, time_report_json);
+    report.WriteTo(stderr);
   }
-  cout.rdbuf(oldcoutbuf);
-  outputfile.close();
-  return 0;
-}
\ No newline at end of file
+  return failed ? 1 : 0;
+}
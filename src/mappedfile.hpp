@@ -0,0 +1,100 @@
+#pragma once
+#include<cerrno>
+#include<cstddef>
+#include<string>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+// 映射的输入文件. 不是普通文件 (管道等), 长度为 0 或映射失败时退回为读入内存.
+// 映射是私有的, 可写的映射写时复制, 不会改动文件
+class MappedFile {
+    private:
+        void *mapping = nullptr;
+        bool writable = false;
+        const char *data = nullptr;
+        size_t size = 0;
+        std::string copy;           // 没有映射时的内容, 或补上结尾 '\0' 的副本
+
+        bool ReadAll(int fd) {
+            char buffer[1 << 16];
+            for (;;) {
+                ssize_t n = ::read(fd, buffer, sizeof(buffer));
+                if (n == 0) break;
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                copy.append(buffer, n);
+            }
+            data = copy.data();
+            size = copy.size();
+            return true;
+        }
+
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile() { Close(); }
+
+        // 成功时返回 true. writable 时映射可写, 供 ScanBuffer 使用
+        bool Open(const char *path, bool writable = false) {
+            int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+            struct stat st;
+            if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+                void *p = mmap(nullptr, st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    mapping = p;
+                    this->writable = writable;
+                    data = static_cast<const char *>(p);
+                    size = st.st_size;
+                    madvise(p, size, MADV_SEQUENTIAL);
+                    ::close(fd);
+                    return true;
+                }
+            }
+            bool read = ReadAll(fd);
+            ::close(fd);
+            return read;
+        }
+
+        // 解除映射并释放内容
+        void Close() {
+            if (mapping) munmap(mapping, size);
+            mapping = nullptr;
+            writable = false;
+            data = nullptr;
+            size = 0;
+            std::string().swap(copy);
+        }
+
+        const char *Data() const { return data; }
+        size_t Size() const { return size; }
+
+        // 以 '\0' 结尾的内容. 长度不是页大小整数倍时, 映射的最后一页在文件末尾之后补零, 不需要复制
+        const char *CString() {
+            if (!mapping) return copy.c_str();
+            if (size % sysconf(_SC_PAGESIZE) != 0) return data;
+            if (copy.empty()) copy.assign(data, size);
+            return copy.c_str();
+        }
+
+        // 供 flex 的 yy_scan_buffer 直接扫描的缓冲: 内容之后紧跟两个 '\0', len 包括这两个字节.
+        // 可写的映射在最后一页的文件末尾之后至少还有两个字节时不复制; 映射的长度恰好
+        // 接近页大小的整数倍时返回 nullptr, 由调用者改用 FILE 读入. 读入内存的内容补上两个 '\0'
+        char *ScanBuffer(size_t &len) {
+            len = size + 2;
+            if (!mapping) {
+                copy.resize(size + 2, '\0');
+                data = copy.data();
+                return &copy[0];
+            }
+            size_t page = sysconf(_SC_PAGESIZE);
+            if (!writable || size % page == 0 || size % page > page - 2) return nullptr;
+            return static_cast<char *>(mapping);
+        }
+};
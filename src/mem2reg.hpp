@@ -0,0 +1,290 @@
+#pragma once
+#include<algorithm>
+#include<cstdint>
+#include<unordered_map>
+#include<utility>
+#include<vector>
+#include "cfg.hpp"
+#include "ir.hpp"
+
+// mem2reg: 把只被 load/store 直接访问的局部变量提升为 SSA 值.
+// 在迭代支配边界处插入基本块参数 (Koopa 中代替 phi), 再沿支配树重命名,
+// 最后删去没有真正用到的基本块参数.
+
+// 每个可提升的 alloc 对应一个槽位
+struct PromotedSlots {
+    std::vector<ValueId> allocs;
+    std::vector<uint32_t> slot_of;          // 按 ValueId 索引, 不可提升为 kNoId
+
+    bool Contains(ValueId value) const { return value < slot_of.size() && slot_of[value] != kNoId; }
+    uint32_t operator[](ValueId value) const { return slot_of[value]; }
+};
+
+// 指针只出现在 load 的 src 和 store 的 dest 中的 i32 alloc 可以提升:
+// 统计 alloc 作为操作数出现的总次数, 与这两种位置出现的次数比较
+static PromotedSlots FindPromotableAllocs(const IrFunction &fn, const ControlFlowGraph &cfg) {
+    std::unordered_map<ValueId, std::pair<uint32_t, uint32_t>> uses;
+    std::vector<ValueId> candidates;
+    for (auto b : cfg.blocks) {
+        for (auto inst : fn.blocks[b].insts) {
+            const auto &value = fn[inst];
+            if (value.op == IR_ALLOC) {
+                candidates.push_back(inst);
+                uses[inst];
+                continue;
+            }
+            auto operands = fn.Operands(inst);
+            for (auto operand : operands) {
+                if (fn[operand].op == IR_ALLOC) ++uses[operand].first;
+            }
+            if (value.op == IR_LOAD && fn[operands[0]].op == IR_ALLOC) {
+                ++uses[operands[0]].second;
+            } else if (value.op == IR_STORE && fn[operands[1]].op == IR_ALLOC) {
+                ++uses[operands[1]].second;
+            }
+        }
+    }
+
+    PromotedSlots slots;
+    slots.slot_of.assign(fn.values.size(), kNoId);
+    for (auto alloc : candidates) {
+        const auto &cnt = uses[alloc];
+        if (cnt.first != cnt.second) continue;
+        slots.slot_of[alloc] = slots.allocs.size();
+        slots.allocs.push_back(alloc);
+    }
+    return slots;
+}
+
+class Mem2RegPass {
+    private:
+        IrFunction *fn = nullptr;
+        const ControlFlowGraph *graph = nullptr;
+        const std::vector<std::vector<uint32_t>> *frontiers = nullptr;
+        PromotedSlots slots;
+
+        // 新插入的参数在 phi_slots 中记录对应的槽位, 它们排在原有参数之后
+        std::vector<std::vector<uint32_t>> phi_slots;
+        std::vector<uint32_t> phi_base;         // 新参数在 params 中的起始位置
+        std::vector<ValueId> replacement;       // 被替换的 load, 按 ValueId 索引
+
+        // 重命名时各槽位的当前值, 以及离开支配树子树时用于恢复的日志
+        std::vector<ValueId> current;
+        std::vector<std::pair<uint32_t, ValueId>> undo_log;
+
+        ValueId Resolve(ValueId value) const {
+            return value < replacement.size() && replacement[value] != kNoId ? replacement[value] : value;
+        }
+
+        void Define(uint32_t slot, ValueId value) {
+            undo_log.emplace_back(slot, current[slot]);
+            current[slot] = value;
+        }
+
+        void PlaceBlockParams() {
+            size_t n = fn->blocks.size();
+            phi_slots.assign(n, {});
+            phi_base.resize(n);
+            for (uint32_t b = 0; b < n; ++b) phi_base[b] = fn->blocks[b].params.size();
+
+            std::vector<std::vector<uint32_t>> def_blocks(slots.allocs.size());
+            for (auto b : graph->rpo) {
+                for (auto inst : fn->blocks[b].insts) {
+                    if ((*fn)[inst].op != IR_STORE) continue;
+                    auto dest = fn->Operands(inst)[1];
+                    if (!slots.Contains(dest)) continue;
+                    auto &defs = def_blocks[slots[dest]];
+                    if (defs.empty() || defs.back() != b) defs.push_back(b);
+                }
+            }
+
+            std::vector<uint32_t> has_param(n, ControlFlowGraph::kNone), queued(n, ControlFlowGraph::kNone);
+            std::vector<uint32_t> worklist;
+            for (uint32_t slot = 0; slot < slots.allocs.size(); ++slot) {
+                worklist = def_blocks[slot];
+                for (auto b : worklist) queued[b] = slot;
+                while (!worklist.empty()) {
+                    auto b = worklist.back();
+                    worklist.pop_back();
+                    for (auto d : (*frontiers)[b]) {
+                        if (has_param[d] == slot) continue;
+                        has_param[d] = slot;
+                        fn->AddParam(d);
+                        phi_slots[d].push_back(slot);
+                        if (queued[d] != slot) {
+                            queued[d] = slot;
+                            worklist.push_back(d);
+                        }
+                    }
+                }
+            }
+        }
+
+        // 重写一个基本块, 并在出口处给后继的新参数传值
+        void RenameBlock(uint32_t b) {
+            const auto &bb = fn->blocks[b];
+            for (size_t i = 0; i < phi_slots[b].size(); ++i) Define(phi_slots[b][i], bb.params[phi_base[b] + i]);
+            for (auto inst : bb.insts) {
+                RewriteOperands(*fn, inst, [&](ValueId operand) { return Resolve(operand); });
+                auto operands = fn->Operands(inst);
+                auto op = (*fn)[inst].op;
+                if (op == IR_LOAD && slots.Contains(operands[0])) {
+                    replacement[inst] = current[slots[operands[0]]];
+                } else if (op == IR_STORE && slots.Contains(operands[1])) {
+                    Define(slots[operands[1]], operands[0]);
+                }
+            }
+            auto terminator = fn->Terminator(b);
+            if (terminator == kNoId) return;
+            for (auto s : graph->succs[b]) {
+                if (phi_slots[s].empty()) continue;
+                ForEachEdgeArgs(*fn, terminator, s, [&](std::vector<ValueId> &args) {
+                    for (auto slot : phi_slots[s]) args.push_back(current[slot]);
+                });
+            }
+        }
+
+        // 按支配树先序遍历可达的基本块; 不可达的基本块各自从 undef 开始
+        void Rename() {
+            current.assign(slots.allocs.size(), fn->Undef());
+            if (!graph->rpo.empty()) {
+                std::vector<std::pair<uint32_t, size_t>> stack;   // (基本块, 进入时的日志长度)
+                RenameBlock(graph->rpo[0]);
+                stack.emplace_back(graph->rpo[0], 0);
+                std::vector<size_t> next_child(fn->blocks.size(), 0);
+                while (!stack.empty()) {
+                    auto b = stack.back().first;
+                    if (next_child[b] < graph->dom_children[b].size()) {
+                        auto child = graph->dom_children[b][next_child[b]++];
+                        size_t mark = undo_log.size();
+                        RenameBlock(child);
+                        stack.emplace_back(child, mark);
+                        continue;
+                    }
+                    for (size_t mark = stack.back().second; undo_log.size() > mark; undo_log.pop_back()) {
+                        current[undo_log.back().first] = undo_log.back().second;
+                    }
+                    stack.pop_back();
+                }
+            }
+            for (auto b : graph->blocks) {
+                if (graph->Reachable(b)) continue;
+                current.assign(slots.allocs.size(), fn->Undef());
+                RenameBlock(b);
+                undo_log.clear();
+            }
+        }
+
+        bool IsPromotedAccess(ValueId inst) const {
+            switch ((*fn)[inst].op) {
+                case IR_ALLOC: return slots.Contains(inst);
+                case IR_LOAD: return slots.Contains(fn->Operands(inst)[0]);
+                case IR_STORE: return slots.Contains(fn->Operands(inst)[1]);
+                default: return false;
+            }
+        }
+
+        // 删去已提升的 alloc/load/store
+        void RemovePromotedAccesses() {
+            for (auto b : graph->blocks) {
+                auto &insts = fn->blocks[b].insts;
+                insts.erase(std::remove_if(insts.begin(), insts.end(),
+                                           [&](ValueId inst) { return IsPromotedAccess(inst); }), insts.end());
+            }
+        }
+
+        // 只被用作其他新参数的实参的参数是死的: 从真正的使用出发, 沿着边把活跃性传给实参
+        void PruneBlockParams() {
+            // 0: 不是新参数, 1: 新参数且尚未确定活跃, 2: 活跃的新参数
+            std::vector<uint8_t> state(fn->values.size(), 0);
+            bool any = false;
+            for (auto b : graph->blocks) {
+                const auto &params = fn->blocks[b].params;
+                for (size_t i = phi_base[b]; i < params.size(); ++i) state[params[i]] = 1, any = true;
+            }
+            if (!any) return;
+
+            std::vector<ValueId> worklist;
+            auto mark = [&](ValueId value) {
+                if (state[value] != 1) return;
+                state[value] = 2;
+                worklist.push_back(value);
+            };
+            // 新参数 -> 各条边上传给它的实参
+            std::unordered_map<ValueId, std::vector<ValueId>> incoming;
+            for (auto b : graph->blocks) {
+                for (auto inst : fn->blocks[b].insts) {
+                    auto op = (*fn)[inst].op;
+                    if (op == IR_BRANCH) mark(fn->Operands(inst)[0]);
+                    if (op != IR_BRANCH && op != IR_JUMP) {
+                        for (auto operand : fn->Operands(inst)) mark(operand);
+                        continue;
+                    }
+                    for (auto s : graph->succs[b]) {
+                        ForEachEdgeArgs(*fn, inst, s, [&](std::vector<ValueId> &args) {
+                            for (size_t j = 0; j < args.size(); ++j) {
+                                if (j < phi_base[s]) mark(args[j]);
+                                else incoming[fn->blocks[s].params[j]].push_back(args[j]);
+                            }
+                        });
+                    }
+                }
+            }
+            while (!worklist.empty()) {
+                auto param = worklist.back();
+                worklist.pop_back();
+                auto it = incoming.find(param);
+                if (it == incoming.end()) continue;
+                for (auto arg : it->second) mark(arg);
+            }
+
+            // 删去死参数和对应的实参, 剩下的参数重新编号
+            std::vector<std::vector<bool>> keep(fn->blocks.size());
+            for (auto b : graph->blocks) {
+                auto &params = fn->blocks[b].params;
+                keep[b].assign(params.size(), true);
+                std::vector<ValueId> kept;
+                for (size_t i = 0; i < params.size(); ++i) {
+                    if (state[params[i]] == 1) {
+                        keep[b][i] = false;
+                        continue;
+                    }
+                    (*fn)[params[i]].imm = kept.size();
+                    kept.push_back(params[i]);
+                }
+                params.assign(kept.begin(), kept.end());
+            }
+            for (auto b : graph->blocks) {
+                auto terminator = fn->Terminator(b);
+                if (terminator == kNoId) continue;
+                for (auto s : graph->succs[b]) {
+                    if (phi_slots[s].empty()) continue;
+                    ForEachEdgeArgs(*fn, terminator, s, [&](std::vector<ValueId> &args) {
+                        size_t len = 0;
+                        for (size_t j = 0; j < args.size(); ++j) {
+                            if (keep[s][j]) args[len++] = args[j];
+                        }
+                        args.resize(len);
+                    });
+                }
+            }
+        }
+
+    public:
+        // 返回是否提升了变量; 结束后使用者列表失效, 控制流图不变
+        bool Run(IrFunction &func, const ControlFlowGraph &cfg, const std::vector<std::vector<uint32_t>> &df) {
+            fn = &func;
+            graph = &cfg;
+            frontiers = &df;
+            slots = FindPromotableAllocs(func, cfg);
+            if (slots.allocs.empty()) return false;
+            replacement.assign(func.values.size(), kNoId);
+            undo_log.clear();
+
+            PlaceBlockParams();
+            Rename();
+            RemovePromotedAccesses();
+            PruneBlockParams();
+            return true;
+        }
+};
@@ -0,0 +1,293 @@
+#pragma once
+#include<cstdio>
+#include "arena.hpp"
+#include "ast.hpp"
+#include "lexer.hpp"
+
+// 手写的递归下降语法分析器, 由 -parser=rd 打开. 按需从扫描器取词法单元, 最多向前看两个.
+// 声明和语句的节点与 sysy.y 相同; 表达式用优先级爬升直接构造扁平的
+// BinaryExpr / UnaryExpr / Literal / VarRef, 不经过 Exp -> LOrExp -> ... -> PrimaryExp 的包装链.
+// 接受的语言和报错的格式都与 bison 生成的分析器相同.
+
+typedef enum {
+    PARSER_BISON,       // bison 生成的分析器
+    PARSER_RD,          // 手写的递归下降分析器
+} parser_t;
+
+int yylex(YYSTYPE *yylval, Scanner *scanner);
+const char *ScannerText(Scanner *scanner);
+int ScannerLine(Scanner *scanner);
+
+class Parser {
+    private:
+        Scanner *scanner;
+        Arena &arena;
+        int token = 0;                  // 当前的词法单元
+        YYSTYPE value;
+        bool has_next = false;          // 是否已经读入了下一个词法单元
+        int next_token = 0;
+        YYSTYPE next_value;
+        bool failed = false;
+
+        void Advance() {
+            if (has_next) {
+                token = next_token;
+                value = next_value;
+                has_next = false;
+            } else {
+                token = yylex(&value, scanner);
+            }
+        }
+
+        int Peek() {
+            if (!has_next) {
+                next_token = yylex(&next_value, scanner);
+                has_next = true;
+            }
+            return next_token;
+        }
+
+        // 与 yyerror 的输出相同, 只报告第一个错误
+        void Error() {
+            if (failed) return;
+            failed = true;
+            fprintf(stderr, "ERROR: syntax error at '%s' on line %d\n", ScannerText(scanner), ScannerLine(scanner));
+        }
+
+        bool Expect(int expected) {
+            if (token != expected) {
+                Error();
+                return false;
+            }
+            Advance();
+            return true;
+        }
+
+        bool ExpectIdent(SymbolId &ident) {
+            if (token != IDENT) {
+                Error();
+                return false;
+            }
+            ident = value.sym_val;
+            Advance();
+            return true;
+        }
+
+        // 二元运算符的优先级, 不是二元运算符时为 0
+        static int Precedence(int token, binaryop_t &op) {
+            switch (token) {
+                case LOR: op = BINARY_LOR; return 1;
+                case LAND: op = BINARY_LAND; return 2;
+                case EQ: op = BINARY_EQ; return 3;
+                case NE: op = BINARY_NE; return 3;
+                case '<': op = BINARY_LT; return 4;
+                case '>': op = BINARY_GT; return 4;
+                case LE: op = BINARY_LE; return 4;
+                case GE: op = BINARY_GE; return 4;
+                case '+': op = BINARY_ADD; return 5;
+                case '-': op = BINARY_SUB; return 5;
+                case '*': op = BINARY_MUL; return 6;
+                case '/': op = BINARY_DIV; return 6;
+                case '%': op = BINARY_MOD; return 6;
+                default: return 0;
+            }
+        }
+
+        // PrimaryExp ::= "(" Exp ")" | IDENT | INT_CONST; 括号不生成节点
+        BaseAST *ParsePrimary() {
+            if (token == '(') {
+                Advance();
+                BaseAST *exp = ParseExp();
+                if (!exp || !Expect(')')) return nullptr;
+                return exp;
+            }
+            if (token == IDENT) {
+                auto var_ref = arena.New<VarRefAST>();
+                var_ref->ident = value.sym_val;
+                Advance();
+                return var_ref;
+            }
+            if (token == INT_CONST) {
+                auto literal = arena.New<LiteralAST>();
+                literal->value = value.int_val;
+                Advance();
+                return literal;
+            }
+            Error();
+            return nullptr;
+        }
+
+        // UnaryExp ::= PrimaryExp | ("+" | "-" | "!") UnaryExp
+        BaseAST *ParseUnary() {
+            unaryop_t op;
+            switch (token) {
+                case '+': op = UNARY_PLUS; break;
+                case '-': op = UNARY_MINUS; break;
+                case '!': op = UNARY_NOT; break;
+                default: return ParsePrimary();
+            }
+            Advance();
+            BaseAST *operand = ParseUnary();
+            if (!operand) return nullptr;
+            auto unary = arena.New<UnaryExprAST>();
+            unary->op = op;
+            unary->operand = operand;
+            return unary;
+        }
+
+        // 优先级爬升: 只处理优先级不低于 min_prec 的运算符, 二元运算符都是左结合
+        BaseAST *ParseExp(int min_prec = 1) {
+            BaseAST *lhs = ParseUnary();
+            if (!lhs) return nullptr;
+            binaryop_t op = BINARY_LOR;
+            for (int prec; (prec = Precedence(token, op)) >= min_prec;) {
+                Advance();
+                BaseAST *rhs = ParseExp(prec + 1);
+                if (!rhs) return nullptr;
+                auto binary = arena.New<BinaryExprAST>();
+                binary->op = op;
+                binary->lhs = lhs;
+                binary->rhs = rhs;
+                lhs = binary;
+            }
+            return lhs;
+        }
+
+        // ConstDecl ::= "const" BType ConstDef {"," ConstDef} ";";
+        // ConstDef ::= IDENT "=" ConstInitVal;
+        BaseAST *ParseConstDecl() {
+            Advance();
+            if (!Expect(INT)) return nullptr;
+            auto constdecl = arena.New<ConstDeclAST>();
+            constdecl->btype = arena.New<BTypeAST>();
+            AstList *defs = nullptr;
+            for (;;) {
+                auto constdef = arena.New<ConstDefAST>();
+                if (!ExpectIdent(constdef->ident) || !Expect('=')) return nullptr;
+                BaseAST *exp = ParseExp();
+                if (!exp) return nullptr;
+                auto constexp = arena.New<ConstExpAST>();
+                constexp->exp = exp;
+                auto constinitval = arena.New<ConstInitValAST>();
+                constinitval->constexp = constexp;
+                constdef->constintval = constinitval;
+                if (defs) AstListAppend(arena, defs, constdef);
+                else defs = NewAstList(arena, constdef);
+                if (token != ',') break;
+                Advance();
+            }
+            if (!Expect(';')) return nullptr;
+            constdecl->constdef_list = AstListToSpan(arena, defs);
+            return constdecl;
+        }
+
+        // VarDecl ::= BType VarDef {"," VarDef} ";";
+        // VarDef ::= IDENT | IDENT "=" InitVal;
+        BaseAST *ParseVarDecl() {
+            Advance();
+            auto vardecl = arena.New<VarDeclAST>();
+            vardecl->btype = arena.New<BTypeAST>();
+            AstList *defs = nullptr;
+            for (;;) {
+                auto vardef = arena.New<VarDefAST>();
+                if (!ExpectIdent(vardef->ident)) return nullptr;
+                vardef->type = 1;
+                if (token == '=') {
+                    Advance();
+                    BaseAST *exp = ParseExp();
+                    if (!exp) return nullptr;
+                    auto initval = arena.New<InitValAST>();
+                    initval->exp = exp;
+                    vardef->type = 2;
+                    vardef->initval = initval;
+                }
+                if (defs) AstListAppend(arena, defs, vardef);
+                else defs = NewAstList(arena, vardef);
+                if (token != ',') break;
+                Advance();
+            }
+            if (!Expect(';')) return nullptr;
+            vardecl->vardef_list = AstListToSpan(arena, defs);
+            return vardecl;
+        }
+
+        // Stmt ::= LVal "=" Exp ";" | "return" Exp ";" | Block | [Exp] ";";
+        // 以 IDENT 开头时再向前看一个词法单元区分赋值和表达式语句
+        BaseAST *ParseStmt() {
+            auto stmt = arena.New<StmtAST>();
+            if (token == RETURN) {
+                Advance();
+                stmt->type = 2;
+                if (!(stmt->exp = ParseExp()) || !Expect(';')) return nullptr;
+            } else if (token == '{') {
+                stmt->type = 3;
+                if (!(stmt->block = ParseBlock())) return nullptr;
+            } else if (token == ';') {
+                Advance();
+                stmt->type = 4;
+            } else if (token == IDENT && Peek() == '=') {
+                auto lval = arena.New<LValAST>();
+                lval->ident = value.sym_val;
+                Advance();
+                Advance();
+                stmt->type = 1;
+                stmt->lval = lval;
+                if (!(stmt->exp = ParseExp()) || !Expect(';')) return nullptr;
+            } else {
+                stmt->type = 4;
+                if (!(stmt->exp = ParseExp()) || !Expect(';')) return nullptr;
+            }
+            return stmt;
+        }
+
+        // Block ::= "{" {BlockItem} "}";
+        // BlockItem ::= Decl | Stmt; Decl ::= ConstDecl | VarDecl;
+        BaseAST *ParseBlock() {
+            if (!Expect('{')) return nullptr;
+            auto block = arena.New<BlockAST>();
+            AstList *items = nullptr;
+            while (token != '}') {
+                BaseAST *item;
+                if (token == CONST || token == INT) {
+                    auto decl = arena.New<DeclAST>();
+                    if (!(decl->const_vardecl = token == CONST ? ParseConstDecl() : ParseVarDecl())) return nullptr;
+                    item = decl;
+                } else if (!(item = ParseStmt())) {
+                    return nullptr;
+                }
+                auto blockitem = arena.New<BlockItemAST>();
+                blockitem->decl_stmt = item;
+                if (items) AstListAppend(arena, items, blockitem);
+                else items = NewAstList(arena, blockitem);
+            }
+            Advance();
+            if (items) block->blockitem_list = AstListToSpan(arena, items);
+            return block;
+        }
+
+        // CompUnit ::= FuncDef; FuncDef ::= FuncType IDENT "(" ")" Block;
+        BaseAST *ParseCompUnit() {
+            if (!Expect(INT)) return nullptr;
+            auto func_def = arena.New<FuncDefAST>();
+            func_def->func_type = arena.New<FuncTypeAST>();
+            if (!ExpectIdent(func_def->ident) || !Expect('(') || !Expect(')')) return nullptr;
+            if (!(func_def->block = ParseBlock())) return nullptr;
+            if (token != 0) {
+                Error();
+                return nullptr;
+            }
+            auto comp_unit = arena.New<CompUnitAST>();
+            comp_unit->func_def = func_def;
+            return comp_unit;
+        }
+
+    public:
+        Parser(Scanner *scanner, Arena &arena) : scanner(scanner), arena(arena) {}
+
+        // 与 yyparse 相同: 成功时返回 0 并设置 ast, 语法错误时返回 1
+        int Parse(BaseAST *&ast) {
+            Advance();
+            ast = ParseCompUnit();
+            return ast ? 0 : 1;
+        }
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include<chrono>
+#include<cstdint>
+#include<cstring>
+#include<string>
+#include<vector>
+#include "cfg.hpp"
+#include "dce.hpp"
+#include "ir.hpp"
+#include "mem2reg.hpp"
+#include "sccp.hpp"
+#include "stats.hpp"
+
+// IR 上的 pass 管理. 每个 pass 声明用到和保持的分析, 分析结果按函数缓存,
+// 第一次用到时才计算; pass 修改了 IR 后, 没有声明保持的分析失效.
+// -passes= 给出流水线, -O0/-O1/-O2 为预设. 窥孔优化和强度削弱在生成机器指令时进行,
+// 也可以写在流水线中, 由流水线打开对应的后端选项.
+
+typedef enum : unsigned {
+    ANALYSIS_CFG = 1,           // 控制流图和支配树
+    ANALYSIS_FRONTIERS = 2,     // 支配边界, 依赖控制流图
+    ANALYSIS_USES = 4,          // IrFunction 的使用者列表
+    ANALYSIS_ALL = 7
+} analysis_t;
+
+static const char *analysis_names[] = {"cfg", "dominance frontiers", "uses"};
+
+// 一个函数的分析缓存, 同时记录各分析的计算次数和耗时
+class AnalysisCache {
+    private:
+        IrFunction &fn;
+        CompileStats &stats;
+        unsigned valid = 0;
+        ControlFlowGraph cfg;
+        std::vector<std::vector<uint32_t>> frontiers;
+
+        template<typename F>
+        void Compute(analysis_t analysis, F f) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            valid |= analysis;
+            int index = __builtin_ctz(analysis);
+            stats.Pass(analysis_names[index], true).Record(start, false);
+        }
+
+    public:
+        AnalysisCache(IrFunction &fn, CompileStats &stats) : fn(fn), stats(stats) {}
+
+        const ControlFlowGraph &Cfg() {
+            if (!(valid & ANALYSIS_CFG)) Compute(ANALYSIS_CFG, [&] { cfg = BuildCfg(fn); });
+            return cfg;
+        }
+
+        const std::vector<std::vector<uint32_t>> &Frontiers() {
+            const auto &graph = Cfg();
+            if (!(valid & ANALYSIS_FRONTIERS)) Compute(ANALYSIS_FRONTIERS, [&] { frontiers = graph.DominanceFrontiers(); });
+            return frontiers;
+        }
+
+        void RequireUses() {
+            if (!(valid & ANALYSIS_USES)) Compute(ANALYSIS_USES, [&] { fn.ComputeUses(); });
+        }
+
+        // 只保留 preserved 中的分析; 依赖控制流图的分析随之失效
+        void Invalidate(unsigned preserved) {
+            if (!(preserved & ANALYSIS_CFG)) preserved &= ~ANALYSIS_FRONTIERS;
+            valid &= preserved;
+        }
+};
+
+struct PassInfo {
+    const char *name;
+    unsigned preserves;     // 修改 IR 后仍然有效的分析
+    // 返回是否修改了 IR; 后端的 pass 为 nullptr
+    bool (*run)(IrFunction &fn, AnalysisCache &analyses);
+};
+
+static bool RunMem2Reg(IrFunction &fn, AnalysisCache &analyses) {
+    return Mem2RegPass().Run(fn, analyses.Cfg(), analyses.Frontiers());
+}
+
+static bool RunSccp(IrFunction &fn, AnalysisCache &analyses) {
+    analyses.RequireUses();
+    return SccpPass().Run(fn, analyses.Cfg());
+}
+
+static bool RunDce(IrFunction &fn, AnalysisCache &analyses) {
+    return DcePass().Run(fn, analyses.Cfg());
+}
+
+// mem2reg 只增加基本块参数和实参, 不改变控制流
+static const PassInfo pass_registry[] = {
+    {"mem2reg", ANALYSIS_CFG | ANALYSIS_FRONTIERS, RunMem2Reg},
+    {"sccp", 0, RunSccp},
+    {"dce", 0, RunDce},
+    {"strength-reduce", ANALYSIS_ALL, nullptr},
+    {"peephole", ANALYSIS_ALL, nullptr},
+};
+
+struct PassPipeline {
+    std::vector<const PassInfo *> ir_passes;
+    bool strength_reduce = false;
+    bool peephole = false;
+
+    // 追加一个 pass, 名字不存在时返回 false
+    bool Add(const std::string &name) {
+        for (const auto &pass : pass_registry) {
+            if (name != pass.name) continue;
+            if (pass.run) ir_passes.push_back(&pass);
+            else if (name == "strength-reduce") strength_reduce = true;
+            else peephole = true;
+            return true;
+        }
+        return false;
+    }
+
+    bool Contains(const std::string &name) const {
+        for (auto pass : ir_passes) {
+            if (name == pass->name) return true;
+        }
+        return (name == "strength-reduce" && strength_reduce) || (name == "peephole" && peephole);
+    }
+
+    // 逗号分隔的 pass 名, 如 "mem2reg,sccp,dce,peephole"; 出错时 error 为无法识别的名字
+    bool Parse(const std::string &text, std::string &error) {
+        *this = PassPipeline();
+        size_t begin = 0;
+        while (begin <= text.size()) {
+            size_t end = text.find(',', begin);
+            if (end == std::string::npos) end = text.size();
+            std::string name = text.substr(begin, end - begin);
+            if (!name.empty() && !Add(name)) {
+                error = name;
+                return false;
+            }
+            begin = end + 1;
+        }
+        return true;
+    }
+};
+
+// -O 预设对应的流水线, 级别不存在时返回 nullptr
+static const char *OptLevelPipeline(const std::string &level) {
+    if (level == "0") return "";
+    if (level == "1") return "mem2reg,sccp,dce,peephole";
+    if (level == "2") return "mem2reg,sccp,dce,strength-reduce,peephole";
+    return nullptr;
+}
+
+// 对每个函数依次运行流水线中的 IR pass, 耗时记入 stats; pass 的耗时包含它触发的分析
+static void RunPasses(IrModule &module, const PassPipeline &pipeline, CompileStats &stats) {
+    if (pipeline.ir_passes.empty()) return;
+    for (auto &fn : module.funcs) {
+        AnalysisCache analyses(fn, stats);
+        for (auto pass : pipeline.ir_passes) {
+            auto start = std::chrono::steady_clock::now();
+            bool changed = pass->run(fn, analyses);
+            stats.Pass(pass->name, false).Record(start, changed);
+            if (changed) analyses.Invalidate(pass->preserves);
+        }
+        // 后端和输出不依赖使用者列表, 但保持 IR 处于一致的状态
+        analyses.RequireUses();
+    }
+}
@@ -0,0 +1,425 @@
+#pragma once
+#include<cassert>
+#include<chrono>
+#include<cstdint>
+#include<unordered_map>
+#include<unordered_set>
+#include<vector>
+#include "emitter.hpp"
+#include "machine.hpp"
+#include "riscv.hpp"
+
+// 机器指令上的窥孔优化. 每轮先做函数内的寄存器活跃分析, 再按规则改写相邻指令,
+// 直到不再变化. 删去的指令先改为 RV_NOP, 每轮结束时压缩.
+
+typedef enum {
+    PEEPHOLE_STORE_LOAD,    // sw 之后读同一栈槽的 lw 改为 mv 或删去
+    PEEPHOLE_DEAD_STORE,    // 被覆盖或从不读取的栈槽写入
+    PEEPHOLE_IMMEDIATE,     // li + R 型指令合并为 addi/andi/ori/xori/slti/移位立即数
+    PEEPHOLE_ZERO_REG,      // li r, 0 的使用改为 zero 寄存器
+    PEEPHOLE_COMPARE,       // seqz/snez/xor/slt/sgt 与其后的 seqz/snez/分支合并
+    PEEPHOLE_MOVE,          // mv r, r 以及加 0 等恒等运算
+    PEEPHOLE_DEAD_DEF,      // 结果不再使用的计算
+    PEEPHOLE_JUMP,          // 跳到紧随其后的标号, 跳过一条 j 的分支, 跳转之后不可达的指令和无人引用的标号
+    PEEPHOLE_RULE_NUM
+} peephole_rule_t;
+
+static const char *peephole_rule_names[] = {
+    "store-load forwarding", "dead store", "immediate form", "zero register",
+    "compare chain", "redundant move", "dead definition", "branch and jump"
+};
+
+struct PeepholeStats {
+    uint64_t removed[PEEPHOLE_RULE_NUM] = {};       // 删去的指令条数
+    uint64_t rewritten[PEEPHOLE_RULE_NUM] = {};     // 原地改写的指令条数
+    uint64_t functions = 0;                         // 处理的函数个数, 以及其中有改动的个数
+    uint64_t changed_functions = 0;
+    double millis = 0;
+
+    void Add(const PeepholeStats &other) {
+        for (int i = 0; i < PEEPHOLE_RULE_NUM; ++i) {
+            removed[i] += other.removed[i];
+            rewritten[i] += other.rewritten[i];
+        }
+        functions += other.functions;
+        changed_functions += other.changed_functions;
+        millis += other.millis;
+    }
+};
+
+class PeepholePass {
+    private:
+        MachineFunction &mf;
+        PeepholeStats &stats;
+        std::vector<uint32_t> live_after;      // 每条指令之后活跃的寄存器
+        bool changed = false;
+
+        std::vector<MachineInst> &insts() { return mf.insts; }
+
+        void Remove(size_t i, peephole_rule_t rule) {
+            insts()[i].op = RV_NOP;
+            ++stats.removed[rule];
+            changed = true;
+        }
+
+        void Rewrite(size_t i, const MachineInst &inst, peephole_rule_t rule) {
+            insts()[i] = inst;
+            ++stats.rewritten[rule];
+            changed = true;
+        }
+
+        // 同一基本块中的下一条指令, 没有时返回 size()
+        size_t Next(size_t i) const {
+            for (size_t j = i + 1; j < mf.insts.size(); ++j) {
+                if (mf.insts[j].op == RV_LABEL) return mf.insts.size();
+                if (mf.insts[j].op != RV_NOP) return j;
+            }
+            return mf.insts.size();
+        }
+
+        // i 定义的 reg 只被 j 使用: j 读取 reg, 并且之后 reg 不再活跃或被 j 重新定义
+        bool OnlyUsedBy(reg_t reg, size_t j) const {
+            const auto &use = mf.insts[j];
+            uint32_t bit = RegBit(reg);
+            return bit && (UseMask(use) & bit) && ((DefMask(use) & bit) || !(live_after[j] & bit));
+        }
+
+        // 以标号和跳转划分基本块, 迭代求出每条指令之后的活跃寄存器
+        void ComputeLiveness() {
+            const auto &code = mf.insts;
+            size_t n = code.size();
+            std::vector<size_t> block_start;
+            std::vector<uint32_t> block_of(n);
+            std::vector<int> label_block(mf.label_cnt, -1);
+            for (size_t i = 0; i < n; ++i) {
+                bool leader = i == 0 || code[i].op == RV_LABEL || code[i - 1].IsTerminator();
+                if (leader) block_start.push_back(i);
+                block_of[i] = block_start.size() - 1;
+                if (code[i].op == RV_LABEL) label_block[code[i].imm] = block_of[i];
+            }
+            size_t block_num = block_start.size();
+            std::vector<std::vector<uint32_t>> succs(block_num);
+            for (size_t b = 0; b < block_num; ++b) {
+                size_t last = (b + 1 < block_num ? block_start[b + 1] : n) - 1;
+                const auto &inst = code[last];
+                bool falls = inst.op != RV_J && inst.op != RV_RET;
+                if (inst.op == RV_J || inst.IsBranch()) {
+                    assert(label_block[inst.imm] >= 0);
+                    succs[b].push_back(label_block[inst.imm]);
+                }
+                if (falls && b + 1 < block_num) succs[b].push_back(b + 1);
+            }
+
+            std::vector<uint32_t> live_in(block_num, 0);
+            live_after.assign(n, 0);
+            bool changed_live = true;
+            while (changed_live) {
+                changed_live = false;
+                for (size_t b = block_num; b-- > 0;) {
+                    uint32_t live = 0;
+                    for (auto s : succs[b]) live |= live_in[s];
+                    size_t end = b + 1 < block_num ? block_start[b + 1] : n;
+                    for (size_t i = end; i-- > block_start[b];) {
+                        live_after[i] = live;
+                        live = (live & ~DefMask(code[i])) | UseMask(code[i]);
+                    }
+                    if (live != live_in[b]) {
+                        live_in[b] = live;
+                        changed_live = true;
+                    }
+                }
+            }
+        }
+
+        // li r, C 后紧跟使用 r 的指令
+        void CombineLi(size_t i) {
+            const auto li = mf.insts[i];
+            size_t j = Next(i);
+            if (j == mf.insts.size() || !OnlyUsedBy(li.rd, j)) return;
+            auto use = mf.insts[j];
+
+            if (li.imm == 0) {
+                if (use.rs1 == li.rd) use.rs1 = REG_ZERO;
+                if (use.rs2 == li.rd) use.rs2 = REG_ZERO;
+                Remove(i, PEEPHOLE_ZERO_REG);
+                Rewrite(j, use, PEEPHOLE_ZERO_REG);
+                return;
+            }
+
+            if (use.Format() != RV_FMT_R) return;
+            reg_t other = use.rs1;
+            if (use.rs2 != li.rd) {
+                // 可交换的运算把立即数换到右边
+                bool commutative = use.op == RV_ADD || use.op == RV_AND || use.op == RV_OR || use.op == RV_XOR;
+                if (!commutative || use.rs1 != li.rd) return;
+                other = use.rs2;
+            }
+            if (other == li.rd) return;
+
+            int64_t imm = li.imm;
+            rv_opcode_t op;
+            switch (use.op) {
+                case RV_ADD: op = RV_ADDI; break;
+                case RV_SUB: op = RV_ADDI; imm = -imm; break;
+                case RV_AND: op = RV_ANDI; break;
+                case RV_OR: op = RV_ORI; break;
+                case RV_XOR: op = RV_XORI; break;
+                case RV_SLT: op = RV_SLTI; break;
+                case RV_SLL: op = RV_SLLI; imm &= 31; break;
+                case RV_SRL: op = RV_SRLI; imm &= 31; break;
+                case RV_SRA: op = RV_SRAI; imm &= 31; break;
+                default: return;
+            }
+            if (!IsImm12(imm)) return;
+            Remove(i, PEEPHOLE_IMMEDIATE);
+            Rewrite(j, MachineInst::I(op, use.rd, other, int32_t(imm)), PEEPHOLE_IMMEDIATE);
+        }
+
+        // 比较结果只被下一条 seqz/snez/分支使用时直接合并
+        void CombineCompare(size_t i) {
+            const auto cmp = mf.insts[i];
+            size_t j = Next(i);
+            if (j == mf.insts.size() || !OnlyUsedBy(cmp.rd, j)) return;
+            const auto use = mf.insts[j];
+            if (use.Format() == RV_FMT_RR && use.op != RV_SEQZ && use.op != RV_SNEZ) return;
+
+            if (cmp.op == RV_SEQZ || cmp.op == RV_SNEZ) {
+                // seqz 翻转真假, snez 保持
+                bool invert = cmp.op == RV_SEQZ;
+                MachineInst merged = use;
+                merged.rs1 = cmp.rs1;
+                switch (use.op) {
+                    case RV_SEQZ: merged.op = invert ? RV_SNEZ : RV_SEQZ; break;
+                    case RV_SNEZ: merged.op = invert ? RV_SEQZ : RV_SNEZ; break;
+                    case RV_BEQZ: merged.op = invert ? RV_BNEZ : RV_BEQZ; break;
+                    case RV_BNEZ: merged.op = invert ? RV_BEQZ : RV_BNEZ; break;
+                    default: return;
+                }
+                Remove(i, PEEPHOLE_COMPARE);
+                Rewrite(j, merged, PEEPHOLE_COMPARE);
+                return;
+            }
+
+            if (use.op != RV_BEQZ && use.op != RV_BNEZ) return;
+            bool taken_if_true = use.op == RV_BNEZ;
+            rv_opcode_t op;
+            switch (cmp.op) {
+                case RV_XOR: op = taken_if_true ? RV_BNE : RV_BEQ; break;
+                case RV_SLT: op = taken_if_true ? RV_BLT : RV_BGE; break;
+                case RV_SGT: op = taken_if_true ? RV_BGT : RV_BLE; break;
+                default: return;
+            }
+            Remove(i, PEEPHOLE_COMPARE);
+            Rewrite(j, MachineInst::Branch(op, cmp.rs1, cmp.rs2, use.imm), PEEPHOLE_COMPARE);
+        }
+
+        // 恒等运算改为 mv, 自身之间的 mv 删去
+        void SimplifyIdentity(size_t i) {
+            const auto inst = mf.insts[i];
+            bool identity = false;
+            switch (inst.op) {
+                case RV_ADD: case RV_SUB: case RV_OR: case RV_XOR: case RV_SLL: case RV_SRL: case RV_SRA:
+                    identity = inst.rs2 == REG_ZERO;
+                    break;
+                case RV_ADDI: case RV_ORI: case RV_XORI: case RV_SLLI: case RV_SRLI: case RV_SRAI:
+                    identity = inst.imm == 0;
+                    break;
+                default:
+                    break;
+            }
+            if (identity) {
+                Rewrite(i, MachineInst::Unary(RV_MV, inst.rd, inst.rs1), PEEPHOLE_MOVE);
+            }
+            if (mf.insts[i].op == RV_MV && mf.insts[i].rd == mf.insts[i].rs1) Remove(i, PEEPHOLE_MOVE);
+        }
+
+        void RegisterRules() {
+            ComputeLiveness();
+            for (size_t i = 0; i < mf.insts.size(); ++i) {
+                auto &inst = mf.insts[i];
+                if (inst.op == RV_NOP || inst.op == RV_LABEL) continue;
+                uint32_t def = DefMask(inst);
+                // sp 在 ret 处活跃, 调整栈帧的 addi 不会被删去
+                if (def && !(live_after[i] & def)) {
+                    Remove(i, PEEPHOLE_DEAD_DEF);
+                    continue;
+                }
+                if (inst.op == RV_LI) CombineLi(i);
+                else if (inst.op == RV_SEQZ || inst.op == RV_SNEZ || inst.op == RV_XOR ||
+                         inst.op == RV_SLT || inst.op == RV_SGT) CombineCompare(i);
+                if (mf.insts[i].op != RV_NOP) SimplifyIdentity(i);
+            }
+        }
+
+        // 基本块内记录各栈槽当前与哪个寄存器的值相同, 命中时 lw 改为 mv 或删去;
+        // 块内被再次写入前没有读取的 sw 删去
+        void MemoryRules() {
+            std::unordered_map<int32_t, reg_t> slot_reg;
+            std::unordered_map<int32_t, size_t> last_store;     // 之后还未被读取的 sw
+            std::unordered_set<int32_t> loaded;                 // 函数中被 lw 读取过的栈槽
+            for (const auto &inst : mf.insts) {
+                if (inst.op == RV_LW && inst.rs1 == REG_SP) loaded.insert(inst.imm);
+            }
+
+            for (size_t i = 0; i < mf.insts.size(); ++i) {
+                auto inst = mf.insts[i];
+                if (inst.op == RV_LABEL || inst.IsTerminator()) {
+                    slot_reg.clear();
+                    last_store.clear();
+                    continue;
+                }
+                if (inst.op == RV_NOP) continue;
+
+                if (inst.op == RV_SW && inst.rs1 == REG_SP) {
+                    if (!loaded.count(inst.imm)) {
+                        Remove(i, PEEPHOLE_DEAD_STORE);
+                        continue;
+                    }
+                    auto it = last_store.find(inst.imm);
+                    if (it != last_store.end()) Remove(it->second, PEEPHOLE_DEAD_STORE);
+                    last_store[inst.imm] = i;
+                    slot_reg[inst.imm] = inst.rs2;
+                    continue;
+                }
+
+                if (inst.op == RV_LW && inst.rs1 == REG_SP) {
+                    last_store.erase(inst.imm);
+                    auto it = slot_reg.find(inst.imm);
+                    if (it != slot_reg.end()) {
+                        if (it->second == inst.rd) {
+                            Remove(i, PEEPHOLE_STORE_LOAD);
+                            continue;
+                        }
+                        inst = MachineInst::Unary(RV_MV, inst.rd, it->second);
+                        Rewrite(i, inst, PEEPHOLE_STORE_LOAD);
+                    }
+                }
+
+                // 被改写的寄存器不再与栈槽相同; sp 改变时所有记录失效
+                uint32_t def = DefMask(inst);
+                if (!def) continue;
+                if (def & RegBit(REG_SP)) {
+                    slot_reg.clear();
+                    last_store.clear();
+                    continue;
+                }
+                for (auto it = slot_reg.begin(); it != slot_reg.end();) {
+                    if (RegBit(it->second) & def) it = slot_reg.erase(it);
+                    else ++it;
+                }
+                if (mf.insts[i].op == RV_LW) slot_reg[inst.imm] = inst.rd;
+            }
+        }
+
+        size_t NextInst(size_t i) const {
+            size_t j = i + 1;
+            while (j < mf.insts.size() && mf.insts[j].op == RV_NOP) ++j;
+            return j;
+        }
+
+        static rv_opcode_t InvertBranch(rv_opcode_t op) {
+            switch (op) {
+                case RV_BEQZ: return RV_BNEZ;
+                case RV_BNEZ: return RV_BEQZ;
+                case RV_BEQ: return RV_BNE;
+                case RV_BNE: return RV_BEQ;
+                case RV_BLT: return RV_BGE;
+                case RV_BGE: return RV_BLT;
+                case RV_BGT: return RV_BLE;
+                default: return RV_BGT;     // RV_BLE
+            }
+        }
+
+        // 跳到紧随其后的标号的跳转; "b L1; j L2; L1:" 反转为 "b' L2; L1:";
+        // j/ret 之后到下一个标号之前的指令; 没有跳转指向的标号删去, 前后两块合并
+        void JumpRules() {
+            auto &code = mf.insts;
+            std::vector<bool> referenced(mf.label_cnt, false);
+            for (const auto &inst : code) {
+                if (inst.op == RV_J || inst.IsBranch()) referenced[inst.imm] = true;
+            }
+            for (size_t i = 0; i < code.size(); ++i) {
+                const auto inst = code[i];
+                if (inst.op == RV_LABEL && !referenced[inst.imm]) {
+                    Remove(i, PEEPHOLE_JUMP);
+                    continue;
+                }
+                if (inst.op == RV_J || inst.IsBranch()) {
+                    size_t j = NextInst(i);
+                    if (j < code.size() && code[j].op == RV_LABEL && code[j].imm == inst.imm) {
+                        Remove(i, PEEPHOLE_JUMP);
+                        continue;
+                    }
+                    if (inst.IsBranch() && j < code.size() && code[j].op == RV_J) {
+                        size_t k = NextInst(j);
+                        if (k < code.size() && code[k].op == RV_LABEL && code[k].imm == inst.imm) {
+                            auto inverted = inst;
+                            inverted.op = InvertBranch(inst.op);
+                            inverted.imm = code[j].imm;
+                            Rewrite(i, inverted, PEEPHOLE_JUMP);
+                            Remove(j, PEEPHOLE_JUMP);
+                            continue;
+                        }
+                    }
+                }
+                if (inst.op == RV_J || inst.op == RV_RET) {
+                    for (size_t j = i + 1; j < code.size() && code[j].op != RV_LABEL; ++j) {
+                        if (code[j].op != RV_NOP) Remove(j, PEEPHOLE_JUMP);
+                    }
+                }
+            }
+        }
+
+        void Compact() {
+            size_t len = 0;
+            for (const auto &inst : mf.insts) {
+                if (inst.op != RV_NOP) mf.insts[len++] = inst;
+            }
+            mf.insts.resize(len);
+        }
+
+    public:
+        PeepholePass(MachineFunction &mf, PeepholeStats &stats) : mf(mf), stats(stats) {}
+
+        // 寄存器规则依赖本轮开始时的活跃信息, 只会删去使用或把使用换成更早的寄存器;
+        // 栈槽转发会延长寄存器的活跃范围, 放在每轮最后, 下一轮重新分析
+        bool Run() {
+            bool any_change = false;
+            for (int round = 0; round < 16; ++round) {
+                changed = false;
+                RegisterRules();
+                Compact();
+                MemoryRules();
+                JumpRules();
+                Compact();
+                any_change |= changed;
+                if (!changed) break;
+            }
+            return any_change;
+        }
+};
+
+static void RunPeephole(MachineFunction &mf, PeepholeStats &stats) {
+    auto start = std::chrono::steady_clock::now();
+    ++stats.functions;
+    stats.changed_functions += PeepholePass(mf, stats).Run();
+    stats.millis += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static inline void PrintPeepholeStats(Emitter &out, const PeepholeStats &stats) {
+    out << "peephole rule            removed  rewritten\n";
+    uint64_t total_removed = 0, total_rewritten = 0;
+    for (int i = 0; i < PEEPHOLE_RULE_NUM; ++i) {
+        char line[64];
+        std::snprintf(line, sizeof(line), "  %-21s%9llu%11llu\n", peephole_rule_names[i],
+                      static_cast<unsigned long long>(stats.removed[i]),
+                      static_cast<unsigned long long>(stats.rewritten[i]));
+        out << line;
+        total_removed += stats.removed[i];
+        total_rewritten += stats.rewritten[i];
+    }
+    char line[64];
+    std::snprintf(line, sizeof(line), "  %-21s%9llu%11llu\n", "total",
+                  static_cast<unsigned long long>(total_removed), static_cast<unsigned long long>(total_rewritten));
+    out << line;
+}
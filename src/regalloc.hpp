@@ -0,0 +1,238 @@
+#pragma once
+#include<algorithm>
+#include<cassert>
+#include<climits>
+#include<cstdint>
+#include<vector>
+#include "ir.hpp"
+#include "riscv.hpp"
+
+// 寄存器分配: 活跃变量分析 + 线性扫描.
+// t0/t1 保留给溢出值和立即数作为临时寄存器, 其余 t/a/s 寄存器参与分配.
+
+typedef enum {
+    REGALLOC_SPILL,     // 每个值占一个栈槽 (原有方案)
+    REGALLOC_LINEAR     // 线性扫描, 只在寄存器不足时溢出
+} regalloc_mode_t;
+
+static regalloc_mode_t regalloc_mode = REGALLOC_LINEAR;
+
+static const reg_t alloc_regs[] = {
+    REG_T2, REG_T3, REG_T4, REG_T5, REG_T6,
+    REG_A1, REG_A2, REG_A3, REG_A4, REG_A5, REG_A6, REG_A7, REG_A0,
+    REG_S1, REG_S2, REG_S3, REG_S4, REG_S5, REG_S6, REG_S7, REG_S8, REG_S9, REG_S10, REG_S11, REG_S0
+};
+static const int alloc_reg_num = sizeof(alloc_regs) / sizeof(alloc_regs[0]);
+
+struct LiveInterval {
+    ValueId value;
+    int start, end;
+};
+
+struct RegAllocResult {
+    std::vector<reg_t> reg;                 // 按 ValueId 索引, 未分配寄存器为 REG_NONE
+    std::vector<bool> spilled;              // 按 ValueId 索引, 需要栈槽的值
+    int spill_cnt = 0;
+    std::vector<LiveInterval> spill_intervals;     // 溢出值的活跃区间, 按起点排序, 供栈帧布局复用栈槽
+    std::vector<reg_t> callee_saved;        // 用到的 s 寄存器
+};
+
+// 需要存放在寄存器中的值: 有结果的指令(alloc 除外)与基本块参数
+static bool NeedsReg(const IrFunction &fn, ValueId value) {
+    return fn[value].HasResult();
+}
+
+// 对指令读取的每个需要寄存器的操作数调用 f
+template<typename F>
+static void ForEachUse(const IrFunction &fn, ValueId inst, F f) {
+    for (auto use : fn.Operands(inst)) {
+        if (NeedsReg(fn, use)) f(use);
+    }
+}
+
+// 按 ValueId 索引的位集
+class ValueSet {
+    private:
+        std::vector<uint64_t> words;
+
+    public:
+        explicit ValueSet(size_t n = 0) : words((n + 63) >> 6, 0) {}
+
+        void Insert(uint32_t i) { words[i >> 6] |= uint64_t(1) << (i & 63); }
+        bool Contains(uint32_t i) const { return words[i >> 6] >> (i & 63) & 1; }
+
+        // this |= other & ~mask, 返回是否有变化
+        bool UnionWithout(const ValueSet &other, const ValueSet &mask) {
+            bool changed = false;
+            for (size_t i = 0; i < words.size(); ++i) {
+                uint64_t word = words[i] | (other.words[i] & ~mask.words[i]);
+                changed |= word != words[i];
+                words[i] = word;
+            }
+            return changed;
+        }
+
+        bool UnionWith(const ValueSet &other) {
+            bool changed = false;
+            for (size_t i = 0; i < words.size(); ++i) {
+                uint64_t word = words[i] | other.words[i];
+                changed |= word != words[i];
+                words[i] = word;
+            }
+            return changed;
+        }
+
+        template<typename F>
+        void ForEach(F f) const {
+            for (size_t i = 0; i < words.size(); ++i) {
+                for (uint64_t word = words[i]; word; word &= word - 1) {
+                    f(uint32_t((i << 6) + __builtin_ctzll(word)));
+                }
+            }
+        }
+};
+
+// 按基本块顺序给指令定位: 第 k 条指令在 2k 读操作数, 在 2k+1 写结果;
+// 基本块参数在块首 2*first 处定义. 活跃区间取所有定义/使用/跨块活跃位置的包络.
+static std::vector<LiveInterval> BuildIntervals(const IrFunction &fn) {
+    const auto &blocks = fn.layout;
+    size_t value_num = fn.values.size();
+    size_t block_num = fn.blocks.size();
+
+    std::vector<int> start(value_num, INT_MAX), end(value_num, -1);
+    auto touch = [&](uint32_t value, int pos) {
+        start[value] = std::min(start[value], pos);
+        end[value] = std::max(end[value], pos);
+    };
+
+    std::vector<int> block_start(block_num), block_end(block_num);
+    std::vector<ValueSet> use(block_num, ValueSet(value_num)), def(block_num, ValueSet(value_num));
+    int pos = 0;
+    for (auto b : blocks) {
+        block_start[b] = pos * 2;
+        for (auto param : fn.blocks[b].params) {
+            def[b].Insert(param);
+            touch(param, pos * 2);
+        }
+        for (auto inst : fn.blocks[b].insts) {
+            ForEachUse(fn, inst, [&](ValueId operand) {
+                if (!def[b].Contains(operand)) use[b].Insert(operand);
+                touch(operand, pos * 2);
+            });
+            if (NeedsReg(fn, inst)) {
+                def[b].Insert(inst);
+                touch(inst, pos * 2 + 1);
+            }
+            ++pos;
+        }
+        block_end[b] = std::max(block_start[b], pos * 2 - 1);
+    }
+
+    // 活跃变量分析 (逆序迭代至不动点)
+    std::vector<ValueSet> live_in = use, live_out(block_num, ValueSet(value_num));
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = blocks.size(); i-- > 0;) {
+            auto b = blocks[i];
+            BlockId succs[2];
+            uint32_t succ_cnt = fn.Successors(b, succs);
+            for (uint32_t k = 0; k < succ_cnt; ++k) live_out[b].UnionWith(live_in[succs[k]]);
+            changed |= live_in[b].UnionWithout(live_out[b], def[b]);
+        }
+    }
+
+    for (auto b : blocks) {
+        live_in[b].ForEach([&](uint32_t value) { touch(value, block_start[b]); });
+        live_out[b].ForEach([&](uint32_t value) { touch(value, block_end[b]); });
+    }
+
+    std::vector<LiveInterval> result;
+    for (uint32_t value = 0; value < value_num; ++value) {
+        if (end[value] >= 0 && NeedsReg(fn, value)) {
+            result.push_back(LiveInterval{value, start[value], end[value]});
+        }
+    }
+    std::stable_sort(result.begin(), result.end(), [](const LiveInterval &a, const LiveInterval &b) {
+        return a.start < b.start;
+    });
+    return result;
+}
+
+// reserved 不参与分配, 大栈帧时留作计算地址的临时寄存器
+static RegAllocResult AllocateRegisters(const IrFunction &fn, reg_t reserved = REG_NONE) {
+    RegAllocResult result;
+    result.reg.assign(fn.values.size(), REG_NONE);
+    result.spilled.assign(fn.values.size(), false);
+    auto intervals = BuildIntervals(fn);
+
+    auto spill = [&](const LiveInterval &interval) {
+        result.spilled[interval.value] = true;
+        result.spill_cnt++;
+        result.spill_intervals.push_back(interval);
+    };
+
+    if (regalloc_mode == REGALLOC_SPILL) {
+        for (const auto &interval : intervals) spill(interval);
+        return result;
+    }
+
+    std::vector<bool> reg_free(alloc_reg_num, true);
+    for (int i = 0; i < alloc_reg_num; ++i) {
+        if (alloc_regs[i] == reserved) reg_free[i] = false;
+    }
+    std::vector<int> slot_of(fn.values.size(), -1);     // 值 -> alloc_regs 下标
+    std::vector<LiveInterval> active;     // 按 end 升序
+
+    for (const auto &cur : intervals) {
+        // 释放已结束的区间
+        size_t expired = 0;
+        while (expired < active.size() && active[expired].end < cur.start) {
+            reg_free[slot_of[active[expired].value]] = true;
+            ++expired;
+        }
+        active.erase(active.begin(), active.begin() + expired);
+
+        int slot = -1;
+        for (int i = 0; i < alloc_reg_num; ++i) {
+            if (reg_free[i]) {
+                slot = i;
+                break;
+            }
+        }
+
+        if (slot < 0) {
+            // 无空闲寄存器: 溢出结束最晚的区间
+            auto &victim = active.back();
+            if (victim.end > cur.end) {
+                slot = slot_of[victim.value];
+                slot_of[victim.value] = -1;
+                spill(victim);
+                active.pop_back();
+            } else {
+                spill(cur);
+                continue;
+            }
+        }
+
+        reg_free[slot] = false;
+        slot_of[cur.value] = slot;
+        auto pos = std::upper_bound(active.begin(), active.end(), cur, [](const LiveInterval &a, const LiveInterval &b) {
+            return a.end < b.end;
+        });
+        active.insert(pos, cur);
+    }
+
+    std::vector<bool> saved(alloc_reg_num, false);
+    for (uint32_t value = 0; value < fn.values.size(); ++value) {
+        if (slot_of[value] < 0) continue;
+        result.reg[value] = alloc_regs[slot_of[value]];
+        if (IsCalleeSaved(alloc_regs[slot_of[value]])) saved[slot_of[value]] = true;
+    }
+    for (int i = 0; i < alloc_reg_num; ++i) {
+        if (saved[i]) result.callee_saved.push_back(alloc_regs[i]);
+    }
+    std::stable_sort(result.spill_intervals.begin(), result.spill_intervals.end(),
+                     [](const LiveInterval &a, const LiveInterval &b) { return a.start < b.start; });
+    return result;
+}
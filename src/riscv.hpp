@@ -0,0 +1,26 @@
+#pragma once
+#include<cstdint>
+
+// RISC-V 整数寄存器, 编号即 x0-x31
+typedef enum : uint8_t {
+    REG_ZERO, REG_RA, REG_SP, REG_GP, REG_TP,
+    REG_T0, REG_T1, REG_T2,
+    REG_S0, REG_S1,
+    REG_A0, REG_A1, REG_A2, REG_A3, REG_A4, REG_A5, REG_A6, REG_A7,
+    REG_S2, REG_S3, REG_S4, REG_S5, REG_S6, REG_S7, REG_S8, REG_S9, REG_S10, REG_S11,
+    REG_T3, REG_T4, REG_T5, REG_T6,
+    REG_NONE = 0xff
+} reg_t;
+
+static const char *reg_names[] = {
+    "zero", "ra", "sp", "gp", "tp",
+    "t0", "t1", "t2",
+    "s0", "s1",
+    "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7",
+    "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11",
+    "t3", "t4", "t5", "t6"
+};
+
+static inline bool IsCalleeSaved(reg_t reg) {
+    return reg == REG_S0 || reg == REG_S1 || (reg >= REG_S2 && reg <= REG_S11);
+}
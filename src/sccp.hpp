@@ -0,0 +1,259 @@
+#pragma once
+#include<cstdint>
+#include<unordered_map>
+#include<utility>
+#include<vector>
+#include "cfg.hpp"
+#include "consteval.hpp"
+#include "ir.hpp"
+
+// 稀疏条件常量传播 (Wegman-Zadeck). 只沿可执行的边传播, 基本块参数取
+// 所有可执行入边上实参的交汇. 结束后把常量值替换进操作数, 删去已折叠的
+// binary 和常量参数, 条件为常量的 br 改写为 jump. 不可达的基本块留给 DCE.
+
+struct LatticeValue {
+    enum { TOP, CONSTANT, BOTTOM } state = TOP;
+    int32_t value = 0;
+};
+
+class SccpPass {
+    private:
+        IrFunction *fn = nullptr;
+        const ControlFlowGraph *graph = nullptr;
+        bool changed = false;
+        std::vector<LatticeValue> lattice;      // 按 ValueId 索引
+        std::vector<bool> executable;
+        std::vector<std::vector<bool>> edge_executable;     // 与 cfg.succs 对应
+        std::vector<std::pair<uint32_t, uint32_t>> flow_worklist;
+        std::vector<ValueId> ssa_worklist;
+
+        // undef 与后端一致按 0 处理; 传播过程中新建的常量不在 lattice 中
+        LatticeValue Get(ValueId value) const {
+            LatticeValue result;
+            const auto &v = (*fn)[value];
+            switch (v.op) {
+                case IR_INTEGER:
+                    result.state = LatticeValue::CONSTANT;
+                    result.value = v.imm;
+                    return result;
+                case IR_UNDEF:
+                    result.state = LatticeValue::CONSTANT;
+                    return result;
+                case IR_PARAM:
+                case IR_BINARY:
+                    return lattice[value];
+                default:
+                    result.state = LatticeValue::BOTTOM;
+                    return result;
+            }
+        }
+
+        // 格值只会下降, 变化时其使用者需要重新计算
+        void Lower(ValueId value, LatticeValue next) {
+            auto &current = lattice[value];
+            if (current.state == LatticeValue::BOTTOM) return;
+            if (current.state == LatticeValue::CONSTANT && next.state == LatticeValue::CONSTANT &&
+                current.value != next.value) {
+                next.state = LatticeValue::BOTTOM;
+            }
+            if (next.state == current.state && next.value == current.value) return;
+            if (next.state == LatticeValue::TOP) return;
+            current = next;
+            ssa_worklist.push_back(value);
+        }
+
+        static void Meet(LatticeValue &acc, const LatticeValue &other) {
+            if (other.state == LatticeValue::TOP || acc.state == LatticeValue::BOTTOM) return;
+            if (acc.state == LatticeValue::TOP) acc = other;
+            else if (other.state == LatticeValue::BOTTOM || other.value != acc.value) acc.state = LatticeValue::BOTTOM;
+        }
+
+        bool EdgeExecutable(uint32_t pred, uint32_t succ) const {
+            const auto &succs = graph->succs[pred];
+            for (size_t i = 0; i < succs.size(); ++i) {
+                if (succs[i] == succ) return edge_executable[pred][i];
+            }
+            return false;
+        }
+
+        void MarkEdge(uint32_t pred, uint32_t succ) {
+            const auto &succs = graph->succs[pred];
+            for (size_t i = 0; i < succs.size(); ++i) {
+                if (succs[i] != succ) continue;
+                if (!edge_executable[pred][i]) {
+                    edge_executable[pred][i] = true;
+                    flow_worklist.emplace_back(pred, succ);
+                } else {
+                    VisitParams(succ);      // 边已可执行, 但实参可能变了
+                }
+                return;
+            }
+        }
+
+        void VisitParams(uint32_t b) {
+            const auto &params = fn->blocks[b].params;
+            if (params.empty()) return;
+            std::vector<LatticeValue> values(params.size());
+            for (auto p : graph->preds[b]) {
+                if (!EdgeExecutable(p, b)) continue;
+                ForEachEdgeArgs(*fn, fn->Terminator(p), b, [&](std::vector<ValueId> &args) {
+                    for (size_t i = 0; i < args.size(); ++i) Meet(values[i], Get(args[i]));
+                });
+            }
+            for (size_t i = 0; i < params.size(); ++i) Lower(params[i], values[i]);
+        }
+
+        void VisitInst(ValueId inst) {
+            const auto &value = (*fn)[inst];
+            auto operands = fn->Operands(inst);
+            uint32_t b = value.block;
+            switch (value.op) {
+                case IR_BINARY: {
+                    auto lhs = Get(operands[0]), rhs = Get(operands[1]);
+                    LatticeValue result;
+                    if (lhs.state == LatticeValue::BOTTOM || rhs.state == LatticeValue::BOTTOM) {
+                        result.state = LatticeValue::BOTTOM;
+                    } else if (lhs.state == LatticeValue::CONSTANT && rhs.state == LatticeValue::CONSTANT) {
+                        result.state = EvalBinary(value.BinaryOp(), lhs.value, rhs.value, result.value)
+                                     ? LatticeValue::CONSTANT : LatticeValue::BOTTOM;
+                    }
+                    Lower(inst, result);
+                    break;
+                }
+                case IR_BRANCH: {
+                    auto cond = Get(operands[0]);
+                    if (cond.state == LatticeValue::TOP) break;
+                    auto true_bb = value.targets[0], false_bb = value.targets[1];
+                    if (cond.state == LatticeValue::BOTTOM || cond.value) MarkEdge(b, true_bb);
+                    if (cond.state == LatticeValue::BOTTOM || !cond.value) MarkEdge(b, false_bb);
+                    break;
+                }
+                case IR_JUMP:
+                    MarkEdge(b, value.targets[0]);
+                    break;
+                default:
+                    // load 等其余有值的指令一律为 BOTTOM
+                    if (value.HasResult()) {
+                        LatticeValue result;
+                        result.state = LatticeValue::BOTTOM;
+                        Lower(inst, result);
+                    }
+                    break;
+            }
+        }
+
+        void Propagate() {
+            size_t n = fn->blocks.size();
+            executable.assign(n, false);
+            edge_executable.assign(n, {});
+            for (auto b : graph->blocks) edge_executable[b].assign(graph->succs[b].size(), false);
+            flow_worklist.clear();
+            ssa_worklist.clear();
+            if (graph->blocks.empty()) return;
+
+            flow_worklist.emplace_back(ControlFlowGraph::kNone, fn->Entry());
+            while (!flow_worklist.empty() || !ssa_worklist.empty()) {
+                while (!flow_worklist.empty()) {
+                    auto b = flow_worklist.back().second;
+                    flow_worklist.pop_back();
+                    VisitParams(b);
+                    if (executable[b]) continue;
+                    executable[b] = true;
+                    for (auto inst : fn->blocks[b].insts) VisitInst(inst);
+                }
+                while (!ssa_worklist.empty()) {
+                    auto value = ssa_worklist.back();
+                    ssa_worklist.pop_back();
+                    for (auto user : fn->Users(value)) {
+                        if (executable[(*fn)[user].block]) VisitInst(user);
+                    }
+                }
+            }
+        }
+
+        bool IsConstant(ValueId value) const {
+            if (value >= lattice.size()) return false;
+            auto op = (*fn)[value].op;
+            return (op == IR_PARAM || op == IR_BINARY) && lattice[value].state == LatticeValue::CONSTANT;
+        }
+
+        // 条件为常量的 br 改为 jump, 保留被选中一边的实参
+        void FoldBranch(ValueId inst, bool taken) {
+            auto args = fn->EdgeArgs(inst, taken ? 0 : 1);
+            auto &value = (*fn)[inst];
+            value.op = IR_JUMP;
+            value.targets[0] = value.targets[taken ? 0 : 1];
+            value.targets[1] = kNoId;
+            value.true_arg_cnt = 0;
+            fn->SetOperands(inst, args);
+        }
+
+        void Rewrite() {
+            for (auto b : graph->blocks) {
+                auto &insts = fn->blocks[b].insts;
+                size_t len = 0;
+                for (size_t i = 0; i < insts.size(); ++i) {
+                    auto inst = insts[i];
+                    if (IsConstant(inst)) {
+                        changed = true;
+                        continue;
+                    }
+                    RewriteOperands(*fn, inst, [&](ValueId operand) {
+                        if (!IsConstant(operand)) return operand;
+                        changed = true;
+                        return fn->Integer(lattice[operand].value);
+                    });
+                    if ((*fn)[inst].op == IR_BRANCH) {
+                        const auto &cond = (*fn)[fn->Operands(inst)[0]];
+                        if (cond.op == IR_INTEGER) {
+                            FoldBranch(inst, cond.imm != 0);
+                            changed = true;
+                        }
+                    }
+                    insts[len++] = inst;
+                }
+                insts.resize(len);
+            }
+
+            // 删去常量参数及各条入边上对应的实参, 剩下的参数重新编号
+            for (auto b : graph->blocks) {
+                auto &params = fn->blocks[b].params;
+                if (params.empty()) continue;
+                std::vector<bool> keep(params.size());
+                bool dropped = false;
+                size_t len = 0;
+                for (size_t i = 0; i < params.size(); ++i) {
+                    auto param = params[i];
+                    keep[i] = !IsConstant(param);
+                    dropped |= !keep[i];
+                    if (!keep[i]) continue;
+                    (*fn)[param].imm = len;
+                    params[len++] = param;
+                }
+                params.resize(len);
+                if (!dropped) continue;
+                changed = true;
+                for (auto p : graph->preds[b]) {
+                    ForEachEdgeArgs(*fn, fn->Terminator(p), b, [&](std::vector<ValueId> &args) {
+                        size_t kept = 0;
+                        for (size_t i = 0; i < args.size(); ++i) {
+                            if (keep[i]) args[kept++] = args[i];
+                        }
+                        args.resize(kept);
+                    });
+                }
+            }
+        }
+
+    public:
+        // 需要有效的使用者列表; 返回是否修改了 IR, 修改后控制流图和使用者列表都失效
+        bool Run(IrFunction &func, const ControlFlowGraph &cfg) {
+            fn = &func;
+            graph = &cfg;
+            changed = false;
+            lattice.assign(func.values.size(), LatticeValue());
+            Propagate();
+            Rewrite();
+            return changed;
+        }
+};
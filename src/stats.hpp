@@ -0,0 +1,269 @@
+#pragma once
+#include<chrono>
+#include<cstdint>
+#include<cstdio>
+#include<cstring>
+#include<string>
+#include<ctime>
+#include<vector>
+#include<sys/resource.h>
+#include "emitter.hpp"
+
+// 编译各阶段的耗时和内存统计, 由 -time-report 打开
+
+typedef enum {
+    PHASE_PARSE,        // 词法和语法分析
+    PHASE_AST_SIMPLIFY, // 化简 AST
+    PHASE_AST_DUMP,     // 输出 AST
+    PHASE_IRGEN,        // 生成 Koopa IR
+    PHASE_OPT,          // IR 优化
+    PHASE_EMIT,         // 输出 Koopa 文本或生成汇编
+    PHASE_WRITE,        // 写出文件
+    PHASE_NUM
+} phase_t;
+
+static const char *phase_names[] = {"parse", "ast simplify", "ast dump", "ir generation", "optimization", "code emission", "output"};
+
+// 本线程通过 operator new 和 Arena 申请的字节数与次数, 也包括合并进来的线程池中工作的申请
+inline thread_local uint64_t allocated_bytes = 0;
+inline thread_local uint64_t allocation_cnt = 0;
+
+static inline void CountAllocation(size_t size) {
+    allocated_bytes += size;
+    ++allocation_cnt;
+}
+
+// 计数器, 每个文件开始编译时清零
+inline thread_local uint64_t token_cnt = 0;
+inline thread_local uint64_t ast_node_cnt = 0;
+
+struct PhaseStats {
+    double wall_ms = 0;
+    double cpu_ms = 0;          // 当前线程以及它交给线程池的工作的 CPU 时间
+    uint64_t alloc_bytes = 0;
+    uint64_t alloc_cnt = 0;
+    long peak_rss_kb = 0;       // 阶段结束时进程的最大常驻内存
+};
+
+// 一个 IR pass 或分析的统计, name 指向静态字符串, 合并时按名字对应
+struct PassStats {
+    const char *name;
+    bool analysis;              // 分析只统计计算次数和耗时
+    uint64_t runs = 0;
+    uint64_t changed = 0;       // 修改了 IR 的次数
+    double wall_ms = 0;
+
+    void Record(std::chrono::steady_clock::time_point start, bool modified) {
+        wall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ++runs;
+        changed += modified;
+    }
+};
+
+struct CompileStats {
+    PhaseStats phases[PHASE_NUM];
+    std::vector<PassStats> passes;      // 按第一次运行的顺序
+    uint64_t tokens = 0;
+    uint64_t ast_nodes = 0;
+    uint64_t ir_insts = 0;
+    uint64_t asm_insts = 0;
+    uint64_t files = 0;
+
+    void Add(const CompileStats &other) {
+        for (int i = 0; i < PHASE_NUM; ++i) {
+            phases[i].wall_ms += other.phases[i].wall_ms;
+            phases[i].cpu_ms += other.phases[i].cpu_ms;
+            phases[i].alloc_bytes += other.phases[i].alloc_bytes;
+            phases[i].alloc_cnt += other.phases[i].alloc_cnt;
+            if (other.phases[i].peak_rss_kb > phases[i].peak_rss_kb) phases[i].peak_rss_kb = other.phases[i].peak_rss_kb;
+        }
+        tokens += other.tokens;
+        ast_nodes += other.ast_nodes;
+        ir_insts += other.ir_insts;
+        asm_insts += other.asm_insts;
+        files += other.files;
+        for (const auto &pass : other.passes) {
+            auto &total = Pass(pass.name, pass.analysis);
+            total.runs += pass.runs;
+            total.changed += pass.changed;
+            total.wall_ms += pass.wall_ms;
+        }
+    }
+
+    PassStats &Pass(const char *name, bool analysis) {
+        for (auto &pass : passes) {
+            if (std::strcmp(pass.name, name) == 0) return pass;
+        }
+        passes.push_back(PassStats{name, analysis});
+        return passes.back();
+    }
+};
+
+static inline double ThreadCpuMillis() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// 本线程交给线程池的工作在工作线程上用掉的 CPU 时间, 由 WorkerStats::Merge 累加
+inline thread_local double worker_cpu_ms = 0;
+
+// 线程池中一项工作的 CPU 时间和内存申请. 工作线程用 Measure 统计, 提交工作的线程等它完成后
+// 调用 Merge 把结果加到自己的计数器上, 这样 PhaseTimer 统计的阶段包含了在线程池中完成的部分
+class WorkerStats {
+    private:
+        double cpu_ms = 0;
+        uint64_t alloc_bytes = 0;
+        uint64_t alloc_cnt = 0;
+
+    public:
+        template<typename F>
+        void Measure(F f) {
+            double cpu_start = ThreadCpuMillis();
+            uint64_t bytes_start = allocated_bytes, cnt_start = allocation_cnt;
+            f();
+            cpu_ms += ThreadCpuMillis() - cpu_start;
+            alloc_bytes += allocated_bytes - bytes_start;
+            alloc_cnt += allocation_cnt - cnt_start;
+        }
+
+        void Merge() const {
+            worker_cpu_ms += cpu_ms;
+            allocated_bytes += alloc_bytes;
+            allocation_cnt += alloc_cnt;
+        }
+};
+
+static inline long PeakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// 在作用域内统计一个阶段, 析构时累加到 stats. CPU 时间包括期间合并进来的工作线程的时间
+class PhaseTimer {
+    private:
+        PhaseStats &stats;
+        std::chrono::steady_clock::time_point wall_start;
+        double cpu_start;
+        uint64_t bytes_start;
+        uint64_t cnt_start;
+
+    public:
+        PhaseTimer(CompileStats &compile_stats, phase_t phase)
+            : stats(compile_stats.phases[phase]), wall_start(std::chrono::steady_clock::now()),
+              cpu_start(ThreadCpuMillis() + worker_cpu_ms), bytes_start(allocated_bytes), cnt_start(allocation_cnt) {}
+
+        ~PhaseTimer() {
+            stats.wall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+            stats.cpu_ms += ThreadCpuMillis() + worker_cpu_ms - cpu_start;
+            stats.alloc_bytes += allocated_bytes - bytes_start;
+            stats.alloc_cnt += allocation_cnt - cnt_start;
+            long rss = PeakRssKb();
+            if (rss > stats.peak_rss_kb) stats.peak_rss_kb = rss;
+        }
+};
+
+static inline void AppendFixed(Emitter &out, double value, int width = 0) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%*.3f", width, value);
+    out << buf;
+}
+
+static inline void AppendPadded(Emitter &out, uint64_t value, int width) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%*llu", width, static_cast<unsigned long long>(value));
+    out << buf;
+}
+
+static inline double PerSecond(uint64_t cnt, double millis) {
+    return millis > 0 ? cnt / (millis / 1e3) : 0;
+}
+
+static inline void PrintTimeReport(Emitter &out, const CompileStats &stats, bool json) {
+    double total_wall = 0, total_cpu = 0;
+    uint64_t total_bytes = 0;
+    for (const auto &phase : stats.phases) {
+        total_wall += phase.wall_ms;
+        total_cpu += phase.cpu_ms;
+        total_bytes += phase.alloc_bytes;
+    }
+    double parse_ms = stats.phases[PHASE_PARSE].wall_ms;
+
+    if (json) {
+        out << "{\"files\": " << stats.files << ", \"phases\": [";
+        for (int i = 0; i < PHASE_NUM; ++i) {
+            const auto &phase = stats.phases[i];
+            out << (i ? ", " : "") << "{\"name\": \"" << phase_names[i] << "\", \"wall_ms\": ";
+            AppendFixed(out, phase.wall_ms);
+            out << ", \"cpu_ms\": ";
+            AppendFixed(out, phase.cpu_ms);
+            out << ", \"alloc_bytes\": " << phase.alloc_bytes << ", \"allocs\": " << phase.alloc_cnt
+                << ", \"peak_rss_kb\": " << phase.peak_rss_kb << "}";
+        }
+        out << "], \"total\": {\"wall_ms\": ";
+        AppendFixed(out, total_wall);
+        out << ", \"cpu_ms\": ";
+        AppendFixed(out, total_cpu);
+        out << ", \"alloc_bytes\": " << total_bytes << ", \"peak_rss_kb\": " << PeakRssKb() << "}";
+        out << ", \"counters\": {\"tokens\": " << stats.tokens << ", \"ast_nodes\": " << stats.ast_nodes
+            << ", \"ir_insts\": " << stats.ir_insts << ", \"asm_insts\": " << stats.asm_insts << "}";
+        out << ", \"throughput\": {\"tokens_per_sec\": ";
+        AppendFixed(out, PerSecond(stats.tokens, parse_ms));
+        out << ", \"ir_insts_per_sec\": ";
+        AppendFixed(out, PerSecond(stats.ir_insts, stats.phases[PHASE_IRGEN].wall_ms));
+        out << ", \"asm_insts_per_sec\": ";
+        AppendFixed(out, PerSecond(stats.asm_insts, stats.phases[PHASE_EMIT].wall_ms));
+        out << "}, \"passes\": [";
+        for (size_t i = 0; i < stats.passes.size(); ++i) {
+            const auto &pass = stats.passes[i];
+            out << (i ? ", " : "") << "{\"name\": \"" << pass.name << "\", \"analysis\": "
+                << (pass.analysis ? "true" : "false") << ", \"runs\": " << pass.runs
+                << ", \"changed\": " << pass.changed << ", \"wall_ms\": ";
+            AppendFixed(out, pass.wall_ms);
+            out << "}";
+        }
+        out << "]}\n";
+        return;
+    }
+
+    out << "===-------------------------------------------------------===\n";
+    out << "  Time report (" << stats.files << (stats.files == 1 ? " file" : " files") << ")\n";
+    out << "===-------------------------------------------------------===\n";
+    out << "  phase           wall(ms)     cpu(ms)   alloc(bytes)   peak rss(KB)\n";
+    for (int i = 0; i < PHASE_NUM; ++i) {
+        const auto &phase = stats.phases[i];
+        char name[32];
+        std::snprintf(name, sizeof(name), "  %-14s", phase_names[i]);
+        out << name;
+        AppendFixed(out, phase.wall_ms, 10);
+        AppendFixed(out, phase.cpu_ms, 12);
+        AppendPadded(out, phase.alloc_bytes, 15);
+        AppendPadded(out, phase.peak_rss_kb, 15);
+        out << '\n';
+    }
+    out << "  total         ";
+    AppendFixed(out, total_wall, 10);
+    AppendFixed(out, total_cpu, 12);
+    AppendPadded(out, total_bytes, 15);
+    AppendPadded(out, PeakRssKb(), 15);
+    out << '\n';
+    out << "  tokens: " << stats.tokens << " (";
+    AppendFixed(out, PerSecond(stats.tokens, parse_ms));
+    out << "/s), AST nodes: " << stats.ast_nodes << ", IR instructions: " << stats.ir_insts
+        << ", asm instructions: " << stats.asm_insts << '\n';
+    if (stats.passes.empty()) return;
+    char line[64];
+    std::snprintf(line, sizeof(line), "  %-30s%10s%10s%10s\n", "pass", "wall(ms)", "runs", "changed");
+    out << line;
+    for (const auto &pass : stats.passes) {
+        std::string name = pass.analysis ? std::string(pass.name) + " (analysis)" : pass.name;
+        std::snprintf(line, sizeof(line), "  %-30s", name.c_str());
+        out << line;
+        AppendFixed(out, pass.wall_ms, 10);
+        AppendPadded(out, pass.runs, 10);
+        if (pass.analysis) out << "         -";
+        else AppendPadded(out, pass.changed, 10);
+        out << '\n';
+    }
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include<cstdint>
+#include<vector>
+#include "koopa.h"
+#include "machine.hpp"
+#include "riscv.hpp"
+
+// 乘除模常量的强度削弱. 乘 2^k 及 2^k±1 用移位和加减, 除以 2^k 先按符号加偏置
+// 再算术右移, 其余除数用 Hacker's Delight 10-4 节的魔数乘高位.
+// 语义与 div/rem 一致: 向零取整, INT_MIN / -1 = INT_MIN. 除数为 0 和 INT_MIN 时不处理.
+
+struct DivMagic {
+    int32_t multiplier;
+    int shift;
+};
+
+// 有符号除以 d 的魔数, 要求 |d| >= 2 且 d 不是 2 的幂
+static inline DivMagic ComputeDivMagic(int32_t d) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = d < 0 ? 0u - static_cast<uint32_t>(d) : static_cast<uint32_t>(d);
+    uint32_t t = two31 + (static_cast<uint32_t>(d) >> 31);
+    uint32_t anc = t - 1 - t % ad;
+    int p = 31;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta;
+    do {
+        ++p;
+        q1 <<= 1, r1 <<= 1;
+        if (r1 >= anc) ++q1, r1 -= anc;
+        q2 <<= 1, r2 <<= 1;
+        if (r2 >= ad) ++q2, r2 -= ad;
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    DivMagic magic;
+    magic.multiplier = static_cast<int32_t>(q2 + 1);
+    if (d < 0) magic.multiplier = static_cast<int32_t>(0u - static_cast<uint32_t>(magic.multiplier));
+    magic.shift = p - 32;
+    return magic;
+}
+
+// |c| 为 2 的幂时返回指数, 否则返回 -1
+static inline int Log2Abs(int32_t c) {
+    uint32_t a = c < 0 ? 0u - static_cast<uint32_t>(c) : static_cast<uint32_t>(c);
+    if (a == 0 || (a & (a - 1)) != 0) return -1;
+    int k = 0;
+    while (a >>= 1) ++k;
+    return k;
+}
+
+// 以下函数把 src op c 的结果写入 dst. t1 始终可作临时寄存器 (常量没有装入它);
+// src 以外的 t0 和 dst 也可以在读完 src 之后使用. 返回 false 时调用者照常生成指令.
+static bool ReduceMul(std::vector<MachineInst> &out, reg_t dst, reg_t src, int32_t c) {
+    if (c == 0) {
+        out.push_back(MachineInst::Li(dst, 0));
+        return true;
+    }
+    if (c == 1) {
+        out.push_back(MachineInst::Unary(RV_MV, dst, src));
+        return true;
+    }
+    if (c == -1) {
+        out.push_back(MachineInst::R(RV_SUB, dst, REG_ZERO, src));
+        return true;
+    }
+    int k = Log2Abs(c);
+    if (k > 0) {
+        out.push_back(MachineInst::I(RV_SLLI, dst, src, k));
+        if (c < 0) out.push_back(MachineInst::R(RV_SUB, dst, REG_ZERO, dst));
+        return true;
+    }
+    // c = 2^k + 1 或 2^k - 1
+    uint32_t uc = static_cast<uint32_t>(c);
+    int k_add = c > 0 ? Log2Abs(static_cast<int32_t>(uc - 1)) : -1;
+    int k_sub = c > 0 ? Log2Abs(static_cast<int32_t>(uc + 1)) : -1;
+    if (k_add > 0) {
+        out.push_back(MachineInst::I(RV_SLLI, REG_T1, src, k_add));
+        out.push_back(MachineInst::R(RV_ADD, dst, REG_T1, src));
+        return true;
+    }
+    if (k_sub > 0) {
+        out.push_back(MachineInst::I(RV_SLLI, REG_T1, src, k_sub));
+        out.push_back(MachineInst::R(RV_SUB, dst, REG_T1, src));
+        return true;
+    }
+    return false;
+}
+
+// 负数被除数需要加上 2^k - 1 才能向零取整, 偏置写入 tmp, 返回 src + 偏置所在的寄存器
+static reg_t EmitDivBias(std::vector<MachineInst> &out, reg_t tmp, reg_t src, int k) {
+    if (k == 1) {
+        out.push_back(MachineInst::I(RV_SRLI, tmp, src, 31));
+    } else {
+        out.push_back(MachineInst::I(RV_SRAI, tmp, src, 31));
+        out.push_back(MachineInst::I(RV_SRLI, tmp, tmp, 32 - k));
+    }
+    out.push_back(MachineInst::R(RV_ADD, tmp, src, tmp));
+    return tmp;
+}
+
+// 商最终写入 tmp, q 存放中间结果; tmp 在读完 src 之后才被写入, 可以与 src 相同
+static void EmitMagicDiv(std::vector<MachineInst> &out, reg_t q, reg_t tmp, reg_t src, int32_t d) {
+    auto magic = ComputeDivMagic(d);
+    out.push_back(MachineInst::Li(q, magic.multiplier));
+    out.push_back(MachineInst::R(RV_MULH, q, src, q));
+    if (d > 0 && magic.multiplier < 0) out.push_back(MachineInst::R(RV_ADD, q, q, src));
+    if (d < 0 && magic.multiplier > 0) out.push_back(MachineInst::R(RV_SUB, q, q, src));
+    if (magic.shift > 0) out.push_back(MachineInst::I(RV_SRAI, q, q, magic.shift));
+    // 商为负时加 1, 从向下取整变为向零取整
+    out.push_back(MachineInst::I(RV_SRLI, tmp, q, 31));
+    out.push_back(MachineInst::R(RV_ADD, tmp, q, tmp));
+}
+
+static bool ReduceDiv(std::vector<MachineInst> &out, reg_t dst, reg_t src, int32_t d) {
+    if (d == 0 || d == INT32_MIN) return false;
+    if (d == 1) {
+        out.push_back(MachineInst::Unary(RV_MV, dst, src));
+        return true;
+    }
+    if (d == -1) {
+        out.push_back(MachineInst::R(RV_SUB, dst, REG_ZERO, src));
+        return true;
+    }
+    int k = Log2Abs(d);
+    if (k > 0) {
+        auto biased = EmitDivBias(out, REG_T1, src, k);
+        out.push_back(MachineInst::I(RV_SRAI, dst, biased, k));
+        if (d < 0) out.push_back(MachineInst::R(RV_SUB, dst, REG_ZERO, dst));
+        return true;
+    }
+    EmitMagicDiv(out, REG_T1, dst, src, d);
+    return true;
+}
+
+static bool ReduceRem(std::vector<MachineInst> &out, reg_t dst, reg_t src, int32_t d) {
+    if (d == 0 || d == INT32_MIN) return false;
+    if (d == 1 || d == -1) {
+        out.push_back(MachineInst::Li(dst, 0));
+        return true;
+    }
+    // x % d 的符号与 x 相同, 与 d 的符号无关
+    int k = Log2Abs(d);
+    if (k > 0) {
+        auto biased = EmitDivBias(out, REG_T1, src, k);
+        out.push_back(MachineInst::I(RV_SRAI, REG_T1, biased, k));
+        out.push_back(MachineInst::I(RV_SLLI, REG_T1, REG_T1, k));
+        out.push_back(MachineInst::R(RV_SUB, dst, src, REG_T1));
+        return true;
+    }
+    // x - x / d * d 需要在算出商之后还保留 src, 再要一个不同于 src 的临时寄存器
+    reg_t tmp = dst != src ? dst : src != REG_T0 ? REG_T0 : REG_NONE;
+    if (tmp == REG_NONE) return false;
+    EmitMagicDiv(out, REG_T1, tmp, src, d);
+    out.push_back(MachineInst::Li(REG_T1, d));
+    out.push_back(MachineInst::R(RV_MUL, REG_T1, tmp, REG_T1));
+    out.push_back(MachineInst::R(RV_SUB, dst, src, REG_T1));
+    return true;
+}
+
+static bool ReduceByConstant(std::vector<MachineInst> &out, koopa_raw_binary_op_t op, reg_t dst, reg_t src, int32_t c) {
+    switch (op) {
+        case KOOPA_RBO_MUL: return ReduceMul(out, dst, src, c);
+        case KOOPA_RBO_DIV: return ReduceDiv(out, dst, src, c);
+        case KOOPA_RBO_MOD: return ReduceRem(out, dst, src, c);
+        default: return false;
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include<cassert>
+#include<cstdint>
+#include<vector>
+#include "interner.hpp"
+#include "koopa.h"
+
+struct SymbolInfo {
+    enum SymbolType {CONSTANT, VARIABLE};
+    SymbolType type;
+    union {
+        int const_value;
+        koopa_raw_value_t alloc;    // 变量对应的 alloc 指令
+    };
+    SymbolInfo(int value) : type(CONSTANT), const_value(value) {}
+    SymbolInfo(SymbolType t, koopa_raw_value_t a) : type(t), alloc(a) {}
+};
+
+// 带作用域的符号表.
+// 以驻留后的名字为键做开放寻址, 槽中记录该名字当前可见的绑定;
+// 绑定按声明顺序压入 bindings, 每个绑定记住被它遮蔽的旧绑定,
+// 退出作用域时倒序弹出并恢复, 代价只与该作用域内的声明个数有关.
+class SymbolTable {
+    private:
+        static constexpr uint32_t kNone = 0xffffffffu;
+
+        struct Slot {
+            SymbolId name;
+            uint32_t binding;           // 当前可见的绑定, 名字不可见时为 kNone
+        };
+
+        struct Binding {
+            SymbolId name;
+            uint32_t shadowed;          // 被遮蔽的外层绑定
+            SymbolInfo info;
+        };
+
+        std::vector<Slot> slots;        // 名字一旦插入就不再删除, 因此不需要墓碑
+        uint32_t slot_cnt = 0;
+        std::vector<Binding> bindings;
+        std::vector<uint32_t> scopes;   // 每个作用域开始时 bindings 的长度
+
+        static uint32_t Hash(SymbolId name) {
+            return name * 2654435769u;
+        }
+
+        Slot *Find(SymbolId name) {
+            if (slots.empty()) return nullptr;
+            uint32_t mask = slots.size() - 1;
+            for (uint32_t i = Hash(name) & mask; slots[i].name != kNone; i = (i + 1) & mask) {
+                if (slots[i].name == name) return &slots[i];
+            }
+            return nullptr;
+        }
+
+        void Grow() {
+            std::vector<Slot> old(slots.empty() ? 64 : slots.size() * 2, Slot{kNone, kNone});
+            old.swap(slots);
+            uint32_t mask = slots.size() - 1;
+            for (const auto &slot : old) {
+                if (slot.name == kNone) continue;
+                uint32_t i = Hash(slot.name) & mask;
+                while (slots[i].name != kNone) i = (i + 1) & mask;
+                slots[i] = slot;
+            }
+        }
+
+        Slot &FindOrInsert(SymbolId name) {
+            if ((slot_cnt + 1) * 2 > slots.size()) Grow();
+            uint32_t mask = slots.size() - 1;
+            uint32_t i = Hash(name) & mask;
+            for (; slots[i].name != kNone; i = (i + 1) & mask) {
+                if (slots[i].name == name) return slots[i];
+            }
+            ++slot_cnt;
+            slots[i] = Slot{name, kNone};
+            return slots[i];
+        }
+
+    public:
+        void PushScope() {
+            scopes.push_back(bindings.size());
+        }
+
+        void PopScope() {
+            assert(!scopes.empty());
+            uint32_t mark = scopes.back();
+            scopes.pop_back();
+            while (bindings.size() > mark) {
+                const auto &binding = bindings.back();
+                Find(binding.name)->binding = binding.shadowed;
+                bindings.pop_back();
+            }
+        }
+
+        // 在当前作用域声明 name, 同一作用域内重复声明时返回 false
+        bool Declare(SymbolId name, const SymbolInfo &info) {
+            auto &slot = FindOrInsert(name);
+            uint32_t mark = scopes.empty() ? 0 : scopes.back();
+            if (slot.binding != kNone && slot.binding >= mark) return false;
+            bindings.push_back(Binding{name, slot.binding, info});
+            slot.binding = bindings.size() - 1;
+            return true;
+        }
+
+        // 查找当前可见的绑定, 未声明时返回 nullptr
+        const SymbolInfo *Lookup(SymbolId name) {
+            auto slot = Find(name);
+            if (!slot || slot->binding == kNone) return nullptr;
+            return &bindings[slot->binding].info;
+        }
+
+        void Clear() {
+            slots.clear();
+            slot_cnt = 0;
+            bindings.clear();
+            scopes.clear();
+        }
+};
@@ -1,36 +1,49 @@
 // 插入代码
 %code requires{
-    #include <memory>
     #include <string>
     #include <cstdio>
     #include "ast.hpp"
+
+    // 可重入的 flex 扫描器句柄, 与 flex 生成的定义一致
+    #ifndef YY_TYPEDEF_YY_SCANNER_T
+    #define YY_TYPEDEF_YY_SCANNER_T
+    typedef void *yyscan_t;
+    #endif
+
+    // 词法来源, 定义在 lexer.hpp 中
+    struct Scanner;
 }
 
 %{
 #include <iostream>
-#include <memory>
 #include <string>
 #include "ast.hpp"
-
-int yylex();
-void yyerror(std::unique_ptr<BaseAST> &ast, const char* s);
 using namespace std;
 %}
 
+%code {
+int yylex(YYSTYPE *yylval, Scanner *scanner);
+void yyerror(Scanner *scanner, BaseAST *&ast, Arena &arena, const char* s);
+}
+
 // Bison指令：定义语法分析器的配置和行为
-%parse-param {std::unique_ptr<BaseAST> &ast}
+// 语法分析器和扫描器都是可重入的, 不同线程可以同时分析不同的文件
+// AST 节点都分配在 arena 中
+%define api.pure full
+%lex-param {Scanner *scanner}
+%parse-param {Scanner *scanner} {BaseAST *&ast} {Arena &arena}
 
 %union {
-    std::string *str_val;
+    SymbolId sym_val;
     int int_val;
     char char_val;
     BaseAST *ast_val;
-    std::vector<std::unique_ptr<BaseAST>>* ast_list_ptr;
+    AstList *ast_list_ptr;
 }
 
 // Token和类型声明：定义词法语法分析器的通信协议
 %token INT RETURN
-%token <str_val> IDENT
+%token <sym_val> IDENT
 %token <int_val> INT_CONST
 %token LE GE EQ NE LAND LOR
 %token CONST
@@ -45,53 +58,50 @@ using namespace std;
 // CompUnit ::= FuncDef;
 CompUnit
     :FuncDef{
-        auto comp_unit = make_unique<CompUnitAST>();
-        comp_unit->func_def = unique_ptr<BaseAST>($1);
-        ast = std::move(comp_unit);
+        auto comp_unit = arena.New<CompUnitAST>();
+        comp_unit->func_def = $1;
+        ast = comp_unit;
     }
     ;
 
 // FuncDef ::= FuncType IDENT "(" ")" Block;
 FuncDef
     :FuncType IDENT '(' ')' Block {
-        auto func_def = make_unique<FuncDefAST>();
-        func_def->func_type = unique_ptr<BaseAST>($1);
-        func_def->ident = *unique_ptr<string>($2);
-        func_def->block = unique_ptr<BaseAST>($5);
-        $$ = func_def.release();
+        auto func_def = arena.New<FuncDefAST>();
+        func_def->func_type = $1;
+        func_def->ident = $2;
+        func_def->block = $5;
+        $$ = func_def;
     }
     ;
 
 // FuncType ::= "int";
 FuncType
     :INT {
-        auto func_type = make_unique<FuncTypeAST>();
-        $$ = func_type.release();
+        auto func_type = arena.New<FuncTypeAST>();
+        $$ = func_type;
     }
     ;
 
 // Block ::= "{" {BlockItem} "}";
 Block
     : '{' '}' {
-        auto block = make_unique<BlockAST>();
-        $$ = block.release();
+        auto block = arena.New<BlockAST>();
+        $$ = block;
     }
     |'{' BlockItemList '}'{
-        auto block = make_unique<BlockAST>();
-        block->blockitem_list = move(*($2));
-        delete $2;
-        $$ = block.release();
+        auto block = arena.New<BlockAST>();
+        block->blockitem_list = AstListToSpan(arena, $2);
+        $$ = block;
     }
     ;
 
 BlockItemList
     : BlockItem {
-        auto list = new vector<unique_ptr<BaseAST>>();
-        list->push_back(unique_ptr<BaseAST>($1));
-        $$ = list;
+        $$ = NewAstList(arena, $1);
     }
     | BlockItemList BlockItem {
-        $1->push_back(unique_ptr<BaseAST>($2));
+        AstListAppend(arena, $1, $2);
         $$ = $1;
     }
     ;
@@ -99,49 +109,46 @@ BlockItemList
 // BlockItem ::= Decl | Stmt;
 BlockItem
     :Decl {
-        auto blockitem = make_unique<BlockItemAST>();
-        blockitem->decl_stmt = unique_ptr<BaseAST>($1);
-        $$ = blockitem.release();
+        auto blockitem = arena.New<BlockItemAST>();
+        blockitem->decl_stmt = $1;
+        $$ = blockitem;
     }
     |Stmt {
-        auto blockitem = make_unique<BlockItemAST>();
-        blockitem->decl_stmt = unique_ptr<BaseAST>($1);
-        $$ = blockitem.release();
+        auto blockitem = arena.New<BlockItemAST>();
+        blockitem->decl_stmt = $1;
+        $$ = blockitem;
     }
     ;
 
 // Decl ::= ConstDecl | VarDecl;
 Decl
     : ConstDecl {
-        auto decl = make_unique<DeclAST>();
-        decl->const_vardecl = std::unique_ptr<BaseAST>($1);
-        $$ = decl.release();
+        auto decl = arena.New<DeclAST>();
+        decl->const_vardecl = $1;
+        $$ = decl;
     }
     | VarDecl {
-        auto decl = make_unique<DeclAST>();
-        decl->const_vardecl = std::unique_ptr<BaseAST>($1);
-        $$ = decl.release();
+        auto decl = arena.New<DeclAST>();
+        decl->const_vardecl = $1;
+        $$ = decl;
     }
 
 // ConstDecl ::= "const" BType ConstDef {"," ConstDef} ";";
 ConstDecl
     : CONST BType ConstDefList ';' {
-        auto constdecl = make_unique<ConstDeclAST>();
-        constdecl->btype = unique_ptr<BaseAST>($2);
-        constdecl->constdef_list = move(*($3));
-        delete $3;
-        $$ = constdecl.release();
+        auto constdecl = arena.New<ConstDeclAST>();
+        constdecl->btype = $2;
+        constdecl->constdef_list = AstListToSpan(arena, $3);
+        $$ = constdecl;
     }
     ;
 
 ConstDefList
     : ConstDef {
-        auto list = new vector<unique_ptr<BaseAST>>();
-        list->push_back(unique_ptr<BaseAST>($1));
-        $$ = list;
+        $$ = NewAstList(arena, $1);
     }
     | ConstDefList ',' ConstDef {
-        $1->push_back(unique_ptr<BaseAST>($3));
+        AstListAppend(arena, $1, $3);
         $$ = $1;
     }
     ;
@@ -149,50 +156,47 @@ ConstDefList
 // ConstDef ::= IDENT "=" ConstInitVal;
 ConstDef 
     : IDENT '=' ConstInitVal{
-        auto constdef = make_unique<ConstDefAST>();
-        constdef->ident = *unique_ptr<string>($1);
-        constdef->constintval = unique_ptr<BaseAST>($3);
-        $$ = constdef.release();
+        auto constdef = arena.New<ConstDefAST>();
+        constdef->ident = $1;
+        constdef->constintval = $3;
+        $$ = constdef;
     }
     ;
 
 // ConstInitVal ::= ConstExp;
 ConstInitVal
     : ConstExp{
-        auto constinitval = make_unique<ConstInitValAST>();
-        constinitval->constexp = unique_ptr<BaseAST>($1);
-        $$ = constinitval.release();
+        auto constinitval = arena.New<ConstInitValAST>();
+        constinitval->constexp = $1;
+        $$ = constinitval;
     }
     ;
 
 // ConstExp ::= Exp
 ConstExp
     : Exp{
-        auto constexp = make_unique<ConstExpAST>();
-        constexp->exp = unique_ptr<BaseAST>($1);
-        $$ = constexp.release();
+        auto constexp = arena.New<ConstExpAST>();
+        constexp->exp = $1;
+        $$ = constexp;
     }
     ;
 
 // VarDecl ::= BType VarDef {"," VarDef} ";";
 VarDecl
     : BType VarDefList ';'{
-        auto vardecl = make_unique<VarDeclAST>();
-        vardecl->btype = unique_ptr<BaseAST>($1);
-        vardecl->vardef_list = move(*($2));
-        delete($2);
-        $$ = vardecl.release();
+        auto vardecl = arena.New<VarDeclAST>();
+        vardecl->btype = $1;
+        vardecl->vardef_list = AstListToSpan(arena, $2);
+        $$ = vardecl;
     }
     ;
 
 VarDefList
     : VarDef {
-        auto list = new vector<unique_ptr<BaseAST>>();
-        list->push_back(unique_ptr<BaseAST>($1));
-        $$ = list;
+        $$ = NewAstList(arena, $1);
     }
     | VarDefList ',' VarDef {
-        $1->push_back(unique_ptr<BaseAST>($3));
+        AstListAppend(arena, $1, $3);
         $$ = $1;
     }
     ;
@@ -200,70 +204,86 @@ VarDefList
 // VarDef ::= IDENT | IDENT "=" InitVal;
 VarDef
     : IDENT {
-        auto vardef = make_unique<VarDefAST>();
+        auto vardef = arena.New<VarDefAST>();
         vardef->type = 1;
-        vardef->ident = *unique_ptr<string>($1);
-        vardef.release();
-        $$ = vardef.release();
+        vardef->ident = $1;
+        $$ = vardef;
     }
     | IDENT '=' InitVal {
-        auto vardef = make_unique<VarDefAST>();
+        auto vardef = arena.New<VarDefAST>();
         vardef->type = 2;
-        vardef->ident = *unique_ptr<string>($1);
-        vardef->initval = unique_ptr<BaseAST>($3);
-        $$ = vardef.release();
+        vardef->ident = $1;
+        vardef->initval = $3;
+        $$ = vardef;
     }
     ;
 
 // InitVal ::= Exp;
 InitVal
     : Exp {
-        auto initval = make_unique<InitValAST>();
-        initval->exp = unique_ptr<BaseAST>($1);
-        $$ = initval.release();
+        auto initval = arena.New<InitValAST>();
+        initval->exp = $1;
+        $$ = initval;
     }
     ;
 
 // BType ::= "int";
 BType
     : INT {
-        auto btype = make_unique<BTypeAST>();
-        $$ = btype.release();
+        auto btype = arena.New<BTypeAST>();
+        $$ = btype;
     }
     ;
 
 // LVal ::= IDEDNT;
 LVal
     : IDENT{
-        auto lval = make_unique<LValAST>();
-        lval->ident = *unique_ptr<string>($1);
-        $$ = lval.release();
+        auto lval = arena.New<LValAST>();
+        lval->ident = $1;
+        $$ = lval;
     }
     ;
 
-// Stmt ::= LVal "=" Exp ";" | "return" Exp ";";
+// Stmt ::= LVal "=" Exp ";" | "return" Exp ";" | Block | [Exp] ";";
 Stmt
     :LVal '=' Exp ';'{
-        auto stmt = make_unique<StmtAST>();
+        auto stmt = arena.New<StmtAST>();
         stmt->type = 1;
-        stmt->lval = unique_ptr<BaseAST>($1);
-        stmt->exp = unique_ptr<BaseAST>($3);
-        $$ = stmt.release();
+        stmt->lval = $1;
+        stmt->exp = $3;
+        $$ = stmt;
     }
     |RETURN Exp ';'{
-        auto stmt = make_unique<StmtAST>();
+        auto stmt = arena.New<StmtAST>();
         stmt->type = 2;
-        stmt->exp = unique_ptr<BaseAST>($2);
-        $$ = stmt.release();
+        stmt->exp = $2;
+        $$ = stmt;
+    }
+    |Block {
+        auto stmt = arena.New<StmtAST>();
+        stmt->type = 3;
+        stmt->block = $1;
+        $$ = stmt;
+    }
+    |Exp ';' {
+        auto stmt = arena.New<StmtAST>();
+        stmt->type = 4;
+        stmt->exp = $1;
+        $$ = stmt;
+    }
+    |';' {
+        auto stmt = arena.New<StmtAST>();
+        stmt->type = 4;
+        $$ = stmt;
     }
     ;
 
 // Exp:: = LOrExp;
 Exp
     : LOrExp {
-        auto exp = make_unique<ExpAST>();
-        exp->lorexp = unique_ptr<BaseAST>($1);
-        $$ = exp.release();
+        auto exp = arena.New<ExpAST>();
+        exp->lorexp = $1;
+        $$ = exp;
     }
     ;
 
@@ -271,104 +291,104 @@ Exp
 // LOrExp ::= LAndExp | LOrExp LOR LAndExp;
 LOrExp
     : LAndExp {
-        auto lorexp = make_unique<LOrExpAST>();
+        auto lorexp = arena.New<LOrExpAST>();
         lorexp->type = 1;
-        lorexp->landexp = unique_ptr<BaseAST>($1);
-        $$ = lorexp.release();
+        lorexp->landexp = $1;
+        $$ = lorexp;
     }
     | LOrExp LOR LAndExp {
-        auto lorexp = make_unique<LOrExpAST>();
+        auto lorexp = arena.New<LOrExpAST>();
         lorexp->type = 2;
-        lorexp->lorexp = unique_ptr<BaseAST>($1);
+        lorexp->lorexp = $1;
         lorexp->logicop = LOR_OP;
-        lorexp->landexp = unique_ptr<BaseAST>($3);
-        $$ = lorexp.release();
+        lorexp->landexp = $3;
+        $$ = lorexp;
     }
     ;
 
 // LAndExp ::= EqExp | LAndExp LAND EqExp;
 LAndExp
     : EqExp {
-        auto landexp = make_unique<LAndExpAST>();
+        auto landexp = arena.New<LAndExpAST>();
         landexp->type = 1;
-        landexp->eqexp = unique_ptr<BaseAST>($1);
-        $$ = landexp.release();
+        landexp->eqexp = $1;
+        $$ = landexp;
     }
     | LAndExp LAND EqExp {
-        auto landexp = make_unique<LAndExpAST>();
+        auto landexp = arena.New<LAndExpAST>();
         landexp->type = 2;
-        landexp->landexp = unique_ptr<BaseAST>($1);
+        landexp->landexp = $1;
         landexp->logicop = LAND_OP;
-        landexp->eqexp = unique_ptr<BaseAST>($3);
-        $$ = landexp.release();
+        landexp->eqexp = $3;
+        $$ = landexp;
     }
     ;
 
 // EqExp ::= RelExp | EqExp (EQ | NE) RelExp;
 EqExp
     : RelExp {
-        auto eqexp = make_unique<EqExpAST>();
+        auto eqexp = arena.New<EqExpAST>();
         eqexp->type = 1;
-        eqexp->relexp = unique_ptr<BaseAST>($1);
-        $$ = eqexp.release();
+        eqexp->relexp = $1;
+        $$ = eqexp;
     }
     | EqExp EQ RelExp {
-        auto eqexp = make_unique<EqExpAST>();
+        auto eqexp = arena.New<EqExpAST>();
         eqexp->type = 2;
-        eqexp->eqexp = unique_ptr<BaseAST>($1);
+        eqexp->eqexp = $1;
         eqexp->eqop = REL_EQ;
-        eqexp->relexp = unique_ptr<BaseAST>($3);
-        $$ = eqexp.release();
+        eqexp->relexp = $3;
+        $$ = eqexp;
     }
     | EqExp NE RelExp {
-        auto eqexp = make_unique<EqExpAST>();
+        auto eqexp = arena.New<EqExpAST>();
         eqexp->type = 2;
-        eqexp->eqexp = unique_ptr<BaseAST>($1);
+        eqexp->eqexp = $1;
         eqexp->eqop = REL_NE;
-        eqexp->relexp = unique_ptr<BaseAST>($3);
-        $$ = eqexp.release();
+        eqexp->relexp = $3;
+        $$ = eqexp;
     }
     ;
 
 // RelExp ::= AddExp | RelExp ("<" | ">" | LE | GE) AddExp;
 RelExp
     : AddExp {
-        auto relexp = make_unique<RelExpAST>();
+        auto relexp = arena.New<RelExpAST>();
         relexp->type = 1;
-        relexp->addexp = unique_ptr<BaseAST>($1);
-        $$ = relexp.release();
+        relexp->addexp = $1;
+        $$ = relexp;
     }
     | RelExp '<' AddExp {
-        auto relexp = make_unique<RelExpAST>();
+        auto relexp = arena.New<RelExpAST>();
         relexp->type = 2;
-        relexp->relexp = unique_ptr<BaseAST>($1);
+        relexp->relexp = $1;
         relexp->relop = REL_LT;
-        relexp->addexp = unique_ptr<BaseAST>($3);
-        $$ = relexp.release();
+        relexp->addexp = $3;
+        $$ = relexp;
     }
     | RelExp '>' AddExp {
-        auto relexp = make_unique<RelExpAST>();
+        auto relexp = arena.New<RelExpAST>();
         relexp->type = 2;
-        relexp->relexp = unique_ptr<BaseAST>($1);
+        relexp->relexp = $1;
         relexp->relop = REL_GT;
-        relexp->addexp = unique_ptr<BaseAST>($3);
-        $$ = relexp.release();
+        relexp->addexp = $3;
+        $$ = relexp;
     }
     | RelExp LE AddExp {
-        auto relexp = make_unique<RelExpAST>();
+        auto relexp = arena.New<RelExpAST>();
         relexp->type = 2;
-        relexp->relexp = unique_ptr<BaseAST>($1);
+        relexp->relexp = $1;
         relexp->relop = REL_LE;
-        relexp->addexp = unique_ptr<BaseAST>($3);
-        $$ = relexp.release();
+        relexp->addexp = $3;
+        $$ = relexp;
     }
     | RelExp GE AddExp {
-        auto relexp = make_unique<RelExpAST>();
+        auto relexp = arena.New<RelExpAST>();
         relexp->type = 2;
-        relexp->relexp = unique_ptr<BaseAST>($1);
+        relexp->relexp = $1;
         relexp->relop = REL_GE;
-        relexp->addexp = unique_ptr<BaseAST>($3);
-        $$ = relexp.release();
+        relexp->addexp = $3;
+        $$ = relexp;
     }
     ;
 
@@ -376,121 +396,121 @@ RelExp
 // AddExp ::= MulExp | AddExp ("+" | "-") MulExp;
 AddExp
     : MulExp {
-        auto addexp = make_unique<AddExpAST>();
+        auto addexp = arena.New<AddExpAST>();
         addexp->type = 1;
-        addexp->mulexp = unique_ptr<BaseAST>($1);
-        $$ = addexp.release();
+        addexp->mulexp = $1;
+        $$ = addexp;
     }
      | AddExp '+' MulExp {
-        auto addexp = make_unique<AddExpAST>();
+        auto addexp = arena.New<AddExpAST>();
         addexp->type = 2;
-        addexp->addexp = unique_ptr<BaseAST>($1);
+        addexp->addexp = $1;
         addexp->addop = ADD_OP; 
-        addexp->mulexp = unique_ptr<BaseAST>($3);
-        $$ = addexp.release();
+        addexp->mulexp = $3;
+        $$ = addexp;
     }
     | AddExp '-' MulExp {
-        auto addexp = make_unique<AddExpAST>();
+        auto addexp = arena.New<AddExpAST>();
         addexp->type = 2;
-        addexp->addexp = unique_ptr<BaseAST>($1);
+        addexp->addexp = $1;
         addexp->addop = SUB_OP;
-        addexp->mulexp = unique_ptr<BaseAST>($3);
-        $$ = addexp.release();
+        addexp->mulexp = $3;
+        $$ = addexp;
     }
     ;
 
 // MulExp ::= UnaryExp | MulExp ("*" | "/" | "%") UnaryExp;
 MulExp
     : UnaryExp{
-        auto mulexp = make_unique<MulExpAST>();
+        auto mulexp = arena.New<MulExpAST>();
         mulexp->type = 1;
-        mulexp->unaryexp = unique_ptr<BaseAST>($1);
-        $$ = mulexp.release();
+        mulexp->unaryexp = $1;
+        $$ = mulexp;
     }
     | MulExp '*' UnaryExp {
-        auto mulexp = make_unique<MulExpAST>();
+        auto mulexp = arena.New<MulExpAST>();
         mulexp->type = 2;
-        mulexp->mulexp = unique_ptr<BaseAST>($1);
+        mulexp->mulexp = $1;
         mulexp->mulop = MUL_OP;
-        mulexp->unaryexp = unique_ptr<BaseAST>($3);
-        $$ = mulexp.release();
+        mulexp->unaryexp = $3;
+        $$ = mulexp;
     }
     | MulExp '/' UnaryExp {
-        auto mulexp = make_unique<MulExpAST>();
+        auto mulexp = arena.New<MulExpAST>();
         mulexp->type = 2;
-        mulexp->mulexp = unique_ptr<BaseAST>($1);
+        mulexp->mulexp = $1;
         mulexp->mulop = DIV_OP;
-        mulexp->unaryexp = unique_ptr<BaseAST>($3);
-        $$ = mulexp.release();
+        mulexp->unaryexp = $3;
+        $$ = mulexp;
     }
     | MulExp '%' UnaryExp {
-        auto mulexp = make_unique<MulExpAST>();
+        auto mulexp = arena.New<MulExpAST>();
         mulexp->type = 2;
-        mulexp->mulexp = unique_ptr<BaseAST>($1);
+        mulexp->mulexp = $1;
         mulexp->mulop = MOD_OP;
-        mulexp->unaryexp = unique_ptr<BaseAST>($3);
-        $$ = mulexp.release();
+        mulexp->unaryexp = $3;
+        $$ = mulexp;
     }
     ;
 
 // UnaryExp ::= PrimaryExp | ('-'|'+'|'!') UnaryExp;
 UnaryExp
     : PrimaryExp {
-        auto unaryexp = make_unique<UnaryExpAST>();
+        auto unaryexp = arena.New<UnaryExpAST>();
         unaryexp->type = 1;
-        unaryexp->primaryexp_unaryexp = unique_ptr<BaseAST>($1);
-        $$ = unaryexp.release();
+        unaryexp->primaryexp_unaryexp = $1;
+        $$ = unaryexp;
     }
     | '+' UnaryExp {
-        auto unaryexp = make_unique<UnaryExpAST>();
+        auto unaryexp = arena.New<UnaryExpAST>();
         unaryexp->type = 2;
         unaryexp->unaryop = UNARY_PLUS;
-        unaryexp->primaryexp_unaryexp = unique_ptr<BaseAST>($2);
-        $$ = unaryexp.release();
+        unaryexp->primaryexp_unaryexp = $2;
+        $$ = unaryexp;
     }
     | '-' UnaryExp {
-        auto unaryexp = make_unique<UnaryExpAST>();
+        auto unaryexp = arena.New<UnaryExpAST>();
         unaryexp->type = 2;
         unaryexp->unaryop = UNARY_MINUS;
-        unaryexp->primaryexp_unaryexp = unique_ptr<BaseAST>($2);
-        $$ = unaryexp.release();
+        unaryexp->primaryexp_unaryexp = $2;
+        $$ = unaryexp;
     }
     | '!' UnaryExp {
-        auto unaryexp = make_unique<UnaryExpAST>();
+        auto unaryexp = arena.New<UnaryExpAST>();
         unaryexp->type = 2;
         unaryexp->unaryop = UNARY_NOT;
-        unaryexp->primaryexp_unaryexp = unique_ptr<BaseAST>($2);
-        $$ = unaryexp.release();
+        unaryexp->primaryexp_unaryexp = $2;
+        $$ = unaryexp;
     }
     ;
 
 // PrimaryExp ::= "(" Exp ")" | LVal | Number;
 PrimaryExp
     : '(' Exp ')' {
-        auto primaryexp = make_unique<PrimaryExpAST>();
+        auto primaryexp = arena.New<PrimaryExpAST>();
         primaryexp->type = 1;
-        primaryexp->exp_lval = unique_ptr<BaseAST>($2);
-        $$ = primaryexp.release();
+        primaryexp->exp_lval = $2;
+        $$ = primaryexp;
     }
     | LVal {
-        auto primaryexp = make_unique<PrimaryExpAST>();
+        auto primaryexp = arena.New<PrimaryExpAST>();
         primaryexp->type = 1;
-        primaryexp->exp_lval = unique_ptr<BaseAST>($1);
-        $$ = primaryexp.release();
+        primaryexp->exp_lval = $1;
+        $$ = primaryexp;
     }
     | INT_CONST{
-        auto primaryexp = make_unique<PrimaryExpAST>();
+        auto primaryexp = arena.New<PrimaryExpAST>();
         primaryexp->type = 2;
         primaryexp->number = $1;
-        $$ = primaryexp.release();
+        $$ = primaryexp;
     }
 
 
 // 额外插入辅助函数
 %%
-void yyerror(unique_ptr<BaseAST>&ast, const char* s){
-    extern int yylineno;
-    extern char* yytext;
-    fprintf(stderr, "ERROR: %s at '%s' on line %d\n", s, yytext, yylineno);
-    ast.reset();
+void yyerror(Scanner *scanner, BaseAST *&ast, Arena &arena, const char* s){
+    extern const char *ScannerText(Scanner *scanner);
+    extern int ScannerLine(Scanner *scanner);
+    fprintf(stderr, "ERROR: %s at '%s' on line %d\n", s, ScannerText(scanner), ScannerLine(scanner));
+    ast = nullptr;
 }
\ No newline at end of file
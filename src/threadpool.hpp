@@ -0,0 +1,92 @@
+#pragma once
+#include<algorithm>
+#include<atomic>
+#include<condition_variable>
+#include<deque>
+#include<functional>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+// 固定线程数的线程池
+class ThreadPool {
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable task_cv;    // 有新任务或需要退出
+        std::condition_variable idle_cv;    // 所有任务都已完成
+        size_t pending = 0;                 // 已提交但未完成的任务数
+        bool stopping = false;
+
+        void WorkerLoop() {
+            for (;;) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    task_cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                    if (tasks.empty()) return;
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (--pending == 0) idle_cv.notify_all();
+                }
+            }
+        }
+
+    public:
+        explicit ThreadPool(unsigned thread_cnt) {
+            thread_cnt = std::max(thread_cnt, 1u);
+            for (unsigned i = 0; i < thread_cnt; ++i) workers.emplace_back([this] { WorkerLoop(); });
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            task_cv.notify_all();
+            for (auto &worker : workers) worker.join();
+        }
+
+        unsigned Size() const { return workers.size(); }
+
+        void Submit(std::function<void()> task) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.push_back(std::move(task));
+                ++pending;
+            }
+            task_cv.notify_one();
+        }
+
+        // 等待已提交的任务全部完成
+        void Wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            idle_cv.wait(lock, [this] { return pending == 0; });
+        }
+};
+
+// 对 [0, n) 中的每个 i 调用 f(i), 各线程从共享计数器中领取下标
+template<typename F>
+void ParallelFor(ThreadPool &pool, size_t n, F f) {
+    std::atomic<size_t> next(0);
+    size_t worker_cnt = std::min<size_t>(pool.Size(), n);
+    for (size_t w = 0; w < worker_cnt; ++w) {
+        pool.Submit([&] {
+            for (size_t i = next++; i < n; i = next++) f(i);
+        });
+    }
+    pool.Wait();
+}
+
+// 默认线程数: 硬件并发数, 取不到时为 1
+static inline unsigned DefaultThreadCount() {
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
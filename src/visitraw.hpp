@@ -1,206 +1,433 @@
 #pragma once
 #include<cassert>
-#include<iostream>
-#include "koopa.h"
-#include<unordered_map>
-#include<string>
-
-static int stack_frame_length = 0;
-static int stack_frame_used = 0;
-
-static std::unordered_map<koopa_raw_value_t, std::string> loc;
-
-void Visit(const koopa_raw_slice_t &slice);   
-void Visit(const koopa_raw_function_t &func);      
-void Visit(const koopa_raw_basic_block_t &bb);     
-void Visit(const koopa_raw_value_t &value);        
-void Visit(const koopa_raw_return_t &ret);       
-void Visit(const koopa_raw_value_t &value, const koopa_raw_binary_t &binary);
-void Visit(const koopa_raw_integer_t &integer);    
-void Visit(const koopa_raw_load_t &load, const koopa_raw_value_t &value);
-void Visit(const koopa_raw_store_t &store);
-
-void Visit(const koopa_raw_program_t &program){
-    Visit(program.values);
-    Visit(program.funcs);
-}
-
-void Visit(const koopa_raw_slice_t &slice){
-    for (size_t i = 0; i < slice.len; ++i){
-        auto ptr = slice.buffer[i];
-        switch (slice.kind){
-            case KOOPA_RSIK_FUNCTION:
-                Visit(reinterpret_cast<koopa_raw_function_t>(ptr));
-                break;
-            case KOOPA_RSIK_BASIC_BLOCK:
-                Visit(reinterpret_cast<koopa_raw_basic_block_t>(ptr));
-                break;
-            case KOOPA_RSIK_VALUE:
-                Visit(reinterpret_cast<koopa_raw_value_t>(ptr));
-                break;
-            default:
-                assert(false);
+#include "emitter.hpp"
+#include "frame.hpp"
+#include "ir.hpp"
+#include<vector>
+#include<utility>
+#include "threadpool.hpp"
+#include "machine.hpp"
+#include "peephole.hpp"
+#include "regalloc.hpp"
+#include "riscv.hpp"
+#include "stats.hpp"
+#include "strength.hpp"
+
+// 值的位置: 寄存器或相对 sp 的栈槽
+struct Location {
+    enum Kind : uint8_t {NONE, REG, STACK};
+    Kind kind;
+    reg_t reg;
+    int32_t offset;
+};
+
+// 一个函数的后端状态, 各函数互不共享, 可以并行生成
+struct FunctionContext {
+    Emitter out;                        // 该函数的汇编
+    MachineFunction mf;                 // 生成的机器指令, 优化后输出到 out
+    const IrFunction *fn = nullptr;
+    std::vector<Location> loc;          // 按 ValueId 索引
+    std::vector<reg_t> saved_regs;      // 需保存的 callee-saved 寄存器
+    FrameLayout frame;
+    int emitted_inst_cnt = 0;
+    int spilled_value_cnt = 0;
+    int frame_bytes = 0;
+    BlockId next_block = kNoId;         // 布局中的下一个基本块, 跳到它时可以顺序执行
+    PeepholeStats peephole;
+    WorkerStats worker;                 // 在线程池中生成时的 CPU 时间和内存申请
+};
+
+// 后端线程数, 0 表示使用硬件并发数
+static unsigned codegen_threads = 0;
+
+static thread_local int emitted_inst_cnt = 0;    // 输出的指令条数
+static thread_local int spilled_value_cnt = 0;   // 溢出到栈上的值的个数
+static thread_local int frame_bytes = 0;         // 各函数栈帧的总字节数
+
+// 是否对生成的机器指令做窥孔优化, 以及各规则的统计
+static bool run_peephole = false;
+// 乘除模常量时是否改用移位和乘高位
+static bool run_strength_reduction = false;
+static thread_local PeepholeStats peephole_stats;
+
+void Visit(FunctionContext &ctx, const IrFunction &fn);
+void VisitBlock(FunctionContext &ctx, BlockId b);
+void VisitInst(FunctionContext &ctx, ValueId inst);
+void VisitReturn(FunctionContext &ctx, ValueId inst);
+void VisitBinary(FunctionContext &ctx, ValueId inst);
+void VisitLoad(FunctionContext &ctx, ValueId inst);
+void VisitStore(FunctionContext &ctx, ValueId inst);
+void VisitBranch(FunctionContext &ctx, ValueId inst);
+void VisitJump(FunctionContext &ctx, ValueId inst);
+
+// 指令先放入 ctx.mf, 函数生成完后统一输出
+static void Emit(FunctionContext &ctx, const MachineInst &inst) {
+    ctx.mf.insts.push_back(inst);
+}
+
+static const Location &LocationOf(const FunctionContext &ctx, ValueId value) {
+    return ctx.loc[value];
+}
+
+// 各函数在线程池上并行生成, 再按原顺序拼接, 输出与串行生成完全一致.
+// 串行生成时每个函数生成完就写出; 写出后释放该函数的汇编和机器指令
+void Visit(Emitter &out, const IrModule &module){
+    std::vector<FunctionContext> ctxs(module.funcs.size());
+    auto visit_func = [&](size_t i) {
+        Visit(ctxs[i], module.funcs[i]);
+    };
+    auto emit_func = [&](FunctionContext &ctx) {
+        out.Append(ctx.out);
+        emitted_inst_cnt += ctx.emitted_inst_cnt;
+        spilled_value_cnt += ctx.spilled_value_cnt;
+        frame_bytes += ctx.frame_bytes;
+        peephole_stats.Add(ctx.peephole);
+        ctx = FunctionContext();
+    };
+    unsigned thread_cnt = codegen_threads ? codegen_threads : DefaultThreadCount();
+    if (thread_cnt > 1 && ctxs.size() > 1) {
+        ThreadPool pool(std::min<size_t>(thread_cnt, ctxs.size()));
+        ParallelFor(pool, ctxs.size(), [&](size_t i) {
+            ctxs[i].worker.Measure([&] { visit_func(i); });
+        });
+        for (auto &ctx : ctxs) {
+            ctx.worker.Merge();
+            emit_func(ctx);
+        }
+    } else {
+        for (size_t i = 0; i < ctxs.size(); ++i) {
+            visit_func(i);
+            emit_func(ctxs[i]);
         }
     }
 }
 
-void Visit(const koopa_raw_function_t &func){
-    std::cout << " .text" << std::endl;
-    std::cout << " .global " << func->name+1 << std::endl;
-    std::cout << func->name+1 << ":" << std::endl;
+void Visit(FunctionContext &ctx, const IrFunction &fn){
+    const char *name = fn.name.c_str() + 1;
+    ctx.fn = &fn;
+    ctx.out << " .text\n";
+    ctx.out << " .global " << name << '\n';
+    ctx.out << name << ":\n";
 
-    stack_frame_length = 0;
-    stack_frame_used = 0;
+    ctx.mf.name = name;
+    ctx.mf.block_cnt = ctx.mf.label_cnt = fn.blocks.size();
+    RegAllocResult regs = AllocateRegisters(fn);
+    ctx.frame = LayoutFrame(fn, regs, false);   // IR 中还没有函数调用
+    // 帧超出 12 位立即数范围时, 留出 t6 给超范围的偏移计算地址, 重新分配
+    if (ctx.frame.NeedsAddressReg()) {
+        regs = AllocateRegisters(fn, REG_T6);
+        ctx.frame = LayoutFrame(fn, regs, false);
+    }
 
-    int var_cnt = 0;
-    for (size_t i = 0; i < func->bbs.len; ++i) {
-        const auto& insts = reinterpret_cast<koopa_raw_basic_block_t>(func->bbs.buffer[i])->insts;
-        var_cnt += insts.len;
-        for (size_t j = 0; j < insts.len; ++j) {
-            auto inst = reinterpret_cast<koopa_raw_value_t>(insts.buffer[j]);
-            if (inst->ty->tag == KOOPA_RTT_UNIT) var_cnt--;
+    // 已被优化删去的值不在任何基本块中, 没有栈槽
+    ctx.loc.assign(fn.values.size(), Location{Location::NONE, REG_NONE, 0});
+    for (ValueId v = 0; v < fn.values.size(); ++v) {
+        if (regs.reg[v] != REG_NONE) {
+            ctx.loc[v] = Location{Location::REG, regs.reg[v], 0};
+        } else if (ctx.frame.offset[v] >= 0) {
+            ctx.loc[v] = Location{Location::STACK, REG_NONE, ctx.frame.offset[v]};
         }
     }
+    ctx.spilled_value_cnt += regs.spill_cnt;
+    ctx.frame_bytes += ctx.frame.length;
 
-    stack_frame_length = var_cnt << 2;
-    stack_frame_length = (stack_frame_length + 16 -1) & (~(16-1));
+    ctx.saved_regs = regs.callee_saved;
+    if (ctx.frame.length != 0) {
+        Emit(ctx, MachineInst::I(RV_ADDI, REG_SP, REG_SP, -ctx.frame.length));
+    }
+    for (size_t i = 0; i < ctx.saved_regs.size(); ++i) {
+        Emit(ctx, MachineInst::Store(ctx.saved_regs[i], ctx.frame.save_base + (i << 2)));
+    }
+    if (ctx.frame.ra_offset >= 0) Emit(ctx, MachineInst::Store(REG_RA, ctx.frame.ra_offset));
 
-    if (stack_frame_length != 0) {
-        std::cout << "  addi sp, sp, -" << stack_frame_length << std::endl;
+    for (size_t i = 0; i < fn.layout.size(); ++i) {
+        ctx.next_block = i + 1 < fn.layout.size() ? fn.layout[i + 1] : kNoId;
+        VisitBlock(ctx, fn.layout[i]);
     }
 
-    Visit(func->bbs);
+    if (run_peephole) RunPeephole(ctx.mf, ctx.peephole);
+    if (ctx.frame.NeedsAddressReg()) LegalizeImmediates(ctx.mf, REG_T6);
+    ctx.emitted_inst_cnt += ctx.mf.Print(ctx.out);
 }
 
-void Visit(const koopa_raw_basic_block_t &bb){
-
-    Visit(bb->insts);
+// 入口基本块紧跟在序言之后, 不会成为跳转目标
+void VisitBlock(FunctionContext &ctx, BlockId b){
+    if (b != ctx.fn->Entry()) Emit(ctx, MachineInst::Label(b));
+    for (auto inst : ctx.fn->blocks[b].insts) VisitInst(ctx, inst);
 }
 
-void Visit(const koopa_raw_value_t &value){
-    const auto &kind = value->kind;
-    switch(kind.tag) {
-        case KOOPA_RVT_RETURN:
-            Visit(kind.data.ret);
+void VisitInst(FunctionContext &ctx, ValueId inst){
+    switch((*ctx.fn)[inst].op) {
+        case IR_RETURN:
+            VisitReturn(ctx, inst);
+            break;
+        case IR_BINARY:
+            VisitBinary(ctx, inst);
             break;
-        case KOOPA_RVT_INTEGER:
-            Visit(kind.data.integer);
+        case IR_ALLOC:
             break;
-        case KOOPA_RVT_BINARY:
-            Visit(value, kind.data.binary);
+        case IR_LOAD:
+            VisitLoad(ctx, inst);
             break;
-        case KOOPA_RVT_ALLOC:
-            loc[value] = std::to_string(stack_frame_used) + "(sp)";
-            stack_frame_used += 4;
+        case IR_STORE:
+            VisitStore(ctx, inst);
             break;
-        case KOOPA_RVT_LOAD:
-            Visit(kind.data.load, value);
+        case IR_BRANCH:
+            VisitBranch(ctx, inst);
             break;
-        case KOOPA_RVT_STORE:
-            Visit(kind.data.store);
+        case IR_JUMP:
+            VisitJump(ctx, inst);
             break;
-        
         default:
             assert(false);
     }
 }
 
-static void load2reg(const koopa_raw_value_t &value, const std::string &reg) {
-    if (value->kind.tag == KOOPA_RVT_INTEGER) {
-        std::cout << "  li " << reg << ", " << value->kind.data.integer.value << std::endl;
-    }
-    else {
-        std::cout << "  lw " << reg << ", " << loc[value] <<  std::endl;
+// 返回存放 value 的寄存器; value 不在寄存器中时先装入 reg
+static reg_t load2reg(FunctionContext &ctx, ValueId value, reg_t reg) {
+    const auto &v = (*ctx.fn)[value];
+    if (v.op == IR_INTEGER) {
+        Emit(ctx, MachineInst::Li(reg, v.imm));
+        return reg;
     }
+    // mem2reg 后未初始化的变量读作 undef, 取任意值均可
+    if (v.op == IR_UNDEF) return REG_ZERO;
+    const auto &location = LocationOf(ctx, value);
+    if (location.kind == Location::REG) return location.reg;
+    Emit(ctx, MachineInst::Load(reg, location.offset));
+    return reg;
 }
 
-void Visit(const koopa_raw_return_t &ret){
-    load2reg(ret.value, "a0");
-    if (stack_frame_length != 0) {
-        std::cout << "  addi sp, sp, " << stack_frame_length << std::endl;
-    }
-    std::cout << "  ret" << std::endl;
+// 计算 value 时写入的寄存器: 分配到寄存器则直接写入, 否则先写入 tmp
+static reg_t ResultReg(const FunctionContext &ctx, ValueId value, reg_t tmp) {
+    const auto &location = LocationOf(ctx, value);
+    return location.kind == Location::REG ? location.reg : tmp;
 }
 
-void Visit(const koopa_raw_integer_t &integer){
-    std::cout << "  li a0, " << integer.value << std::endl;
+// 溢出的值写回栈槽
+static void StoreResult(FunctionContext &ctx, ValueId value, reg_t reg) {
+    const auto &location = LocationOf(ctx, value);
+    if (location.kind == Location::STACK) Emit(ctx, MachineInst::Store(reg, location.offset));
 }
 
-void Visit(const koopa_raw_value_t &value, const koopa_raw_binary_t &binary) {
-    load2reg(binary.lhs, "t0");
-    load2reg(binary.rhs, "t1");
+void VisitReturn(FunctionContext &ctx, ValueId inst){
+    auto operands = ctx.fn->Operands(inst);
+    if (operands.size) {
+        auto reg = load2reg(ctx, operands[0], REG_A0);
+        if (reg != REG_A0) Emit(ctx, MachineInst::Unary(RV_MV, REG_A0, reg));
+    }
+    for (size_t i = 0; i < ctx.saved_regs.size(); ++i) {
+        Emit(ctx, MachineInst::Load(ctx.saved_regs[i], ctx.frame.save_base + (i << 2)));
+    }
+    if (ctx.frame.ra_offset >= 0) Emit(ctx, MachineInst::Load(REG_RA, ctx.frame.ra_offset));
+    if (ctx.frame.length != 0) {
+        Emit(ctx, MachineInst::I(RV_ADDI, REG_SP, REG_SP, ctx.frame.length));
+    }
+    Emit(ctx, MachineInst::Ret());
+}
+
+void VisitBinary(FunctionContext &ctx, ValueId value) {
+    const auto &fn = *ctx.fn;
+    auto op = fn[value].BinaryOp();
+    auto lhs_value = fn.Operands(value)[0], rhs_value = fn.Operands(value)[1];
+    if (run_strength_reduction) {
+        // 常量乘数换到右边; 右边是常量时不装入 t1, 由 ReduceByConstant 用作临时寄存器
+        if (op == KOOPA_RBO_MUL && fn[lhs_value].op == IR_INTEGER && fn[rhs_value].op != IR_INTEGER) {
+            std::swap(lhs_value, rhs_value);
+        }
+        if (fn[rhs_value].op == IR_INTEGER && fn[lhs_value].op != IR_INTEGER) {
+            size_t mark = ctx.mf.insts.size();
+            auto src = load2reg(ctx, lhs_value, REG_T0);
+            auto dst = ResultReg(ctx, value, REG_T0);
+            if (ReduceByConstant(ctx.mf.insts, op, dst, src, fn[rhs_value].imm)) {
+                StoreResult(ctx, value, dst);
+                return;
+            }
+            ctx.mf.insts.resize(mark);     // 不能削弱时撤销 lhs 的装入, 按一般情况生成
+        }
+    }
+
+    auto lhs = load2reg(ctx, lhs_value, REG_T0);
+    auto rhs = load2reg(ctx, rhs_value, REG_T1);
+    auto dst = ResultReg(ctx, value, REG_T0);
 
-    switch (binary.op) {
+    switch (op) {
         case KOOPA_RBO_NOT_EQ:
-            std::cout << "  xor t0, t0, t1" << std::endl;
-            std::cout << "  snez t0, t0" << std::endl;
+            Emit(ctx, MachineInst::R(RV_XOR, dst, lhs, rhs));
+            Emit(ctx, MachineInst::Unary(RV_SNEZ, dst, dst));
             break;
         case KOOPA_RBO_EQ:
-            std::cout << "  xor t0, t0, t1" << std::endl;
-            std::cout << "  seqz t0, t0" << std::endl;
+            Emit(ctx, MachineInst::R(RV_XOR, dst, lhs, rhs));
+            Emit(ctx, MachineInst::Unary(RV_SEQZ, dst, dst));
             break;
         case KOOPA_RBO_GT:
-            std::cout << "  sgt t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_SGT, dst, lhs, rhs));
             break;
         case KOOPA_RBO_LT:
-            std::cout << "  slt t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_SLT, dst, lhs, rhs));
             break;
         case KOOPA_RBO_GE:
-            std::cout << "  slt t0, t0, t1" << std::endl;
-            std::cout << "  xori t0, t0, 1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_SLT, dst, lhs, rhs));
+            Emit(ctx, MachineInst::I(RV_XORI, dst, dst, 1));
             break;
         case KOOPA_RBO_LE:
-            std::cout << "  sgt t0, t0, t1" << std::endl;
-            std::cout << "  xori t0, t0, 1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_SGT, dst, lhs, rhs));
+            Emit(ctx, MachineInst::I(RV_XORI, dst, dst, 1));
             break;
         case KOOPA_RBO_ADD:
-            std::cout << "  add t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_ADD, dst, lhs, rhs));
             break;
         case KOOPA_RBO_SUB:
-            std::cout << "  sub t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_SUB, dst, lhs, rhs));
             break;
         case KOOPA_RBO_MUL:
-            std::cout << "  mul t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_MUL, dst, lhs, rhs));
             break;
         case KOOPA_RBO_DIV:
-            std::cout << "  div t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_DIV, dst, lhs, rhs));
             break;
         case KOOPA_RBO_MOD:
-            std::cout << "  rem t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_REM, dst, lhs, rhs));
             break;
         case KOOPA_RBO_AND:
-            std::cout << "  and t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_AND, dst, lhs, rhs));
             break;
         case KOOPA_RBO_OR:
-            std::cout << "  or t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_OR, dst, lhs, rhs));
             break;
         case KOOPA_RBO_XOR:
-            std::cout << "  xor t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_XOR, dst, lhs, rhs));
             break;
         case KOOPA_RBO_SHL:
-            std::cout << "  sll t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_SLL, dst, lhs, rhs));
             break;
         case KOOPA_RBO_SHR:
-            std::cout << "  srl t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_SRL, dst, lhs, rhs));
             break;
         case KOOPA_RBO_SAR:
-            std::cout << "  sra t0, t0, t1" << std::endl;
+            Emit(ctx, MachineInst::R(RV_SRA, dst, lhs, rhs));
             break;
     }
 
-    loc[value] = std::to_string(stack_frame_used) + "(sp)";
-    stack_frame_used += 4;
-    std::cout << "  sw t0, " << loc[value] << std::endl;
+    StoreResult(ctx, value, dst);
+}
+
+void VisitLoad(FunctionContext &ctx, ValueId value){
+    auto dst = ResultReg(ctx, value, REG_T0);
+    Emit(ctx, MachineInst::Load(dst, LocationOf(ctx, ctx.fn->Operands(value)[0]).offset));
+    StoreResult(ctx, value, dst);
+}
+
+void VisitStore(FunctionContext &ctx, ValueId inst) {
+    auto operands = ctx.fn->Operands(inst);
+    auto reg = load2reg(ctx, operands[0], REG_T0);
+    Emit(ctx, MachineInst::Store(reg, LocationOf(ctx, operands[1]).offset));
+}
+
+// 基本块参数传递中的一次复制, 源为立即数或某个位置
+struct CopyMove {
+    Location dst;
+    Location src;
+    bool is_imm;
+    int32_t imm;
+};
+
+static bool SameLocation(const Location &a, const Location &b) {
+    if (a.kind != b.kind) return false;
+    if (a.kind == Location::REG) return a.reg == b.reg;
+    return a.kind == Location::STACK && a.offset == b.offset;
+}
+
+// 栈到栈的复制和立即数写入栈槽经过 t1
+static void EmitMove(FunctionContext &ctx, const CopyMove &move) {
+    const auto &dst = move.dst;
+    reg_t reg = dst.kind == Location::REG ? dst.reg : REG_T1;
+    if (move.is_imm) {
+        Emit(ctx, MachineInst::Li(reg, move.imm));
+    } else if (move.src.kind == Location::STACK) {
+        Emit(ctx, MachineInst::Load(reg, move.src.offset));
+    } else if (dst.kind == Location::REG) {
+        Emit(ctx, MachineInst::Unary(RV_MV, reg, move.src.reg));
+        return;
+    } else {
+        reg = move.src.reg;
+    }
+    if (dst.kind == Location::STACK) Emit(ctx, MachineInst::Store(reg, dst.offset));
+}
+
+// 把实参并行地复制到目标基本块的参数中. 依次输出目标不再被读取的复制;
+// 只剩环时把其中一个目标的旧值暂存到 t0, 把环断开
+static void EmitBlockArgs(FunctionContext &ctx, BlockId target, const std::vector<ValueId> &args) {
+    const auto &fn = *ctx.fn;
+    std::vector<CopyMove> pending;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const auto &arg = fn[args[i]];
+        CopyMove move;
+        move.dst = LocationOf(ctx, fn.blocks[target].params[i]);
+        move.is_imm = arg.IsConstant();
+        move.imm = arg.op == IR_INTEGER ? arg.imm : 0;
+        if (!move.is_imm) move.src = LocationOf(ctx, args[i]);
+        if (move.dst.kind == Location::NONE) continue;
+        if (!move.is_imm && SameLocation(move.src, move.dst)) continue;
+        pending.push_back(move);
+    }
+
+    while (!pending.empty()) {
+        size_t ready = pending.size();
+        for (size_t i = 0; i < pending.size() && ready == pending.size(); ++i) {
+            bool blocked = false;
+            for (size_t j = 0; j < pending.size() && !blocked; ++j) {
+                blocked = j != i && !pending[j].is_imm && SameLocation(pending[j].src, pending[i].dst);
+            }
+            if (!blocked) ready = i;
+        }
+        if (ready == pending.size()) {
+            CopyMove save{Location{Location::REG, REG_T0, 0}, pending[0].dst, false, 0};
+            EmitMove(ctx, save);
+            for (auto &move : pending) {
+                if (!move.is_imm && SameLocation(move.src, save.src)) move.src = save.dst;
+            }
+            continue;
+        }
+        EmitMove(ctx, pending[ready]);
+        pending.erase(pending.begin() + ready);
+    }
 }
 
-void Visit(const koopa_raw_load_t &load, const koopa_raw_value_t &value){
-    load2reg(load.src, "t0");
-    loc[value] = std::to_string(stack_frame_used) + "(sp)";
-    stack_frame_used += 4;
-    std::cout << "  sw t0, " << loc[value] << std::endl;
+// 传递参数后跳到 target; target 紧随其后且允许顺序执行时省去 j
+static void EmitJump(FunctionContext &ctx, BlockId target, const std::vector<ValueId> &args, bool fall_through) {
+    EmitBlockArgs(ctx, target, args);
+    if (fall_through && target == ctx.next_block) return;
+    Emit(ctx, MachineInst::Jump(target));
 }
 
-void Visit(const koopa_raw_store_t &store) {
-    load2reg(store.value, "t0");
-    std::cout << "  sw t0, " << loc[store.dest] << std::endl;
-}
\ No newline at end of file
+void VisitBranch(FunctionContext &ctx, ValueId inst) {
+    const auto &fn = *ctx.fn;
+    const auto &branch = fn[inst];
+    auto true_bb = branch.targets[0], false_bb = branch.targets[1];
+    auto true_args = fn.EdgeArgs(inst, 0), false_args = fn.EdgeArgs(inst, 1);
+    auto cond = load2reg(ctx, fn.Operands(inst)[0], REG_T0);
+    if (true_args.empty() && false_args.empty()) {
+        if (true_bb == ctx.next_block) {
+            Emit(ctx, MachineInst::Branch(RV_BEQZ, cond, REG_NONE, false_bb));
+        } else {
+            Emit(ctx, MachineInst::Branch(RV_BNEZ, cond, REG_NONE, true_bb));
+            EmitJump(ctx, false_bb, false_args, true);
+        }
+        return;
+    }
+
+    // 带参数的一侧需要先复制参数: 条件为假时跳到 false 一侧的参数传递块
+    bool edge_block = !false_args.empty();
+    uint32_t else_label = edge_block ? ctx.mf.NewLabel() : false_bb;
+    Emit(ctx, MachineInst::Branch(RV_BEQZ, cond, REG_NONE, else_label));
+    EmitJump(ctx, true_bb, true_args, !edge_block);
+    if (edge_block) {
+        Emit(ctx, MachineInst::Label(else_label));
+        EmitJump(ctx, false_bb, false_args, true);
+    }
+}
+
+void VisitJump(FunctionContext &ctx, ValueId inst) {
+    EmitJump(ctx, (*ctx.fn)[inst].targets[0], ctx.fn->EdgeArgs(inst, 0), true);
+}
@@ -0,0 +1,355 @@
+// IR 与 koopa_raw_program_t 互相转换的往返测试: 用 KoopaBuilder 构造 raw program,
+// 比较 raw 的 Koopa 文本, FromRaw 后由 irprinter 输出的文本, 以及 ToRaw 再转换回来的 raw 的文本,
+// 三者必须逐字相同. 再对 FromRaw 的结果运行 mem2reg 等 pass, 检查带基本块参数的 IR 往返后不变.
+// 最后检查 alloc 和基本块名为 %0 这样的编号时, irprinter 给临时值的编号不与它们重复.
+#include<cstdio>
+#include<string>
+#include<unordered_map>
+#include<unordered_set>
+#include<vector>
+#include "irbuilder.hpp"
+#include "irconvert.hpp"
+#include "irprinter.hpp"
+#include "passmanager.hpp"
+
+static int failures = 0;
+
+// 按 irprinter 的格式直接输出 raw program: alloc 用自己的名字, 其余的值在函数内按出现顺序编号
+class RawPrinter {
+    private:
+        std::string out;
+        std::unordered_map<koopa_raw_value_t, std::string> names;
+
+        template<typename T>
+        static T Item(const koopa_raw_slice_t &slice, size_t i) { return reinterpret_cast<T>(slice.buffer[i]); }
+
+        void Operand(koopa_raw_value_t value) {
+            if (value->kind.tag == KOOPA_RVT_INTEGER) out += std::to_string(value->kind.data.integer.value);
+            else if (value->kind.tag == KOOPA_RVT_UNDEF) out += "undef";
+            else out += names.at(value);
+        }
+
+        void Target(koopa_raw_basic_block_t bb, const koopa_raw_slice_t &args) {
+            out += bb->name;
+            if (!args.len) return;
+            out += "(";
+            for (size_t i = 0; i < args.len; ++i) {
+                if (i) out += ", ";
+                Operand(Item<koopa_raw_value_t>(args, i));
+            }
+            out += ")";
+        }
+
+        void Inst(koopa_raw_value_t inst) {
+            static const char *ops[] = {"ne", "eq", "gt", "lt", "ge", "le", "add", "sub", "mul",
+                                        "div", "mod", "and", "or", "xor", "shl", "shr", "sar"};
+            const auto &kind = inst->kind;
+            out += "  ";
+            if (names.count(inst)) out += names[inst] + " = ";
+            switch (kind.tag) {
+                case KOOPA_RVT_ALLOC:
+                    out += "alloc i32";
+                    break;
+                case KOOPA_RVT_LOAD:
+                    out += "load ";
+                    Operand(kind.data.load.src);
+                    break;
+                case KOOPA_RVT_STORE:
+                    out += "store ";
+                    Operand(kind.data.store.value);
+                    out += ", ";
+                    Operand(kind.data.store.dest);
+                    break;
+                case KOOPA_RVT_BINARY:
+                    out += std::string(ops[kind.data.binary.op]) + " ";
+                    Operand(kind.data.binary.lhs);
+                    out += ", ";
+                    Operand(kind.data.binary.rhs);
+                    break;
+                case KOOPA_RVT_BRANCH:
+                    out += "br ";
+                    Operand(kind.data.branch.cond);
+                    out += ", ";
+                    Target(kind.data.branch.true_bb, kind.data.branch.true_args);
+                    out += ", ";
+                    Target(kind.data.branch.false_bb, kind.data.branch.false_args);
+                    break;
+                case KOOPA_RVT_JUMP:
+                    out += "jump ";
+                    Target(kind.data.jump.target, kind.data.jump.args);
+                    break;
+                case KOOPA_RVT_RETURN:
+                    out += "ret";
+                    if (kind.data.ret.value) {
+                        out += " ";
+                        Operand(kind.data.ret.value);
+                    }
+                    break;
+                default:
+                    out += "<unknown>";
+            }
+            out += "\n";
+        }
+
+        void Function(koopa_raw_function_t func) {
+            names.clear();
+            int tmp_cnt = 0;
+            for (size_t i = 0; i < func->bbs.len; ++i) {
+                auto bb = Item<koopa_raw_basic_block_t>(func->bbs, i);
+                for (size_t j = 0; j < bb->params.len; ++j) {
+                    names[Item<koopa_raw_value_t>(bb->params, j)] = "%" + std::to_string(tmp_cnt++);
+                }
+                for (size_t j = 0; j < bb->insts.len; ++j) {
+                    auto inst = Item<koopa_raw_value_t>(bb->insts, j);
+                    if (inst->kind.tag == KOOPA_RVT_ALLOC) names[inst] = inst->name;
+                    else if (inst->ty->tag == KOOPA_RTT_INT32) names[inst] = "%" + std::to_string(tmp_cnt++);
+                }
+            }
+
+            out += std::string("fun ") + func->name + "()";
+            if (func->ty->data.function.ret->tag != KOOPA_RTT_UNIT) out += ": i32";
+            out += " {\n";
+            for (size_t i = 0; i < func->bbs.len; ++i) {
+                auto bb = Item<koopa_raw_basic_block_t>(func->bbs, i);
+                out += bb->name;
+                if (bb->params.len) {
+                    out += "(";
+                    for (size_t j = 0; j < bb->params.len; ++j) {
+                        if (j) out += ", ";
+                        out += names[Item<koopa_raw_value_t>(bb->params, j)] + ": i32";
+                    }
+                    out += ")";
+                }
+                out += ":\n";
+                for (size_t j = 0; j < bb->insts.len; ++j) Inst(Item<koopa_raw_value_t>(bb->insts, j));
+            }
+            out += "}\n";
+        }
+
+    public:
+        std::string Print(const koopa_raw_program_t &program) {
+            out.clear();
+            for (size_t i = 0; i < program.funcs.len; ++i) {
+                if (i) out += "\n";
+                Function(Item<koopa_raw_function_t>(program.funcs, i));
+            }
+            return out;
+        }
+};
+
+static std::string RawText(const koopa_raw_program_t &program) {
+    return RawPrinter().Print(program);
+}
+
+static std::string IrText(const IrModule &module) {
+    Emitter out;
+    DumpKoopa(out, module);
+    return std::string(out.Data(), out.Size());
+}
+
+static void Expect(const char *name, const char *what, const std::string &expected, const std::string &actual) {
+    if (expected == actual) return;
+    ++failures;
+    std::printf("FAIL %s: %s differs\n--- expected\n%s--- actual\n%s", name, what, expected.c_str(), actual.c_str());
+}
+
+// raw -> FromRaw -> ToRaw, 三处的文本都相同
+static void RoundTrip(const char *name, const koopa_raw_program_t &raw) {
+    std::string text = RawText(raw);
+    IrModule module = FromRaw(raw);
+    Expect(name, "FromRaw", text, IrText(module));
+    KoopaBuilder builder;
+    Expect(name, "ToRaw", text, RawText(ToRaw(builder, module)));
+}
+
+// 在 IR 上运行 pass 之后再往返一次: IR -> ToRaw -> FromRaw 的文本不变; 返回 IR 中是否有基本块参数
+static bool RoundTripAfterPasses(const char *name, const koopa_raw_program_t &input, const char *passes) {
+    IrModule module = FromRaw(input);
+    PassPipeline pipeline;
+    std::string error;
+    pipeline.Parse(passes, error);
+    CompileStats stats;
+    RunPasses(module, pipeline, stats);
+    std::string text = IrText(module);
+    KoopaBuilder builder;
+    auto raw = ToRaw(builder, module);
+    Expect(name, passes, text, RawText(raw));
+    Expect(name, passes, text, IrText(FromRaw(raw)));
+    return text.find("(%") != std::string::npos;
+}
+
+// 只有一个基本块, 覆盖 alloc/load/store/binary/ret 和没有返回值的函数
+static koopa_raw_program_t StraightLine(KoopaBuilder &b) {
+    b.BeginFunction("@main", b.Int32Type());
+    b.SetInsertPoint(b.NewBlock("%entry"));
+    auto x = b.Alloc("@x");
+    auto y = b.Alloc("@y");
+    b.Store(b.Integer(5), x);
+    auto v = b.Load(x);
+    auto m = b.Binary(KOOPA_RBO_MUL, v, b.Integer(3));
+    b.Store(b.Binary(KOOPA_RBO_SUB, b.Integer(0), m), y);
+    auto w = b.Binary(KOOPA_RBO_EQ, b.Load(y), b.Integer(0));
+    b.Return(b.Binary(KOOPA_RBO_MOD, b.Binary(KOOPA_RBO_SAR, w, m), b.Integer(-7)));
+    b.EndFunction();
+
+    b.BeginFunction("@f", b.UnitType());
+    b.SetInsertPoint(b.NewBlock("%entry"));
+    b.Return(nullptr);
+    b.EndFunction();
+    return b.Finish();
+}
+
+// 循环和短路求值, 局部变量都在内存中; mem2reg 之后会出现基本块参数
+static koopa_raw_program_t Loop(KoopaBuilder &b) {
+    b.BeginFunction("@main", b.Int32Type());
+    auto entry = b.NewBlock("%entry");
+    auto cond = b.NewBlock("%while_cond");
+    auto body = b.NewBlock("%while_body");
+    auto rhs = b.NewBlock("%land_rhs");
+    auto join = b.NewBlock("%land_end");
+    auto end = b.NewBlock("%while_end");
+
+    b.SetInsertPoint(entry);
+    auto i = b.Alloc("@i");
+    auto s = b.Alloc("@s");
+    auto t = b.Alloc("@land");
+    b.Store(b.Integer(0), i);
+    b.Store(b.Integer(0), s);
+    b.Jump(cond);
+
+    b.SetInsertPoint(cond);
+    b.Branch(b.Binary(KOOPA_RBO_LT, b.Load(i), b.Integer(10)), body, end);
+
+    b.SetInsertPoint(body);
+    b.Store(b.Integer(0), t);
+    b.Branch(b.Binary(KOOPA_RBO_GT, b.Load(i), b.Integer(2)), rhs, join);
+
+    b.SetInsertPoint(rhs);
+    b.Store(b.Binary(KOOPA_RBO_NOT_EQ, b.Load(s), b.Integer(7)), t);
+    b.Jump(join);
+
+    b.SetInsertPoint(join);
+    b.Store(b.Binary(KOOPA_RBO_ADD, b.Load(s), b.Load(t)), s);
+    b.Store(b.Binary(KOOPA_RBO_ADD, b.Load(i), b.Integer(1)), i);
+    b.Jump(cond);
+
+    b.SetInsertPoint(end);
+    b.Return(b.Load(s));
+    b.EndFunction();
+    return b.Finish();
+}
+
+// 直接带有基本块参数和 undef 实参; %exit 排在 %loop 之前, 却使用了 %loop 中定义的值
+static koopa_raw_program_t BlockParams(KoopaBuilder &b) {
+    b.BeginFunction("@main", b.Int32Type());
+    auto entry = b.NewBlock("%entry");
+    auto exit = b.NewBlock("%exit");
+    auto loop = b.NewBlock("%loop");
+    auto p = b.AddBlockParam(loop);
+    auto q = b.AddBlockParam(loop);
+
+    b.SetInsertPoint(entry);
+    auto jump = b.Jump(loop);
+    MutableValue(jump)->kind.data.jump.args = b.MakeSlice({b.Integer(0), b.Undef()}, KOOPA_RSIK_VALUE);
+
+    b.SetInsertPoint(loop);
+    auto n = b.Binary(KOOPA_RBO_ADD, p, b.Integer(1));
+    auto br = b.Branch(b.Binary(KOOPA_RBO_LT, n, b.Integer(10)), loop, exit);
+    MutableValue(br)->kind.data.branch.true_args = b.MakeSlice({n, p}, KOOPA_RSIK_VALUE);
+
+    b.SetInsertPoint(exit);
+    b.Return(b.Binary(KOOPA_RBO_ADD, n, q));
+    b.EndFunction();
+    return b.Finish();
+}
+
+// .koopa 输入中的名字可以与临时值的编号同形
+static koopa_raw_program_t NumberedNames(KoopaBuilder &b) {
+    b.BeginFunction("@main", b.Int32Type());
+    auto entry = b.NewBlock("%entry");
+    auto next = b.NewBlock("%1");
+    b.SetInsertPoint(entry);
+    auto x = b.Alloc("%0");
+    auto y = b.Alloc("%3");
+    b.Store(b.Integer(1), x);
+    b.Store(b.Load(x), y);
+    b.Jump(next);
+    b.SetInsertPoint(next);
+    b.Return(b.Binary(KOOPA_RBO_ADD, b.Load(x), b.Load(y)));
+    b.EndFunction();
+    return b.Finish();
+}
+
+// 文本中定义了两次的名字 (基本块, 基本块参数或指令结果), 没有时返回空串
+static std::string DefinedTwice(const std::string &text) {
+    std::unordered_set<std::string> defined;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        std::string line = text.substr(begin, end - begin);
+        begin = end + 1;
+        std::vector<std::string> names;
+        if (line.compare(0, 2, "  ") == 0) {
+            size_t eq = line.find(" = ");
+            if (eq != std::string::npos) names.push_back(line.substr(2, eq - 2));
+        } else if (!line.empty() && line[0] == '%') {
+            size_t paren = line.find('(');
+            names.push_back(line.substr(0, paren == std::string::npos ? line.size() - 1 : paren));
+            while (paren != std::string::npos) {
+                size_t colon = line.find(':', paren);
+                if (colon == std::string::npos || line[colon + 1] != ' ') break;
+                names.push_back(line.substr(paren + 1, colon - paren - 1));
+                paren = line.find(", ", colon);
+                if (paren != std::string::npos) ++paren;
+            }
+        }
+        for (const auto &name : names) {
+            if (!defined.insert(name).second) return name;
+        }
+    }
+    return "";
+}
+
+int main() {
+    struct Case {
+        const char *name;
+        koopa_raw_program_t (*build)(KoopaBuilder &);
+    };
+    const Case cases[] = {{"straight-line", StraightLine}, {"loop", Loop}, {"block params", BlockParams}};
+    for (const auto &c : cases) {
+        KoopaBuilder builder;
+        int before = failures;
+        auto raw = c.build(builder);
+        RoundTrip(c.name, raw);
+        bool params = false;
+        for (const char *passes : {"mem2reg", "mem2reg,sccp,dce"}) params |= RoundTripAfterPasses(c.name, raw, passes);
+        if (failures == before) std::printf("ok   %s%s\n", c.name, params ? " (with block params)" : "");
+    }
+    {
+        KoopaBuilder builder;
+        auto raw = NumberedNames(builder);
+        int before = failures;
+        for (const char *passes : {"", "mem2reg"}) {
+            IrModule module = FromRaw(raw);
+            PassPipeline pipeline;
+            std::string error;
+            pipeline.Parse(passes, error);
+            CompileStats stats;
+            RunPasses(module, pipeline, stats);
+            std::string text = IrText(module), twice = DefinedTwice(text);
+            if (!twice.empty()) {
+                ++failures;
+                std::printf("FAIL numbered names: %s defined twice\n%s", twice.c_str(), text.c_str());
+            }
+            KoopaBuilder again;
+            Expect("numbered names", "ToRaw", text, IrText(FromRaw(ToRaw(again, module))));
+        }
+        if (failures == before) std::printf("ok   numbered names\n");
+    }
+    if (failures) {
+        std::printf("%d round trips differ\n", failures);
+        return 1;
+    }
+    std::printf("all round trips passed\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+// flex 扫描器 (yylex_raw) 与手写扫描器 (FastLexer::Next) 的差分测试:
+// 两者扫描同一段输入, 每个词法单元的种类, sym_val / int_val 以及行号都必须相同.
+// 语料是固定的用例加上由片段随机拼接的输入, 随机数种子固定, 每次运行结果相同.
+#include<cstdint>
+#include<cstdio>
+#include<string>
+#include<vector>
+#include "lexer.hpp"
+
+extern int yylex_init(yyscan_t *scanner);
+extern int yylex_destroy(yyscan_t scanner);
+extern void yyset_in(FILE *in, yyscan_t scanner);
+extern int yyget_lineno(yyscan_t scanner);
+extern int yylex_raw(YYSTYPE *yylval_param, yyscan_t yyscanner);
+
+struct Token {
+    int kind;
+    int64_t value;      // IDENT 为 sym_val, INT_CONST 为 int_val
+    int line;
+
+    bool operator==(const Token &other) const {
+        return kind == other.kind && value == other.value && line == other.line;
+    }
+};
+
+static int64_t ValueOf(int kind, const YYSTYPE &lval) {
+    if (kind == IDENT) return lval.sym_val;
+    if (kind == INT_CONST) return lval.int_val;
+    return 0;
+}
+
+static std::vector<Token> ScanFlex(const std::string &input) {
+    std::vector<Token> tokens;
+    FILE *file = std::tmpfile();
+    std::fwrite(input.data(), 1, input.size(), file);
+    std::rewind(file);
+    yyscan_t scanner;
+    yylex_init(&scanner);
+    yyset_in(file, scanner);
+    YYSTYPE lval;
+    while (int kind = yylex_raw(&lval, scanner)) tokens.push_back(Token{kind, ValueOf(kind, lval), yyget_lineno(scanner)});
+    yylex_destroy(scanner);
+    std::fclose(file);
+    return tokens;
+}
+
+static std::vector<Token> ScanFast(const std::string &input) {
+    std::vector<Token> tokens;
+    FastLexer lexer(input.data(), input.size());
+    YYSTYPE lval;
+    while (int kind = lexer.Next(&lval)) tokens.push_back(Token{kind, ValueOf(kind, lval), lexer.Line()});
+    return tokens;
+}
+
+// 输出时转义不可见字符
+static std::string Escape(const std::string &text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '\n') escaped += "\\n";
+        else if (c == '\r') escaped += "\\r";
+        else if (c == '\t') escaped += "\\t";
+        else escaped += c;
+    }
+    return escaped;
+}
+
+static void PrintTokens(const char *name, const std::vector<Token> &tokens) {
+    std::printf("  %s:", name);
+    for (const auto &token : tokens) std::printf(" %d:%lld@%d", token.kind, static_cast<long long>(token.value), token.line);
+    std::printf("\n");
+}
+
+static bool Check(const std::string &input) {
+    auto flex = ScanFlex(input), fast = ScanFast(input);
+    if (flex == fast) return true;
+    std::printf("FAIL \"%s\"\n", Escape(input).c_str());
+    PrintTokens("flex", flex);
+    PrintTokens("fast", fast);
+    return false;
+}
+
+static const char *cases[] = {
+    "",
+    "int main() {\n  return 0;\n}\n",
+    "int main() {\r\n  const int x = 1;\r\n  int y = x + 2;\r\n  return y;\r\n}\r\n",
+    // 块注释, 包括连续的 *, 紧跟 / 的 *, 以及没有结束的注释
+    "/**/", "/***/", "/****/x", "/* a ** b ***/ y", "/*/ */z", "/* * / */w", "/*\n*\n**/\nq",
+    "a/**/b", "1/*2*/3", "/* x", "/* x *", "/* x **", "/*", "/", "*/", "/*/", "a /* b */ c /* d",
+    // 行注释, 包括文件末尾没有换行的
+    "//", "// x", "a // b", "a //", "// x\n", "//\n//\nb", "a // b\r\nc", "/// x\ny", "//* x\nz", "a // b /* c\n*/",
+    // 整数: 0, 八进制, 十六进制, 以及不合法的前缀
+    "0", "00", "007", "017", "08", "09", "0778", "0x", "0X", "0x1F", "0XaB", "0xg", "0x0", "00x1",
+    "2147483647", "2147483648", "4294967295", "4294967296", "0x7fffffff", "0xffffffff", "0x100000000",
+    "9223372036854775807", "9223372036854775808", "99999999999999999999", "0777777777777777777777777",
+    "0xffffffffffffffffff", "1a", "0x1g", "12abc",
+    // 关键字和以关键字开头的标识符
+    "int", "return", "const", "intx", "returnx", "constant", "int_", "_int", "in", "retur", "con",
+    "Int", "RETURN", "int0", "return1", "int int", "intreturn", "x_1 _ __ a9",
+    // 运算符
+    "<=>=!==&&||", "<>!=&|", "a<=b", "a<b", "!a", "&&&", "|||", "===", "<==", "!!=", "+-*/%", "(){};,",
+    // 换行和回车
+    "\n", "\r", "\r\n", "a\rb", "a\r\nb\n\nc", "\n\n\nx\n", "a\n\r\nb", "\t \r\n \t",
+    // 其他字符, 由 . 规则逐个返回
+    "@#$", "a.b", "\"s\"", "'c'", "\\",
+};
+
+// 随机拼接的片段覆盖各种规则的相邻组合
+static const char *fragments[] = {
+    " ", "\n", "\r\n", "\r", "\t", "int", "return", "const", "intx", "returnx", "x", "_a1", "0", "07", "08", "0x",
+    "0x1f", "123", "/*", "*/", "*", "/", "//", "**", "<", ">", "=", "!", "&", "|", "+", "-", "(", ")", "{", "}", ";",
+};
+
+int main() {
+    int failures = 0, total = 0;
+    for (const char *input : cases) {
+        ++total;
+        failures += !Check(input);
+    }
+    uint32_t seed = 12345;
+    auto next = [&seed] {
+        seed = seed * 1103515245u + 12345u;
+        return seed >> 16;
+    };
+    for (int i = 0; i < 20000; ++i) {
+        std::string input;
+        for (uint32_t n = next() % 24; n > 0; --n) input += fragments[next() % (sizeof(fragments) / sizeof(fragments[0]))];
+        ++total;
+        failures += !Check(input);
+    }
+    if (failures) {
+        std::printf("%d of %d inputs differ\n", failures, total);
+        return 1;
+    }
+    std::printf("all %d inputs passed\n", total);
+    return 0;
+}
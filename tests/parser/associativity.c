@@ -0,0 +1,15 @@
+int main() {
+  int a = 20;
+  int b = 7;
+  int c = 3;
+  int r = 0;
+  r = a - b - c;
+  r = r + (a - b) - c;
+  r = r + a - (b - c);
+  r = r + a / b / c;
+  r = r + a / b * c;
+  r = r + a % b * c;
+  r = r + a * b % c;
+  r = r + a - b + c - a + b;
+  return r;
+}
@@ -0,0 +1,9 @@
+// 注释和空白不影响语法树
+int /* return type */ main(/**/) {
+  int a = 1; // trailing comment
+  /***/ int b = 2;
+  /* multi
+   * line
+   */
+  return a/**/+/***/b;
+}
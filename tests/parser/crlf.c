@@ -0,0 +1,4 @@
+int main() {
+  int a = 3;
+  return a * 2;
+}
\ No newline at end of file
@@ -0,0 +1,4 @@
+int main() {
+  const int a;
+  return 0;
+}
@@ -0,0 +1,3 @@
+int main() {
+  int a = 1;
+  return a
@@ -0,0 +1,21 @@
+int main() {
+  int a = 1;
+  int b = 0;
+  int c = 2;
+  int d = 3;
+  int e = 4;
+  int f = 5;
+  int g = 6;
+  int r = 0;
+  r = a || b && c == d < e + f * g;
+  r = r + (a * b + c < d == e && f || g);
+  r = r + ((a || b) && c);
+  r = r + (a + b) * (c - d);
+  r = r + (a < b < c);
+  r = r + (a == b != c);
+  r = r + (a <= b >= c > d);
+  r = r + (a && b || c && d);
+  r = r + (!a || !b && !c);
+  r = r + -(a + b) * -c % (d + 1);
+  return r;
+}
@@ -0,0 +1,18 @@
+int main() {
+  const int N = 010, M = 0x1F, Z = 0;
+  const int K = N * M + Z;
+  int x = K, y;
+  y = x - 1;
+  ;
+  x + y;
+  {
+    int x = y * 2;
+    const int y2 = K - 1;
+    {
+      x = x + y2;
+    }
+    y = x;
+  }
+  {}
+  return x + y;
+}
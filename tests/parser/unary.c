@@ -0,0 +1,13 @@
+int main() {
+  int x = 5;
+  int r = 0;
+  r = !-+x;
+  r = r + - -x;
+  r = r + -(-x);
+  r = r + !!x;
+  r = r + -!+-x;
+  r = r + +-+-+x;
+  r = r + !x - -x;
+  r = r * -x;
+  return r;
+}
@@ -0,0 +1,45 @@
+#!/bin/sh
+# bison 生成的语法分析器与手写的递归下降分析器的差分测试.
+# 对 tests/parser 中的每个输入分别用 -parser=bison 和 -parser=rd 编译, 比较化简后的 AST (-dump-ast=sexpr),
+# 生成的 Koopa IR, stderr 中的报错和退出码. err_ 开头的输入有语法错误, 两者都必须失败.
+# 用法: parser_diff.sh 编译器路径
+
+COMPILER=${1:?usage: parser_diff.sh COMPILER}
+INPUT_DIR=$(dirname "$0")/parser
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+failures=0
+total=0
+for input in "$INPUT_DIR"/*.c; do
+  name=$(basename "$input" .c)
+  total=$((total + 1))
+  for parser in bison rd; do
+    rm -f "$WORK/$parser.koopa"
+    "$COMPILER" -koopa "$input" -o "$WORK/$parser.koopa" -parser=$parser -dump-ast=sexpr \
+      > "$WORK/$parser.ast" 2> "$WORK/$parser.err"
+    echo $? > "$WORK/$parser.status"
+    [ -f "$WORK/$parser.koopa" ] || : > "$WORK/$parser.koopa"
+  done
+
+  ok=1
+  for part in status err ast koopa; do
+    if ! cmp -s "$WORK/bison.$part" "$WORK/rd.$part"; then
+      echo "FAIL $name: $part differs"
+      diff "$WORK/bison.$part" "$WORK/rd.$part" | head -n 10
+      ok=0
+    fi
+  done
+  status=$(cat "$WORK/bison.status")
+  case $name in
+    err_*) [ "$status" != 0 ] || { echo "FAIL $name: accepted an invalid program"; ok=0; } ;;
+    *) [ "$status" = 0 ] || { echo "FAIL $name: exit status $status"; cat "$WORK/bison.err"; ok=0; } ;;
+  esac
+  [ $ok = 1 ] && echo "ok   $name" || failures=$((failures + 1))
+done
+
+if [ $failures != 0 ]; then
+  echo "$failures of $total inputs differ"
+  exit 1
+fi
+echo "all $total inputs passed"
@@ -0,0 +1,167 @@
+// 强度削弱的穷举测试: 对每个常量模拟 ReduceMul / ReduceDiv / ReduceRem 生成的指令序列,
+// 在全部 2^32 个被除数 (被乘数) 上与 EvalBinary 的结果比较.
+// 用法: strength_test [常量...], 不给常量时测试内置的列表.
+#include<algorithm>
+#include<cinttypes>
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<vector>
+#include "consteval.hpp"
+#include "strength.hpp"
+
+// 一次模拟 kBatch 个输入, 每条指令对整批输入执行, 解释的开销被整批分摊
+static constexpr uint32_t kBatch = 1024;
+
+struct Machine {
+    int32_t regs[32][kBatch];
+};
+
+static Machine machine;
+static int failures = 0;
+
+static const char *op_names[] = {"mul", "div", "rem"};
+static const koopa_raw_binary_op_t koopa_ops[] = {KOOPA_RBO_MUL, KOOPA_RBO_DIV, KOOPA_RBO_MOD};
+
+// 执行指令序列, 不认识的指令或读写了不允许的寄存器时返回 false
+static bool Run(const std::vector<MachineInst> &code, uint32_t n) {
+    auto &r = machine.regs;
+    for (const auto &inst : code) {
+        int32_t *d = r[inst.rd];
+        const int32_t *a = inst.rs1 == REG_NONE ? nullptr : r[inst.rs1];
+        const int32_t *b = inst.rs2 == REG_NONE ? nullptr : r[inst.rs2];
+        int32_t imm = inst.imm;
+        switch (inst.op) {
+            case RV_LI: for (uint32_t i = 0; i < n; ++i) d[i] = imm; break;
+            case RV_MV: for (uint32_t i = 0; i < n; ++i) d[i] = a[i]; break;
+            case RV_ADD: for (uint32_t i = 0; i < n; ++i) d[i] = int32_t(uint32_t(a[i]) + uint32_t(b[i])); break;
+            case RV_SUB: for (uint32_t i = 0; i < n; ++i) d[i] = int32_t(uint32_t(a[i]) - uint32_t(b[i])); break;
+            case RV_MUL: for (uint32_t i = 0; i < n; ++i) d[i] = int32_t(uint32_t(a[i]) * uint32_t(b[i])); break;
+            case RV_MULH: for (uint32_t i = 0; i < n; ++i) d[i] = int32_t((int64_t(a[i]) * b[i]) >> 32); break;
+            case RV_SLLI: for (uint32_t i = 0; i < n; ++i) d[i] = int32_t(uint32_t(a[i]) << imm); break;
+            case RV_SRLI: for (uint32_t i = 0; i < n; ++i) d[i] = int32_t(uint32_t(a[i]) >> imm); break;
+            case RV_SRAI: for (uint32_t i = 0; i < n; ++i) d[i] = a[i] >> imm; break;
+            default: return false;
+        }
+        // 写入 zero 的结果被丢弃
+        if (inst.rd == REG_ZERO) for (uint32_t i = 0; i < n; ++i) d[i] = 0;
+    }
+    return true;
+}
+
+// 序列只能写 dst, t1, 以及与 src 不同的 t0; 移位量在 [0, 32) 内
+static bool CheckRegisters(const std::vector<MachineInst> &code, reg_t dst, reg_t src) {
+    for (const auto &inst : code) {
+        bool writable = inst.rd == dst || inst.rd == REG_T1 || inst.rd == REG_ZERO || (inst.rd == REG_T0 && src != REG_T0);
+        if (inst.rd == REG_NONE || !writable) return false;
+        if (inst.Format() == RV_FMT_I && (inst.imm < 0 || inst.imm >= 32)) return false;
+    }
+    return true;
+}
+
+static bool Reduce(int op, std::vector<MachineInst> &code, reg_t dst, reg_t src, int32_t c) {
+    return ReduceByConstant(code, koopa_ops[op], dst, src, c);
+}
+
+// EvalBinary 对一批输入的结果; 运算符是模板参数, 内联后循环中没有分派
+template<koopa_raw_binary_op_t Op>
+static void Expect(int32_t *expected, uint32_t x, uint32_t stride, int32_t c, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        int32_t value = 0;
+        EvalBinary(Op, int32_t(x + i * stride), c, value);
+        expected[i] = value;
+    }
+}
+
+// 从 first 开始每隔 stride 取一个输入, 共 count 个 (按 2^32 回绕); 返回不一致的个数
+static uint64_t Check(int op, int32_t c, reg_t dst, reg_t src, uint32_t first, uint32_t stride, uint64_t count) {
+    std::vector<MachineInst> code;
+    if (!Reduce(op, code, dst, src, c)) return 0;
+    if (!CheckRegisters(code, dst, src)) {
+        std::printf("FAIL %s %" PRId32 ": sequence writes a register it may not use\n", op_names[op], c);
+        return 1;
+    }
+    uint64_t mismatches = 0;
+    uint32_t x = first;
+    for (uint64_t done = 0; done < count;) {
+        uint32_t n = count - done < kBatch ? uint32_t(count - done) : kBatch;
+        // 序列可能写的寄存器先填入无关的值, 读到未初始化的寄存器时结果会出错
+        for (reg_t reg : {dst, REG_T0, REG_T1}) std::fill(machine.regs[reg], machine.regs[reg] + n, 0x5a5a5a5a);
+        for (uint32_t i = 0; i < n; ++i) machine.regs[src][i] = int32_t(x + i * stride);
+        if (!Run(code, n)) {
+            std::printf("FAIL %s %" PRId32 ": unexpected instruction\n", op_names[op], c);
+            return 1;
+        }
+        // 先整批求出期望值再比较, 两个循环都没有分支
+        static int32_t expected[kBatch];
+        switch (op) {
+            case 0: Expect<KOOPA_RBO_MUL>(expected, x, stride, c, n); break;
+            case 1: Expect<KOOPA_RBO_DIV>(expected, x, stride, c, n); break;
+            default: Expect<KOOPA_RBO_MOD>(expected, x, stride, c, n); break;
+        }
+        uint32_t differ = 0;
+        for (uint32_t i = 0; i < n; ++i) differ |= uint32_t(machine.regs[dst][i] ^ expected[i]);
+        if (differ) {
+            for (uint32_t i = 0; i < n; ++i) {
+                if (machine.regs[dst][i] == expected[i]) continue;
+                if (mismatches++ < 5) {
+                    std::printf("FAIL %s %" PRId32 " [%s <- %s]: %" PRId32 " gives %" PRId32 ", expected %" PRId32 "\n",
+                                op_names[op], c, reg_names[dst], reg_names[src], int32_t(x + i * stride),
+                                machine.regs[dst][i], expected[i]);
+                }
+            }
+        }
+        x += n * stride;
+        done += n;
+    }
+    return mismatches;
+}
+
+static void TestConstant(int32_t c) {
+    // 削弱时 src 是分配到的寄存器或装入的 t0, dst 是分配到的寄存器或 t0
+    static const reg_t configs[][2] = {
+        {REG_A0, REG_A1}, {REG_A0, REG_A0}, {REG_T0, REG_T0}, {REG_A0, REG_T0}, {REG_T0, REG_A0},
+    };
+    for (int op = 0; op < 3; ++op) {
+        std::vector<MachineInst> code;
+        bool reduced = Reduce(op, code, REG_A0, REG_A1, c);
+        bool expect_reduced = op == 0 || (c != 0 && c != INT32_MIN);
+        if (op == 0 && !reduced) continue;      // 乘法只削弱部分常量
+        if (reduced != expect_reduced) {
+            std::printf("FAIL %s %" PRId32 ": %s\n", op_names[op], c, reduced ? "reduced" : "not reduced");
+            ++failures;
+            continue;
+        }
+        if (!reduced) {
+            std::printf("ok   %s %" PRId32 " (not reduced)\n", op_names[op], c);
+            continue;
+        }
+        // 第一种寄存器分配穷举全部输入, 其余的检查约 2^20 个间隔均匀的输入
+        uint64_t bad = Check(op, c, configs[0][0], configs[0][1], 0, 1, uint64_t(1) << 32);
+        for (size_t i = 1; i < sizeof(configs) / sizeof(configs[0]); ++i) {
+            bad += Check(op, c, configs[i][0], configs[i][1], 0x80000000u, 4093, 1 << 20);
+        }
+        std::printf("%s %s %" PRId32 " (%zu instructions)\n", bad ? "FAIL" : "ok  ", op_names[op], c, code.size());
+        if (bad) ++failures;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // 每个常量要运行几十秒, 输出重定向到文件时也逐行写出进度
+    std::setvbuf(stdout, nullptr, _IOLBF, 0);
+    std::vector<int32_t> constants;
+    for (int i = 1; i < argc; ++i) constants.push_back(int32_t(std::strtol(argv[i], nullptr, 0)));
+    if (constants.empty()) {
+        constants = {
+            0, 1, -1, 2, -2, 3, -3, 5, 6, 7, -7, 9, 10, 16, -16, 641, 1000, -1000,
+            1 << 30, -(1 << 30), INT32_MAX, INT32_MIN + 1, INT32_MIN,
+        };
+    }
+    for (auto c : constants) TestConstant(c);
+    if (failures) {
+        std::printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    std::printf("all passed\n");
+    return 0;
+}